@@ -0,0 +1,782 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "BacktrackingSolver.h"
+#include "core/Bitmask.h"
+#include <array>
+#include <bit>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+class BacktrackingSolver::Engine {
+public:
+  virtual ~Engine() = default;
+
+  // Search the solutions of the candidates of all the squares, with the
+  // additional constraints of the killer cages.
+  virtual uint64_t Search(const sudoku::BitSet *data, std::span<const sudoku::KillerBlock> cages,
+                          uint64_t limit) = 0;
+  // Value of a square in the first solution found by the last search.
+  virtual sudoku::BitSet Solution(unsigned cell) const = 0;
+
+  unsigned size = 0;
+  SudokuTypes type = BASIC;
+  uint64_t nodes = 0;
+};
+
+namespace {
+
+/*! Search over puzzles with at most MaxNumbers numbers and MaxCells squares.
+ *
+ * The state is a bitboard over the squares for each number, marking the
+ * squares the number is still possible in. Placing a number removes it from
+ * all the peers with a single mask operation, and the squares with one, two
+ * or no candidates are found by counting the bitboards bitwise. The state
+ * also keeps the candidates of each square as a mask over the numbers, so
+ * that reading a square never scans the bitboards of all the numbers.
+ *
+ * Killer cages make the squares of a cage peers of each other and after the
+ * singles, numbers that can't complete the sum of a cage with the remaining
+ * numbers are removed.
+ */
+template <size_t MaxNumbers, size_t MaxCells>
+class SearchEngine final : public BacktrackingSolver::Engine {
+public:
+  SearchEngine(const sudoku::SudokuLayout &layout, unsigned puzzle_size, SudokuTypes puzzle_type)
+      : cells_(puzzle_size * puzzle_size), peers_(cells_), stack_(2) {
+    size = puzzle_size;
+    type = puzzle_type;
+    for (unsigned cell = 0; cell < cells_; cell++) {
+      auto words = layout.Peers(cell);
+      for (unsigned peer = 0; peer < cells_; peer++) {
+        if ((words[peer / 64] >> (peer % 64)) & 1u)
+          peers_[cell].Set(peer);
+      }
+    }
+    for (const auto &block : layout.blocks) {
+      CellMask mask;
+      for (auto cell : block.Cells()) {
+        mask.Set(cell);
+      }
+      all_blocks_.Set(static_cast<unsigned>(blocks_.size()));
+      blocks_.push_back(mask);
+    }
+    for (unsigned cell = 0; cell < cells_; cell++) {
+      all_cells_.Set(cell);
+    }
+    cell_blocks_.resize(cells_);
+    for (unsigned cell = 0; cell < cells_; cell++) {
+      for (auto block : layout.mapping[cell]) {
+        cell_blocks_[cell].Set(block);
+      }
+    }
+  }
+
+  uint64_t Search(const sudoku::BitSet *data, std::span<const sudoku::KillerBlock> cages,
+                  uint64_t limit) override {
+    count_ = 0;
+    limit_ = limit;
+    nodes = 0;
+    if (limit == 0)
+      return 0;
+
+    cages_.clear();
+    cage_peers_.clear();
+    if (!cages.empty())
+      cage_peers_.resize(cells_);
+    for (const auto &cage : cages) {
+      cages_.push_back({cage.Cells(), cage.Sum()});
+      for (auto cell : cage.Cells()) {
+        for (auto peer : cage.Cells()) {
+          if (peer != cell)
+            cage_peers_[cell].Set(peer);
+        }
+      }
+    }
+
+    State &root = stack_[0];
+    root = State{};
+    root.unsolved = all_cells_;
+    dirty_.fill(all_blocks_);
+    const uint64_t all = sudoku::BitSet::SudokuSquare(size).Value();
+    for (unsigned cell = 0; cell < cells_; cell++) {
+      root.candidates[cell] = static_cast<NumberMask>(data[cell].Value() & all);
+    }
+    // Transposed a word at a time, setting the bits one by one would chain
+    // every update through memory.
+    for (unsigned number = 0; number < size; number++) {
+      for (unsigned word = 0; word * 64 < cells_; word++) {
+        uint64_t positions = 0;
+        for (unsigned bit = 0; bit < 64 && word * 64 + bit < cells_; bit++) {
+          positions |= static_cast<uint64_t>((root.candidates[word * 64 + bit] >> number) & 1u) << bit;
+        }
+        root.numbers[number].SetWord(word, positions);
+      }
+    }
+    if (Propagate(root))
+      Branch(0);
+    return count_;
+  }
+
+  sudoku::BitSet Solution(unsigned cell) const override {
+    return sudoku::BitSet::FromValue(solution_.candidates[cell]);
+  }
+
+private:
+  using CellMask = sudoku::FixedBitmask<MaxCells>;
+  // Rows, columns, boxes and diagonals.
+  using BlockMask = sudoku::FixedBitmask<3 * MaxNumbers + 2>;
+  // Numbers of a square, bit number-1 set for each possible number.
+  using NumberMask = std::conditional_t<MaxNumbers <= 16, uint16_t,
+                                        std::conditional_t<MaxNumbers <= 32, uint32_t, uint64_t>>;
+
+  struct State {
+    // Squares each number is possible in, number-1 indexed.
+    std::array<CellMask, MaxNumbers> numbers;
+    // The same candidates, indexed by the square.
+    std::array<NumberMask, MaxCells> candidates;
+    CellMask unsolved;
+  };
+
+  static NumberMask Bit(unsigned number) { return static_cast<NumberMask>(NumberMask{1} << number); }
+
+  struct Cage {
+    std::vector<unsigned> cells;
+    unsigned sum;
+  };
+
+  // Cheaper than counting the indexes, the build doesn't assume a popcount
+  // instruction.
+  static bool HasSingleIndex(const CellMask &mask) {
+    bool found = false;
+    for (auto word : mask.Words()) {
+      if (word == 0)
+        continue;
+      if (found || (word & (word - 1)) != 0)
+        return false;
+      found = true;
+    }
+    return found;
+  }
+
+  // Place the number (0-based) into the square, the blocks in which the
+  // positions of a number changed are marked dirty for the number.
+  void Assign(State &state, unsigned cell, unsigned number) {
+    NumberMask others = state.candidates[cell] & static_cast<NumberMask>(~Bit(number));
+    for (; others != 0; others &= static_cast<NumberMask>(others - 1)) {
+      unsigned other = static_cast<unsigned>(std::countr_zero(others));
+      state.numbers[other].Reset(cell);
+      dirty_[other] |= cell_blocks_[cell];
+    }
+    state.candidates[cell] = Bit(number);
+    CellMask removed = state.numbers[number] & peers_[cell];
+    if (!cage_peers_.empty())
+      removed |= state.numbers[number] & cage_peers_[cell];
+    BlockMask touched;
+    for (auto peer : removed) {
+      touched |= cell_blocks_[peer];
+      state.candidates[peer] &= static_cast<NumberMask>(~Bit(number));
+    }
+    dirty_[number] |= touched;
+    state.numbers[number] -= removed;
+    state.unsolved.Reset(cell);
+  }
+
+  // Remove the number (0-based) from an unsolved square.
+  void Remove(State &state, unsigned cell, unsigned number) {
+    state.numbers[number].Reset(cell);
+    state.candidates[cell] &= static_cast<NumberMask>(~Bit(number));
+    dirty_[number] |= cell_blocks_[cell];
+  }
+
+  // Smallest and largest sum of count distinct numbers of the mask, false if
+  // the mask doesn't have enough numbers.
+  static bool SumRange(uint64_t mask, unsigned count, unsigned &min, unsigned &max) {
+    if (static_cast<unsigned>(std::popcount(mask)) < count)
+      return false;
+    min = 0;
+    max = 0;
+    uint64_t low = mask;
+    uint64_t high = mask;
+    for (unsigned i = 0; i < count; i++) {
+      min += static_cast<unsigned>(std::countr_zero(low)) + 1;
+      low &= low - 1;
+      unsigned top = 63 - static_cast<unsigned>(std::countl_zero(high));
+      max += top + 1;
+      high &= ~(UINT64_C(1) << top);
+    }
+    return true;
+  }
+
+  // Remove the numbers that can't complete the sums of the cages, return
+  // false on a contradiction.
+  bool PruneCages(State &state, bool &changed) {
+    for (const auto &cage : cages_) {
+      unsigned remaining = cage.sum;
+      unsigned open = 0;
+      uint64_t used = 0;
+      uint64_t available = 0;
+      for (auto cell : cage.cells) {
+        uint64_t candidates = state.candidates[cell];
+        if (state.unsolved.IsSet(cell)) {
+          open++;
+          available |= candidates;
+          continue;
+        }
+        unsigned value = static_cast<unsigned>(std::countr_zero(candidates)) + 1;
+        if (value > remaining)
+          return false;
+        remaining -= value;
+        used |= candidates;
+      }
+      available &= ~used;
+
+      unsigned min = 0;
+      unsigned max = 0;
+      if (!SumRange(available, open, min, max) || remaining < min || remaining > max)
+        return false;
+      if (open == 0)
+        continue;
+
+      for (auto cell : cage.cells) {
+        if (!state.unsolved.IsSet(cell))
+          continue;
+        uint64_t candidates = state.candidates[cell];
+        for (uint64_t rest = candidates; rest != 0; rest &= rest - 1) {
+          unsigned number = static_cast<unsigned>(std::countr_zero(rest));
+          unsigned value = number + 1;
+          uint64_t others = available & ~(UINT64_C(1) << number);
+          if (value <= remaining && SumRange(others, open - 1, min, max) && remaining - value >= min &&
+              remaining - value <= max)
+            continue;
+          Remove(state, cell, number);
+          changed = true;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Propagate the naked and hidden singles, return false on a contradiction.
+  // Leaves the unsolved squares with exactly two candidates in pairs_.
+  bool Propagate(State &state) {
+    for (;;) {
+      CellMask once;
+      CellMask twice;
+      CellMask thrice;
+      for (unsigned number = 0; number < size; number++) {
+        CellMask open = state.numbers[number] & state.unsolved;
+        thrice |= twice & open;
+        twice |= once & open;
+        once |= open;
+      }
+      if ((state.unsolved - once).Any())
+        return false;
+
+      CellMask singles = state.unsolved - twice;
+      if (singles.Any()) {
+        for (auto cell : singles) {
+          // Placing an earlier single can remove the only candidate.
+          if (state.candidates[cell] == 0)
+            return false;
+          Assign(state, cell, static_cast<unsigned>(std::countr_zero(state.candidates[cell])));
+        }
+        continue;
+      }
+
+      // A number placed in a block is removed from the rest of the block, so
+      // a single open position is a hidden single and a block without any
+      // position for a number is a contradiction, which the naked singles
+      // would only find deep in the search. Only the blocks in which the
+      // positions of the number changed since the last pass can have new
+      // ones.
+      bool changed = false;
+      for (unsigned number = 0; number < size; number++) {
+        BlockMask dirty = dirty_[number];
+        dirty_[number].Clear();
+        for (auto block : dirty) {
+          CellMask positions = state.numbers[number] & blocks_[block];
+          if (!positions.Any())
+            return false;
+          positions &= state.unsolved;
+          if (HasSingleIndex(positions)) {
+            Assign(state, *positions.begin(), number);
+            changed = true;
+          }
+        }
+      }
+      if (!changed && !cages_.empty() && !PruneCages(state, changed))
+        return false;
+      if (!changed) {
+        pairs_ = twice - thrice;
+        return true;
+      }
+    }
+  }
+
+  // Branch on the unsolved square with the fewest candidates, return true
+  // once the limit of solutions is reached.
+  bool Branch(unsigned depth) {
+    nodes++;
+    if (stack_.size() < depth + 2)
+      stack_.resize(depth + 2);
+
+    const State &state = stack_[depth];
+    if (!state.unsolved.Any()) {
+      if (count_ == 0)
+        solution_ = state;
+      return ++count_ >= limit_;
+    }
+
+    unsigned best = *state.unsolved.begin();
+    if (pairs_.Any()) {
+      best = *pairs_.begin();
+    } else {
+      // Without pairs, every unsolved square has at least three candidates.
+      unsigned best_count = size + 1;
+      for (auto cell : state.unsolved) {
+        unsigned count = static_cast<unsigned>(std::popcount(state.candidates[cell]));
+        if (count < best_count) {
+          best = cell;
+          best_count = count;
+          if (count <= 3)
+            break;
+        }
+      }
+    }
+
+    for (NumberMask rest = state.candidates[best]; rest != 0; rest &= static_cast<NumberMask>(rest - 1)) {
+      unsigned number = static_cast<unsigned>(std::countr_zero(rest));
+      // Deeper levels can grow the stack, so the states are looked up again.
+      stack_[depth + 1] = stack_[depth];
+      State &next = stack_[depth + 1];
+      for (unsigned other = 0; other < size; other++) {
+        dirty_[other].Clear();
+      }
+      Assign(next, best, number);
+      if (Propagate(next) && Branch(depth + 1))
+        return true;
+    }
+    return false;
+  }
+
+  unsigned cells_;
+  CellMask all_cells_;
+  std::vector<CellMask> peers_;
+  std::vector<CellMask> blocks_;
+  BlockMask all_blocks_;
+  // Blocks containing each square.
+  std::vector<BlockMask> cell_blocks_;
+  // Killer cages of the current search and the other squares of the cages
+  // of each square, empty without cages.
+  std::vector<Cage> cages_;
+  std::vector<CellMask> cage_peers_;
+  // States of the nodes on the current search path, indexed by depth.
+  std::vector<State> stack_;
+  // Unsolved squares with two candidates, left by the last propagation.
+  CellMask pairs_;
+  // Blocks of each number changed since the last search for hidden singles.
+  std::array<BlockMask, MaxNumbers> dirty_;
+  State solution_;
+  uint64_t count_ = 0;
+  uint64_t limit_ = 0;
+};
+
+/*! Search over the basic 9x9 puzzles, without the setup of the generic engine.
+ *
+ * The squares are split into three bands of three rows, 27 squares each, and
+ * every number keeps a bitboard of its possible squares per band. Placing a
+ * number only clears its row, box and column from its own bitboard, with
+ * masks of precomputed tables, the other numbers keep the square until the
+ * bitboards are read, where the solved squares are masked out. Finding the
+ * naked and hidden singles is a few mask operations per band and number.
+ *
+ * The search starts from a precomputed board with all the candidates, from
+ * which only the candidates the puzzle doesn't have are cleared, so there is
+ * no transposition and no walk over the blocks of the layout, and only the
+ * numbers that lost a position are searched for hidden singles. Puzzles with
+ * killer cages are left to the generic engine.
+ */
+class BasicEngine final : public BacktrackingSolver::Engine {
+public:
+  explicit BasicEngine(const sudoku::SudokuLayout &layout) : generic_(layout, NUMBERS, BASIC) {
+    size = NUMBERS;
+    type = BASIC;
+  }
+
+  uint64_t Search(const sudoku::BitSet *data, std::span<const sudoku::KillerBlock> cages,
+                  uint64_t limit) override {
+    caged_ = !cages.empty();
+    if (caged_) {
+      uint64_t count = generic_.Search(data, cages, limit);
+      nodes = generic_.nodes;
+      return count;
+    }
+    count_ = 0;
+    limit_ = limit;
+    nodes = 0;
+    if (limit == 0)
+      return 0;
+
+    // Givens are placed right away, only the squares with some of the
+    // candidates removed, e.g. by SmartSolver, clear them one by one. The
+    // givens are collected without branching on each square.
+    Board &root = stack_[0];
+    root = FULL_BOARD;
+    unsigned givens = 0;
+    bool partial = false;
+    for (unsigned cell = 0; cell < CELLS; cell++) {
+      const uint32_t candidates = static_cast<uint32_t>(data[cell].Value()) & ALL_NUMBERS;
+      const bool single = (candidates & (candidates - 1)) == 0;
+      givens_[givens] = static_cast<uint8_t>(cell);
+      givens += single;
+      partial |= !single && candidates != ALL_NUMBERS;
+    }
+    for (unsigned cell = 0; partial && cell < CELLS; cell++) {
+      const uint32_t candidates = static_cast<uint32_t>(data[cell].Value()) & ALL_NUMBERS;
+      if (candidates == ALL_NUMBERS || (candidates & (candidates - 1)) == 0)
+        continue;
+      for (uint32_t missing = ~candidates & ALL_NUMBERS; missing != 0; missing &= missing - 1) {
+        root.numbers[Index(static_cast<unsigned>(std::countr_zero(missing)), cell / BAND_CELLS)] &=
+            ~(1u << (cell % BAND_CELLS));
+      }
+    }
+    for (unsigned given = 0; given < givens; given++) {
+      const unsigned cell = givens_[given];
+      const uint32_t candidates = static_cast<uint32_t>(data[cell].Value()) & ALL_NUMBERS;
+      if (candidates == 0)
+        return 0;
+      const unsigned band = cell / BAND_CELLS;
+      const unsigned bit = cell % BAND_CELLS;
+      const unsigned number = static_cast<unsigned>(std::countr_zero(candidates));
+      // Removed by an earlier given.
+      if (((root.numbers[Index(number, band)] >> bit) & 1u) == 0)
+        return 0;
+      Place(root, band, bit, number);
+    }
+    dirty_ = ALL_NUMBERS;
+    if (Propagate(root))
+      Branch(0);
+    return count_;
+  }
+
+  sudoku::BitSet Solution(unsigned cell) const override {
+    if (caged_)
+      return generic_.Solution(cell);
+    const unsigned band = cell / BAND_CELLS;
+    for (unsigned number = 0; number < NUMBERS; number++) {
+      if ((solution_.placed[Index(number, band)] >> (cell % BAND_CELLS)) & 1u)
+        return sudoku::BitSet::FromValue(UINT64_C(1) << number);
+    }
+    return sudoku::BitSet::FromValue(0);
+  }
+
+private:
+  static constexpr unsigned NUMBERS = 9;
+  static constexpr unsigned BANDS = 3;
+  static constexpr unsigned BAND_CELLS = 27;
+  static constexpr unsigned CELLS = BANDS * BAND_CELLS;
+  static constexpr uint32_t ALL_NUMBERS = 0x1FF;
+  static constexpr uint32_t ROW = 0x1FF;
+  static constexpr uint32_t BAND = 0x7FFFFFF;
+  // Repeats the columns of a row in all three rows of a band.
+  static constexpr uint32_t ROWS = 1u | 1u << 9 | 1u << 18;
+  // The first box of a band, the others are shifted by 3 and 6.
+  static constexpr uint32_t BOX = 7u * ROWS;
+
+  struct Board {
+    // Squares each number is possible in, by band, see Index. Solved squares
+    // are only meaningful in placed.
+    std::array<uint32_t, BANDS * NUMBERS> numbers;
+    // Squares each number is placed in.
+    std::array<uint32_t, BANDS * NUMBERS> placed;
+    std::array<uint32_t, BANDS> unsolved;
+  };
+
+  // The numbers of a band are next to each other, so that counting the
+  // candidates of the squares of a band reads them in order.
+  static constexpr unsigned Index(unsigned number, unsigned band) { return band * NUMBERS + number; }
+
+  static constexpr Board FULL_BOARD = [] {
+    Board board{};
+    board.numbers.fill(BAND);
+    board.unsolved.fill(BAND);
+    return board;
+  }();
+
+  // Squares of a band sharing a row, a column or a box with each square of
+  // the band, the square itself excluded, and the column of each square.
+  static constexpr std::array<uint32_t, BAND_CELLS> BAND_PEERS = [] {
+    std::array<uint32_t, BAND_CELLS> peers{};
+    for (unsigned bit = 0; bit < BAND_CELLS; bit++) {
+      const unsigned col = bit % 9;
+      peers[bit] = ((ROW << (bit - col)) | (ROWS << col) | (BOX << (col - col % 3))) & ~(1u << bit);
+    }
+    return peers;
+  }();
+  static constexpr std::array<uint32_t, BAND_CELLS> COLUMNS = [] {
+    std::array<uint32_t, BAND_CELLS> columns{};
+    for (unsigned bit = 0; bit < BAND_CELLS; bit++) {
+      columns[bit] = ROWS << (bit % 9);
+    }
+    return columns;
+  }();
+
+  // Numbers possible in an unsolved square.
+  static uint32_t Candidates(const Board &board, unsigned band, unsigned bit) {
+    uint32_t candidates = 0;
+    for (unsigned number = 0; number < NUMBERS; number++) {
+      candidates |= ((board.numbers[Index(number, band)] >> bit) & 1u) << number;
+    }
+    return candidates;
+  }
+
+  static void Place(Board &board, unsigned band, unsigned bit, unsigned number) {
+    const unsigned next = band == BANDS - 1 ? 0 : band + 1;
+    const unsigned last = next == BANDS - 1 ? 0 : next + 1;
+    board.numbers[Index(number, band)] &= ~BAND_PEERS[bit];
+    board.numbers[Index(number, next)] &= ~COLUMNS[bit];
+    board.numbers[Index(number, last)] &= ~COLUMNS[bit];
+    board.placed[Index(number, band)] |= 1u << bit;
+    board.unsolved[band] &= ~(1u << bit);
+  }
+
+  // Collect the unsolved squares that are the only position of the number in
+  // a row, a column or a box, return false if a block has no position at all.
+  static bool HiddenSingles(const Board &board, unsigned number, std::array<uint32_t, BANDS> &hidden) {
+    uint32_t col_once = 0;
+    uint32_t col_twice = 0;
+    std::array<uint32_t, BANDS> positions;
+    for (unsigned band = 0; band < BANDS; band++) {
+      positions[band] = (board.numbers[Index(number, band)] & board.unsolved[band]) |
+                        board.placed[Index(number, band)];
+      const uint32_t rows[3] = {positions[band] & ROW, (positions[band] >> 9) & ROW, positions[band] >> 18};
+      uint32_t singles = 0;
+      for (unsigned row = 0; row < 3; row++) {
+        if (rows[row] == 0)
+          return false;
+        if ((rows[row] & (rows[row] - 1)) == 0)
+          singles |= rows[row] << (9 * row);
+        col_twice |= col_once & rows[row];
+        col_once |= rows[row];
+      }
+      // Columns of the band with at least one and at least two positions,
+      // a box has a single position if exactly one of its columns has one.
+      const uint32_t once = rows[0] | rows[1] | rows[2];
+      const uint32_t twice = (rows[0] & rows[1]) | (rows[2] & (rows[0] | rows[1]));
+      for (unsigned box = 0; box < 9; box += 3) {
+        const uint32_t columns = (once >> box) & 7u;
+        if (columns == 0)
+          return false;
+        if ((columns & (columns - 1)) == 0 && ((twice >> box) & 7u) == 0)
+          singles |= positions[band] & (BOX << box);
+      }
+      hidden[band] = singles;
+    }
+    if (col_once != ROW)
+      return false;
+    const uint32_t columns = (col_once & ~col_twice) * ROWS;
+    for (unsigned band = 0; band < BANDS; band++) {
+      hidden[band] = (hidden[band] | (positions[band] & columns)) & board.unsolved[band];
+    }
+    return true;
+  }
+
+  // Propagate the naked and hidden singles, return false on a contradiction.
+  bool Propagate(Board &board) {
+    for (;;) {
+      bool placed = false;
+      for (unsigned band = 0; band < BANDS; band++) {
+        const uint32_t unsolved = board.unsolved[band];
+        if (unsolved == 0)
+          continue;
+        uint32_t once = 0;
+        uint32_t twice = 0;
+        for (unsigned number = 0; number < NUMBERS; number++) {
+          const uint32_t positions = board.numbers[Index(number, band)];
+          twice |= once & positions;
+          once |= positions;
+        }
+        if ((unsolved & ~once) != 0)
+          return false;
+        uint32_t singles = unsolved & ~twice;
+        if (singles == 0)
+          continue;
+        placed = true;
+        // Placing an earlier single can remove the only candidate of a later
+        // one, which the next pass finds as a square without candidates.
+        for (unsigned number = 0; number < NUMBERS && singles != 0; number++) {
+          const uint32_t found = board.numbers[Index(number, band)] & singles;
+          singles &= ~found;
+          for (uint32_t rest = found; rest != 0; rest &= rest - 1) {
+            const unsigned bit = static_cast<unsigned>(std::countr_zero(rest));
+            if (((board.numbers[Index(number, band)] >> bit) & 1u) != 0)
+              Place(board, band, bit, number);
+          }
+          // The other numbers weren't possible in the squares.
+          if (found != 0)
+            dirty_ |= 1u << number;
+        }
+      }
+      if (placed)
+        continue;
+      // Naked singles never place a number twice in a block.
+      if ((board.unsolved[0] | board.unsolved[1] | board.unsolved[2]) == 0)
+        return true;
+
+      // Only the numbers that lost a position can have new hidden singles.
+      const uint32_t dirty = dirty_;
+      dirty_ = 0;
+      for (uint32_t rest = dirty; rest != 0; rest &= rest - 1) {
+        const unsigned number = static_cast<unsigned>(std::countr_zero(rest));
+        std::array<uint32_t, BANDS> hidden;
+        if (!HiddenSingles(board, number, hidden))
+          return false;
+        for (unsigned band = 0; band < BANDS; band++) {
+          for (uint32_t singles = hidden[band]; singles != 0; singles &= singles - 1) {
+            const unsigned bit = static_cast<unsigned>(std::countr_zero(singles));
+            // Found in two blocks, or removed by a placement in a peer, which
+            // leaves the block without a position.
+            if (((board.unsolved[band] >> bit) & 1u) == 0)
+              continue;
+            if (((board.numbers[Index(number, band)] >> bit) & 1u) == 0)
+              return false;
+            dirty_ |= Candidates(board, band, bit);
+            Place(board, band, bit, number);
+            placed = true;
+          }
+        }
+      }
+      if (!placed)
+        return true;
+    }
+  }
+
+  // Branch on an unsolved square with the fewest candidates, return true once
+  // the limit of solutions is reached.
+  bool Branch(unsigned depth) {
+    nodes++;
+    const Board &board = stack_[depth];
+    if ((board.unsolved[0] | board.unsolved[1] | board.unsolved[2]) == 0) {
+      if (count_ == 0)
+        solution_ = board;
+      return ++count_ >= limit_;
+    }
+
+    // After the propagation, every unsolved square has at least two
+    // candidates, so any square with two is the best.
+    unsigned best_band = 0;
+    unsigned best_bit = 0;
+    unsigned best_count = NUMBERS + 1;
+    for (unsigned band = 0; band < BANDS && best_count > 2; band++) {
+      const uint32_t unsolved = board.unsolved[band];
+      if (unsolved == 0)
+        continue;
+      uint32_t once = 0;
+      uint32_t twice = 0;
+      uint32_t thrice = 0;
+      for (unsigned number = 0; number < NUMBERS; number++) {
+        const uint32_t positions = board.numbers[Index(number, band)];
+        thrice |= twice & positions;
+        twice |= once & positions;
+        once |= positions;
+      }
+      const uint32_t pairs = unsolved & ~thrice;
+      if (pairs != 0) {
+        best_band = band;
+        best_bit = static_cast<unsigned>(std::countr_zero(pairs));
+        best_count = 2;
+        break;
+      }
+      for (uint32_t rest = unsolved; rest != 0; rest &= rest - 1) {
+        const unsigned bit = static_cast<unsigned>(std::countr_zero(rest));
+        unsigned count = 0;
+        for (unsigned number = 0; number < NUMBERS; number++) {
+          count += (board.numbers[Index(number, band)] >> bit) & 1u;
+        }
+        if (count < best_count) {
+          best_band = band;
+          best_bit = bit;
+          best_count = count;
+        }
+      }
+    }
+
+    for (unsigned number = 0; number < NUMBERS; number++) {
+      if (((board.numbers[Index(number, best_band)] >> best_bit) & 1u) == 0)
+        continue;
+      Board &next = stack_[depth + 1];
+      next = board;
+      // The node was propagated, so only the numbers of the square changed.
+      dirty_ = Candidates(next, best_band, best_bit);
+      Place(next, best_band, best_bit, number);
+      if (Propagate(next) && Branch(depth + 1))
+        return true;
+    }
+    return false;
+  }
+
+  // Killer cages of the current search, if any, are handled by the generic
+  // engine.
+  SearchEngine<9, 81> generic_;
+  bool caged_ = false;
+  // States of the nodes on the current search path, indexed by depth, each
+  // level solves at least one square.
+  std::array<Board, CELLS + 1> stack_;
+  // Squares with a single candidate in the puzzle, the last one is scratch.
+  std::array<uint8_t, CELLS + 1> givens_;
+  // Numbers that lost a position since their hidden singles were collected.
+  uint32_t dirty_ = 0;
+  Board solution_;
+  uint64_t count_ = 0;
+  uint64_t limit_ = 0;
+};
+
+std::unique_ptr<BacktrackingSolver::Engine> MakeEngine(unsigned size, SudokuTypes type) {
+  auto layout = sudoku::SudokuLayout::Get(size, type);
+  if (size == 9 && type == BASIC)
+    return std::make_unique<BasicEngine>(*layout);
+  if (size <= 9)
+    return std::make_unique<SearchEngine<9, 81>>(*layout, size, type);
+  if (size <= 16)
+    return std::make_unique<SearchEngine<16, 256>>(*layout, size, type);
+  if (size <= 32)
+    return std::make_unique<SearchEngine<32, 1024>>(*layout, size, type);
+  if (size <= 64)
+    return std::make_unique<SearchEngine<64, 4096>>(*layout, size, type);
+  throw std::out_of_range("Backtracking supports puzzles of size up to 64.");
+}
+
+} // namespace
+
+BacktrackingSolver::BacktrackingSolver(unsigned size, SudokuTypes type) : engine_(MakeEngine(size, type)) {}
+
+BacktrackingSolver::~BacktrackingSolver() = default;
+
+bool BacktrackingSolver::Solve(sudoku::Sudoku &sudoku) {
+  if (CountSolutions(sudoku, 1) == 0)
+    return false;
+  auto grid = sudoku.Grid();
+  for (unsigned cell = 0; cell < sudoku.Size() * sudoku.Size(); cell++) {
+    grid[cell] = engine_->Solution(cell);
+  }
+  return true;
+}
+
+uint64_t BacktrackingSolver::CountSolutions(const sudoku::Sudoku &sudoku, uint64_t limit) {
+  if (sudoku.Size() != engine_->size || sudoku.Type() != engine_->type)
+    throw std::invalid_argument("Puzzle doesn't match the size and type of the solver.");
+  return engine_->Search(sudoku.Data(), sudoku.KillerBlocks(), limit);
+}
+
+uint64_t BacktrackingSolver::Nodes() const { return engine_->nodes; }
+
+uint64_t CountSolutions(const sudoku::Sudoku &sudoku, uint64_t limit) {
+  thread_local std::map<std::pair<unsigned, SudokuTypes>, std::unique_ptr<BacktrackingSolver>> solvers;
+  auto &solver = solvers[{sudoku.Size(), sudoku.Type()}];
+  if (!solver)
+    solver = std::make_unique<BacktrackingSolver>(sudoku.Size(), sudoku.Type());
+  return solver->CountSolutions(sudoku, limit);
+}
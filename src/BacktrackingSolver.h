@@ -0,0 +1,73 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_BACKTRACKINGSOLVER_H
+#define SUDOKU_BACKTRACKINGSOLVER_H
+
+#include "Sudoku.h"
+#include <cstdint>
+#include <memory>
+
+/*! Depth first search for the solutions of a puzzle.
+ *
+ * Unlike SmartSolver, this solver guesses. It starts from the current
+ * candidates of a puzzle, e.g. where SmartSolver gave up, and at each node of
+ * the search propagates naked and hidden singles over the blocks of the
+ * layout and then branches on the unsolved square with the fewest
+ * candidates. Killer cages of the puzzle are enforced as well.
+ *
+ * The candidates are kept as one bitboard over the squares per number and a
+ * mask of the numbers per square, so a node of the search is a plain copy of
+ * a few bitmasks and the search itself doesn't allocate once the solver is
+ * warmed up. Basic 9x9 puzzles without killer cages, the common case, have a
+ * search of their own, with the bitboards split into bands of three rows and
+ * the tables of the root state precomputed.
+ *
+ * The solver is not thread safe, each thread should use its own.
+ */
+class BacktrackingSolver {
+public:
+  /*! Construct a solver for the puzzles of the given size and type.
+   *
+   * @param size Size of the puzzles, at most 64.
+   * @param type Type of the puzzles.
+   */
+  explicit BacktrackingSolver(unsigned size = 9, SudokuTypes type = BASIC);
+  ~BacktrackingSolver();
+
+  BacktrackingSolver(const BacktrackingSolver &) = delete;
+  BacktrackingSolver &operator=(const BacktrackingSolver &) = delete;
+
+  /*! Solve the puzzle, starting from its current candidates.
+   *
+   * @return Whether a solution exists, if it does, the puzzle is set to the
+   *         first solution found, otherwise the puzzle is left unmodified.
+   */
+  bool Solve(sudoku::Sudoku &sudoku);
+
+  /*! Count the solutions of the puzzle, starting from its current candidates.
+   *
+   * @param limit Stop searching once this many solutions were found.
+   * @return Number of solutions, at most limit.
+   */
+  uint64_t CountSolutions(const sudoku::Sudoku &sudoku, uint64_t limit);
+
+  //! Return the number of search nodes visited by the last call.
+  uint64_t Nodes() const;
+
+  class Engine;
+
+private:
+  std::unique_ptr<Engine> engine_;
+};
+
+/*! Count the solutions of the puzzle, starting from its current candidates.
+ *
+ * Meant for checking that a puzzle has a unique solution, the search stops
+ * once limit solutions were found. Uses a solver cached per thread, so
+ * repeated calls don't rebuild the search tables.
+ *
+ * @return Number of solutions, at most limit.
+ */
+uint64_t CountSolutions(const sudoku::Sudoku &sudoku, uint64_t limit = 2);
+
+#endif // SUDOKU_BACKTRACKINGSOLVER_H
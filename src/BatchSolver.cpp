@@ -0,0 +1,212 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "BatchSolver.h"
+#include "SmartSolver.h"
+#include "core/GridParser.h"
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Range of chunks owned by a single worker. The owner consumes chunks from the
+// front of the range, other workers steal them from the back.
+struct WorkQueue {
+  std::mutex lock;
+  size_t begin = 0;
+  size_t end = 0;
+
+  bool PopFront(size_t &chunk) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (begin == end)
+      return false;
+    chunk = begin++;
+    return true;
+  }
+
+  bool PopBack(size_t &chunk) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (begin == end)
+      return false;
+    chunk = --end;
+    return true;
+  }
+};
+
+bool MatchesSolution(const sudoku::Sudoku &s, std::string_view solution) {
+  return sudoku::MatchesGrid(solution, s.Size(), s.Data());
+}
+
+// Write the final state of the puzzle, see BatchSolver::Solve.
+void WriteGrid(const sudoku::Sudoku &s, bool solved, std::string &grid) {
+  if (!solved || s.Size() > sudoku::MAX_GRID_NUMBER) {
+    grid = s.Serialize();
+    return;
+  }
+  grid.clear();
+  for (unsigned i = 0; i < s.Size() * s.Size(); i++) {
+    unsigned value = s.Data()[i].SingletonValue();
+    grid += static_cast<char>(value < 10 ? '0' + value : 'A' + value - 10);
+  }
+}
+
+// Read the puzzle in its format, return false if it is malformed.
+bool LoadPuzzle(const BatchPuzzle &puzzle, sudoku::Sudoku &s) {
+  if (puzzle.format == PuzzleFormat::TEXT)
+    return sudoku::ReadPuzzle(puzzle.puzzle, s) != 0;
+  try {
+    s.DeserializeBinary(puzzle.puzzle);
+  } catch (const std::exception &) {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+BatchSolver::BatchSolver(unsigned threads, unsigned size, SudokuTypes type,
+                         ScheduleMode mode, bool backtrack)
+    : threads_(threads), size_(size), type_(type), mode_(mode),
+      backtrack_(backtrack) {
+  if (threads_ == 0)
+    threads_ = std::max(1u, std::thread::hardware_concurrency());
+  schedulers_.assign(threads_, TechniqueScheduler(mode_));
+  fallbacks_.resize(threads_);
+}
+
+BatchOutcome BatchSolver::SolveOne(const BatchPuzzle &puzzle,
+                                   SolveStats &stats,
+                                   TechniqueScheduler &scheduler,
+                                   Fallbacks *fallbacks,
+                                   std::string *grid) const {
+  sudoku::Sudoku s(size_, type_);
+  if (!LoadPuzzle(puzzle, s)) {
+    if (grid != nullptr)
+      grid->clear();
+    return BatchOutcome::UNSOLVED;
+  }
+
+  SolveStats puzzle_stats;
+  bool solved = SmartSolver::Solve(s, puzzle_stats, scheduler);
+  bool searched = false;
+  if (solved) {
+    stats += puzzle_stats;
+  } else {
+    // The time spent on unsolved puzzles still counts.
+    for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+      stats.techniques[i] += puzzle_stats.techniques[i];
+    }
+    if (fallbacks != nullptr) {
+      auto &fallback = (*fallbacks)[{s.Size(), s.Type()}];
+      if (!fallback)
+        fallback = std::make_unique<BacktrackingSolver>(s.Size(), s.Type());
+      searched = fallback->Solve(s);
+    }
+  }
+  if (grid != nullptr)
+    WriteGrid(s, solved || searched, *grid);
+
+  if (!solved && !searched)
+    return BatchOutcome::UNSOLVED;
+  if (!puzzle.solution.empty() && !MatchesSolution(s, puzzle.solution))
+    return BatchOutcome::INCORRECT;
+  return searched ? BatchOutcome::SEARCHED : BatchOutcome::SOLVED;
+}
+
+unsigned BatchSolver::Workers(size_t count) const {
+  const size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  return static_cast<unsigned>(std::min<size_t>(threads_, std::max<size_t>(chunks, 1)));
+}
+
+void BatchSolver::ForEach(size_t count, unsigned workers,
+                          const std::function<void(unsigned, size_t)> &work) const {
+  const size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  std::vector<WorkQueue> queues(workers);
+  for (unsigned w = 0; w < workers; w++) {
+    queues[w].begin = chunks * w / workers;
+    queues[w].end = chunks * (w + 1) / workers;
+  }
+
+  auto worker = [&](unsigned id) {
+    auto next = [&](size_t &chunk) {
+      if (queues[id].PopFront(chunk))
+        return true;
+      for (unsigned i = 1; i < workers; i++) {
+        if (queues[(id + i) % workers].PopBack(chunk))
+          return true;
+      }
+      return false;
+    };
+
+    size_t chunk = 0;
+    while (next(chunk)) {
+      size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+      for (size_t i = chunk * CHUNK_SIZE; i < end; i++) {
+        work(id, i);
+      }
+    }
+  };
+
+  if (workers == 1) {
+    worker(0);
+  } else {
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (unsigned w = 0; w < workers; w++) {
+      pool.emplace_back(worker, w);
+    }
+    for (auto &t : pool) {
+      t.join();
+    }
+  }
+}
+
+BatchResult BatchSolver::Solve(std::span<const BatchPuzzle> puzzles) const {
+  return Solve(puzzles, {});
+}
+
+BatchResult BatchSolver::Solve(std::span<const BatchPuzzle> puzzles, std::span<std::string> grids) const {
+  BatchResult result;
+  result.outcomes.resize(puzzles.size(), BatchOutcome::UNSOLVED);
+
+  const unsigned workers = Workers(puzzles.size());
+  std::vector<SolveStats> stats(workers);
+
+  std::lock_guard lock(mutex_);
+  ForEach(puzzles.size(), workers, [&](unsigned id, size_t i) {
+    result.outcomes[i] = SolveOne(puzzles[i], stats[id], schedulers_[id], backtrack_ ? &fallbacks_[id] : nullptr,
+                                  grids.empty() ? nullptr : &grids[i]);
+  });
+
+  for (auto &s : stats) {
+    result.stats += s;
+  }
+  for (auto outcome : result.outcomes) {
+    if (outcome != BatchOutcome::UNSOLVED)
+      result.solved++;
+    if (outcome == BatchOutcome::INCORRECT)
+      result.incorrect++;
+    if (outcome == BatchOutcome::SEARCHED)
+      result.searched++;
+  }
+  return result;
+}
+
+void BatchSolver::Rate(std::span<const BatchPuzzle> puzzles, std::span<PuzzleRating> ratings) const {
+  ForEach(puzzles.size(), Workers(puzzles.size()), [&](unsigned, size_t i) {
+    const BatchPuzzle &puzzle = puzzles[i];
+    sudoku::Sudoku s(size_, type_);
+    if (!LoadPuzzle(puzzle, s)) {
+      ratings[i] = PuzzleRating();
+      return;
+    }
+    SolveStats stats;
+    bool solved = SmartSolver::Solve(s, stats);
+    if (solved && !puzzle.solution.empty() && !MatchesSolution(s, puzzle.solution))
+      solved = false;
+    ratings[i] = PuzzleRating(stats, solved);
+  });
+}
@@ -0,0 +1,144 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_BATCHSOLVER_H
+#define SUDOKU_BATCHSOLVER_H
+
+#include "BacktrackingSolver.h"
+#include "SolveStats.h"
+#include "Sudoku.h"
+#include "TechniqueScheduler.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! TEXT puzzles are read by ReadPuzzle, BINARY ones by Sudoku::DeserializeBinary.
+enum class PuzzleFormat : uint8_t { TEXT, BINARY };
+
+//! A single puzzle of a batch, optionally accompanied by the expected solution.
+struct BatchPuzzle {
+  std::string_view puzzle;
+  //! Expected solution, empty if not known.
+  std::string_view solution;
+  PuzzleFormat format = PuzzleFormat::TEXT;
+};
+
+//! SEARCHED puzzles were solved correctly, but only by the backtracking fallback.
+enum class BatchOutcome : uint8_t { UNSOLVED, SOLVED, INCORRECT, SEARCHED };
+
+struct BatchResult {
+  //! Outcome for each of the input puzzles, in input order.
+  std::vector<BatchOutcome> outcomes;
+  //! Merged stats of all solved puzzles, the technique counters include the
+  //! unsolved puzzles.
+  SolveStats stats;
+  uint64_t solved = 0;
+  uint64_t incorrect = 0;
+  //! Solved puzzles that needed the backtracking fallback, included in solved.
+  uint64_t searched = 0;
+};
+
+/*! Solves batches of independent puzzles on a work-stealing pool of threads.
+ *
+ * Each worker owns a contiguous range of chunks of the input and steals chunks
+ * from the back of other workers once it runs out of work. Every worker keeps
+ * its own SolveStats, which are merged once the batch is done. Since each
+ * puzzle is solved independently and the stats are plain counters, the result
+ * does not depend on the number of threads or the scheduling order.
+ *
+ * In the adaptive schedule mode, every worker learns its own technique order
+ * over the puzzles it solves, across all batches solved by the same
+ * BatchSolver, so both the stats and the set of solved puzzles can differ
+ * between runs. Use the reference mode for reproducible results.
+ *
+ * With the backtracking fallback, puzzles that SmartSolver can't finish are
+ * completed by BacktrackingSolver from the state SmartSolver stopped in. Their
+ * technique counters are still merged like for any other unsolved puzzle.
+ *
+ * Rating a batch keeps the stats of each puzzle apart instead of merging them.
+ */
+class BatchSolver {
+public:
+  /*! Construct a batch solver.
+   *
+   * @param threads Number of worker threads, 0 to use all hardware threads.
+   * @param size Size of the puzzles in the batch.
+   * @param type Type of the puzzles in the batch.
+   * @param mode Order in which the techniques are tried.
+   * @param backtrack Whether to complete the unsolved puzzles by backtracking.
+   */
+  explicit BatchSolver(unsigned threads = 0, unsigned size = 9,
+                       SudokuTypes type = BASIC,
+                       ScheduleMode mode = ScheduleMode::REFERENCE,
+                       bool backtrack = false);
+
+  //! Solve all puzzles in the batch.
+  BatchResult Solve(std::span<const BatchPuzzle> puzzles) const;
+
+  /*! Solve all puzzles in the batch and keep the state each one ended in.
+   *
+   * @param grids Receives, in input order, the values of the squares of each
+   *              solved puzzle, one character per square, the remaining
+   *              candidates of each unsolved one in the Sudoku::Serialize form
+   *              and an empty string for the puzzles that can't be read. Solved
+   *              puzzles larger than 35x35 are in the Serialize form as well,
+   *              since their numbers have no square characters. Must be at
+   *              least as long as the batch, the strings are reused.
+   */
+  BatchResult Solve(std::span<const BatchPuzzle> puzzles, std::span<std::string> grids) const;
+
+  /*! Rate all puzzles in the batch.
+   *
+   * The puzzles are solved in the reference order regardless of the schedule
+   * mode, so that the ratings don't depend on the other puzzles, and without
+   * the backtracking fallback. A puzzle counts as solved only if its solution,
+   * when known, matches.
+   *
+   * @param ratings Receives the rating of each puzzle, in input order, must be
+   *                at least as long as the batch.
+   */
+  void Rate(std::span<const BatchPuzzle> puzzles, std::span<PuzzleRating> ratings) const;
+
+  //! Return the number of worker threads used.
+  unsigned Threads() const { return threads_; }
+
+  //! Return whether unsolved puzzles are completed by backtracking.
+  bool Backtracks() const { return backtrack_; }
+
+  //! Number of puzzles in a single unit of work.
+  static constexpr size_t CHUNK_SIZE = 64;
+
+private:
+  // Backtracking solvers of a worker, one for each size and type it met,
+  // since binary puzzles carry their own size and type.
+  using Fallbacks = std::map<std::pair<unsigned, SudokuTypes>, std::unique_ptr<BacktrackingSolver>>;
+
+  unsigned threads_;
+  unsigned size_;
+  SudokuTypes type_;
+  ScheduleMode mode_;
+  bool backtrack_;
+
+  // Scheduler and fallbacks of each worker, kept across batches, so that
+  // neither the adaptive order nor the search tables are rebuilt per batch.
+  // Concurrent batches are serialized on the mutex.
+  mutable std::mutex mutex_;
+  mutable std::vector<TechniqueScheduler> schedulers_;
+  mutable std::vector<Fallbacks> fallbacks_;
+
+  // Number of workers for a batch of count puzzles.
+  unsigned Workers(size_t count) const;
+  // Call work(worker, index) for each index of the batch on the pool.
+  void ForEach(size_t count, unsigned workers, const std::function<void(unsigned, size_t)> &work) const;
+
+  BatchOutcome SolveOne(const BatchPuzzle &puzzle, SolveStats &stats,
+                        TechniqueScheduler &scheduler,
+                        Fallbacks *fallbacks, std::string *grid) const;
+};
+
+#endif // SUDOKU_BATCHSOLVER_H
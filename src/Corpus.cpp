@@ -0,0 +1,357 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "Corpus.h"
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct IndexHeader {
+  char magic[8];
+  uint64_t file_size;
+  int64_t modified;
+  uint64_t records;
+};
+
+constexpr char INDEX_MAGIC[8] = {'S', 'D', 'K', 'I', 'D', 'X', '0', '1'};
+
+struct BinaryHeader {
+  char magic[8];
+  uint64_t records;
+  uint64_t table;
+};
+
+constexpr char BINARY_MAGIC[8] = {'S', 'D', 'K', 'B', 'I', 'N', '0', '1'};
+
+int64_t ModificationTime(const std::string &filename) {
+  std::error_code ec;
+  auto time = std::filesystem::last_write_time(filename, ec);
+  if (ec)
+    return 0;
+  return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+// Puzzles use digits, upper case letters for values above 9 and '.' or '*'
+// for empty squares.
+bool IsPuzzleCharacter(char c) {
+  return isdigit(static_cast<unsigned char>(c)) ||
+         isupper(static_cast<unsigned char>(c)) || c == '.' || c == '*';
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string &filename) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  file_ = file;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    Close();
+    return;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+  open_ = true;
+  if (size_ == 0)
+    return;
+  mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ == nullptr) {
+    Close();
+    return;
+  }
+  data_ = static_cast<const char *>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr)
+    Close();
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return;
+  }
+  size_ = static_cast<size_t>(info.st_size);
+  open_ = true;
+  if (size_ != 0) {
+    void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      open_ = false;
+      size_ = 0;
+    } else {
+      data_ = static_cast<const char *>(data);
+    }
+  }
+  close(fd);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      open_(std::exchange(other.open_, false))
+#ifdef _WIN32
+      ,
+      file_(std::exchange(other.file_, nullptr)),
+      mapping_(std::exchange(other.mapping_, nullptr))
+#endif
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    Close();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    open_ = std::exchange(other.open_, false);
+#ifdef _WIN32
+    file_ = std::exchange(other.file_, nullptr);
+    mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+void MappedFile::Close() noexcept {
+#ifdef _WIN32
+  if (data_ != nullptr)
+    UnmapViewOfFile(data_);
+  if (mapping_ != nullptr)
+    CloseHandle(mapping_);
+  if (file_ != nullptr)
+    CloseHandle(file_);
+  mapping_ = nullptr;
+  file_ = nullptr;
+#else
+  if (data_ != nullptr)
+    munmap(const_cast<char *>(data_), size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  open_ = false;
+}
+
+Corpus::Corpus(const std::string &filename, IndexMode mode)
+    : file_(filename) {
+  if (!file_.IsOpen())
+    return;
+
+  if (LoadIndex(filename))
+    return;
+
+  BuildIndex();
+  if (mode == SIDECAR)
+    SaveIndex(filename);
+}
+
+bool Corpus::LoadIndex(const std::string &filename) {
+  MappedFile index(IndexFilename(filename));
+  if (!index.IsOpen() || index.Size() < sizeof(IndexHeader))
+    return false;
+
+  IndexHeader header;
+  memcpy(&header, index.Data(), sizeof(header));
+  // Counted from the size of the index, so that no records count overflows.
+  const uint64_t entries = (index.Size() - sizeof(IndexHeader)) / sizeof(uint64_t);
+  if (memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+      header.file_size != file_.Size() ||
+      header.modified != ModificationTime(filename) ||
+      (index.Size() - sizeof(IndexHeader)) % sizeof(uint64_t) != 0 ||
+      entries == 0 || header.records != entries - 1)
+    return false;
+
+  std::span<const uint64_t> offsets(
+      static_cast<const uint64_t *>(static_cast<const void *>(
+          index.Data() + sizeof(IndexHeader))),
+      entries);
+  // Non-empty records in order, ending exactly at the end of the file.
+  for (size_t i = 1; i < offsets.size(); i++) {
+    if (offsets[i] <= offsets[i - 1])
+      return false;
+  }
+  if (offsets.back() != file_.Size())
+    return false;
+
+  index_file_ = std::move(index);
+  index_ = offsets;
+  return true;
+}
+
+void Corpus::BuildIndex() {
+  const char *data = file_.Data();
+  const size_t size = file_.Size();
+
+  size_t pos = 0;
+  // Skip the header line.
+  if (size > 0 && !IsPuzzleCharacter(data[0])) {
+    const void *eol = memchr(data, '\n', size);
+    pos = eol == nullptr ? size : static_cast<size_t>(static_cast<const char *>(eol) - data) + 1;
+  }
+
+  offsets_.clear();
+  while (pos < size) {
+    const void *eol = memchr(data + pos, '\n', size - pos);
+    size_t next = eol == nullptr ? size : static_cast<size_t>(static_cast<const char *>(eol) - data) + 1;
+    // Skip empty lines.
+    if (next - pos > 1 && !(next - pos == 2 && data[pos] == '\r'))
+      offsets_.push_back(pos);
+    pos = next;
+  }
+  offsets_.push_back(size);
+  index_ = offsets_;
+}
+
+void Corpus::SaveIndex(const std::string &filename) const {
+  IndexHeader header;
+  memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header.file_size = file_.Size();
+  header.modified = ModificationTime(filename);
+  header.records = Size();
+
+  std::ofstream f(IndexFilename(filename), std::ios::binary | std::ios::trunc);
+  f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  f.write(reinterpret_cast<const char *>(offsets_.data()),
+          static_cast<std::streamsize>(offsets_.size() * sizeof(uint64_t)));
+}
+
+std::string_view Corpus::Line(size_t record) const {
+  size_t begin = index_[record];
+  size_t end = index_[record + 1];
+  std::string_view line(file_.Data() + begin, end - begin);
+  // The next record starts after the line terminator.
+  size_t eol = line.find('\n');
+  if (eol != std::string_view::npos)
+    line = line.substr(0, eol);
+  if (!line.empty() && line.back() == '\r')
+    line.remove_suffix(1);
+  return line;
+}
+
+BatchPuzzle Corpus::Puzzle(size_t record) const {
+  return SplitRecord(Line(record));
+}
+
+bool Corpus::IsHeader(std::string_view line) {
+  return !line.empty() && !IsPuzzleCharacter(line[0]);
+}
+
+BatchPuzzle Corpus::SplitRecord(std::string_view line) {
+  size_t comma = line.find(',');
+  if (comma == std::string_view::npos)
+    return {line, {}};
+  return {line.substr(0, comma), line.substr(comma + 1)};
+}
+
+size_t Corpus::ReadRecords(std::istream &input, std::span<std::string> lines, bool &first) {
+  size_t count = 0;
+  while (count < lines.size() && std::getline(input, lines[count])) {
+    std::string &line = lines[count];
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (std::exchange(first, false) && IsHeader(line))
+      continue;
+    count++;
+  }
+  return count;
+}
+
+BinaryCorpus::BinaryCorpus(const std::string &filename) : file_(filename) {
+  if (!file_.IsOpen() || file_.Size() < sizeof(BinaryHeader))
+    return;
+
+  BinaryHeader header;
+  memcpy(&header, file_.Data(), sizeof(header));
+  const uint64_t size = file_.Size();
+  if (memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+      header.table % sizeof(uint64_t) != 0 || header.table > size ||
+      (size - header.table) / sizeof(uint64_t) != 2 * header.records + 1 ||
+      (size - header.table) % sizeof(uint64_t) != 0)
+    return;
+
+  std::span<const uint64_t> index(
+      static_cast<const uint64_t *>(
+          static_cast<const void *>(file_.Data() + header.table)),
+      2 * header.records + 1);
+  // Records in order, between the header and the table.
+  uint64_t previous = sizeof(BinaryHeader);
+  for (auto offset : index) {
+    if (offset < previous || offset > header.table)
+      return;
+    previous = offset;
+  }
+  index_ = index;
+}
+
+BatchPuzzle BinaryCorpus::Puzzle(size_t record) const {
+  const char *data = file_.Data();
+  uint64_t puzzle = index_[2 * record];
+  uint64_t solution = index_[2 * record + 1];
+  uint64_t end = index_[2 * record + 2];
+  return {std::string_view(data + puzzle, solution - puzzle),
+          std::string_view(data + solution, end - solution),
+          PuzzleFormat::BINARY};
+}
+
+bool BinaryCorpus::IsBinary(const std::string &filename) {
+  std::ifstream f(filename, std::ios::binary);
+  char magic[sizeof(BINARY_MAGIC)] = {};
+  f.read(magic, sizeof(magic));
+  return f && memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+BinaryCorpusWriter::BinaryCorpusWriter(const std::string &filename)
+    : file_(filename, std::ios::binary | std::ios::trunc),
+      end_(sizeof(BinaryHeader)) {
+  // Without the magic until the table is written.
+  BinaryHeader header = {};
+  file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void BinaryCorpusWriter::Add(const sudoku::Sudoku &puzzle,
+                             std::string_view solution) {
+  record_.clear();
+  puzzle.SerializeBinary(record_);
+  offsets_.push_back(end_);
+  offsets_.push_back(end_ + record_.size());
+  record_ += solution;
+  file_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+  end_ += record_.size();
+}
+
+bool BinaryCorpusWriter::Close() {
+  BinaryHeader header;
+  memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  header.records = offsets_.size() / 2;
+  header.table = (end_ + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+
+  offsets_.push_back(end_);
+  const char padding[sizeof(uint64_t)] = {};
+  file_.write(padding, static_cast<std::streamsize>(header.table - end_));
+  file_.write(reinterpret_cast<const char *>(offsets_.data()),
+              static_cast<std::streamsize>(offsets_.size() * sizeof(uint64_t)));
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file_.close();
+  return !file_.fail();
+}
@@ -0,0 +1,165 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_CORPUS_H
+#define SUDOKU_CORPUS_H
+
+#include "BatchSolver.h"
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &filename);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  bool IsOpen() const { return open_; }
+  const char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+private:
+  void Close() noexcept;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  bool open_ = false;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+};
+
+/*! Memory mapped corpus of "puzzle,solution" records, one per line.
+ *
+ * The byte offsets of all records are kept in an index, which makes it
+ * possible to jump to any record in O(1). The index is either read from a
+ * sidecar file (filename + ".idx"), when a valid one exists, or built by
+ * scanning the mapped file. A leading header line (anything not starting
+ * with a digit, upper case letter, '.' or '*') is skipped.
+ */
+class Corpus {
+public:
+  enum IndexMode {
+    //! Reuse a valid sidecar index, otherwise build the index in memory.
+    IN_MEMORY,
+    //! Reuse a valid sidecar index, otherwise build it and save it.
+    SIDECAR
+  };
+
+  explicit Corpus(const std::string &filename, IndexMode mode = IN_MEMORY);
+
+  //! Return whether the corpus file was successfully opened.
+  bool IsOpen() const { return file_.IsOpen(); }
+  //! Return whether the index was loaded from a sidecar file.
+  bool IndexFromSidecar() const { return index_file_.IsOpen(); }
+
+  //! Return the number of records in the corpus.
+  size_t Size() const { return index_.empty() ? 0 : index_.size() - 1; }
+
+  //! Return the record as a single line, without the line terminator.
+  std::string_view Line(size_t record) const;
+  //! Return the record split into the puzzle and the solution.
+  BatchPuzzle Puzzle(size_t record) const;
+
+  //! Return whether the first line of a corpus is a header rather than a record.
+  static bool IsHeader(std::string_view line);
+  //! Split a record into the puzzle and the solution.
+  static BatchPuzzle SplitRecord(std::string_view line);
+  /*! Read the next records of a corpus stream, one per line.
+   *
+   * Line endings are stripped and a header on the first line of the stream
+   * is skipped.
+   *
+   * @param lines Filled with up to lines.size() records.
+   * @param first Whether the next line is the first one of the stream, reset
+   *        once it was read.
+   * @return Number of records read, 0 at the end of the stream.
+   */
+  static size_t ReadRecords(std::istream &input, std::span<std::string> lines, bool &first);
+
+  //! Return the name of the sidecar index file for a corpus file.
+  static std::string IndexFilename(const std::string &filename) {
+    return filename + ".idx";
+  }
+
+private:
+  MappedFile file_;
+  MappedFile index_file_;
+  std::vector<uint64_t> offsets_;
+  // Record start offsets, followed by the end of the data.
+  std::span<const uint64_t> index_;
+
+  bool LoadIndex(const std::string &filename);
+  void BuildIndex();
+  void SaveIndex(const std::string &filename) const;
+};
+
+/*! Memory mapped corpus of puzzles in the binary form of
+ * Sudoku::SerializeBinary.
+ *
+ * The file starts with a header (magic, number of records and the offset of
+ * the table), followed by the records and the table. Each record is the
+ * binary puzzle followed by the solution as text, possibly empty. The table
+ * holds the byte offsets of the puzzle and of the solution of each record,
+ * followed by the end of the last record, in native byte order. The table is
+ * used in place, so opening the corpus doesn't read the records and loading
+ * a puzzle doesn't parse any text.
+ */
+class BinaryCorpus {
+public:
+  explicit BinaryCorpus(const std::string &filename);
+
+  //! Return whether the file was opened and has a valid header and table.
+  bool IsOpen() const { return !index_.empty(); }
+
+  //! Return the number of records in the corpus.
+  size_t Size() const { return index_.empty() ? 0 : index_.size() / 2; }
+
+  //! Return the record, the puzzle in the binary format.
+  BatchPuzzle Puzzle(size_t record) const;
+
+  //! Return whether the file starts with the header of a binary corpus.
+  static bool IsBinary(const std::string &filename);
+
+private:
+  MappedFile file_;
+  std::span<const uint64_t> index_;
+};
+
+//! Writes a BinaryCorpus file, one record at a time.
+class BinaryCorpusWriter {
+public:
+  explicit BinaryCorpusWriter(const std::string &filename);
+
+  //! Return whether the file was successfully opened.
+  bool IsOpen() const { return file_.is_open(); }
+
+  //! Append a puzzle, with its solution as text if known.
+  void Add(const sudoku::Sudoku &puzzle, std::string_view solution = {});
+
+  /*! Write the table and the header, the file is not recognized as a binary
+   * corpus before that.
+   *
+   * @return Whether the file was written successfully.
+   */
+  bool Close();
+
+private:
+  std::ofstream file_;
+  // Offsets of the puzzle and solution of each record.
+  std::vector<uint64_t> offsets_;
+  uint64_t end_;
+  std::string record_;
+};
+
+#endif // SUDOKU_CORPUS_H
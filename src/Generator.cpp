@@ -0,0 +1,237 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "Generator.h"
+#include "SmartSolver.h"
+#include "core/GridParser.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+char SquareChar(unsigned value) {
+  return static_cast<char>(value < 10 ? '0' + value : 'A' + value - 10);
+}
+
+// The generated puzzles and solutions are text grids, past 'Z' the
+// characters would alias other squares.
+void RequireGridText(unsigned size) {
+  if (size > sudoku::MAX_GRID_NUMBER)
+    throw std::invalid_argument("Only puzzles up to 35x35 have a text grid.");
+}
+
+std::string Squares(const sudoku::Sudoku &s) {
+  std::string result;
+  result.reserve(s.Size() * s.Size());
+  for (unsigned i = 0; i < s.Size() * s.Size(); i++) {
+    result += SquareChar(s.Data()[i].HasSingletonValue() ? s.Data()[i].SingletonValue() : 0);
+  }
+  return result;
+}
+
+// Orders in which the givens are put back into a puzzle that is too hard.
+constexpr unsigned GIVEN_ORDERS = 4;
+
+} // namespace
+
+Generator::Generator(unsigned threads, unsigned size, SudokuTypes type)
+    : threads_(threads), size_(size), type_(type) {
+  if (threads_ == 0)
+    threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::string Generator::RandomSolution(std::mt19937_64 &rng, BacktrackingSolver &solver) const {
+  RequireGridText(size_);
+  const unsigned cells = size_ * size_;
+  std::uniform_int_distribution<unsigned> random_cell(0, cells - 1);
+  std::uniform_int_distribution<unsigned> random_value(1, size_);
+
+  // A few random givens that still have a solution, the search then
+  // completes them into a full grid.
+  std::string grid(cells, '0');
+  sudoku::Sudoku s(size_, type_);
+  for (unsigned placed = 0; placed < size_;) {
+    unsigned cell = random_cell(rng);
+    if (grid[cell] != '0')
+      continue;
+    grid[cell] = SquareChar(random_value(rng));
+    sudoku::ReadPuzzle(grid, s);
+    if (solver.CountSolutions(s, 1) == 0) {
+      grid[cell] = '0';
+      continue;
+    }
+    placed++;
+  }
+  sudoku::ReadPuzzle(grid, s);
+  solver.Solve(s);
+  return Squares(s);
+}
+
+sudoku::Sudoku Generator::PatternSolution(std::mt19937_64 &rng) const {
+  auto layout = sudoku::SudokuLayout::Get(size_, type_);
+  if (type_ != BASIC || layout->box_rows == 0)
+    throw std::invalid_argument("Pattern solutions need a basic puzzle with boxes.");
+  const unsigned box_rows = layout->box_rows;
+  const unsigned box_cols = layout->box_cols;
+
+  // Order of the lines, shuffled inside of each group of boxes and by the
+  // whole groups.
+  auto lines = [&](unsigned box) {
+    std::vector<unsigned> groups(size_ / box);
+    std::iota(groups.begin(), groups.end(), 0u);
+    std::shuffle(groups.begin(), groups.end(), rng);
+    std::vector<unsigned> order;
+    for (auto group : groups) {
+      std::vector<unsigned> inside(box);
+      std::iota(inside.begin(), inside.end(), group * box);
+      std::shuffle(inside.begin(), inside.end(), rng);
+      order.insert(order.end(), inside.begin(), inside.end());
+    }
+    return order;
+  };
+  std::vector<unsigned> rows = lines(box_rows);
+  std::vector<unsigned> cols = lines(box_cols);
+  std::vector<unsigned> numbers(size_);
+  std::iota(numbers.begin(), numbers.end(), 1u);
+  std::shuffle(numbers.begin(), numbers.end(), rng);
+
+  sudoku::Sudoku s(size_, type_);
+  for (unsigned i = 0; i < size_; i++) {
+    for (unsigned j = 0; j < size_; j++) {
+      unsigned r = rows[i];
+      unsigned value = (box_cols * (r % box_rows) + r / box_rows + cols[j]) % size_;
+      s[i][j] = sudoku::BitSet::SingleBit(size_, numbers[value]);
+    }
+  }
+  return s;
+}
+
+std::string Generator::RemoveGivens(std::string_view solution, std::mt19937_64 &rng,
+                                    BacktrackingSolver &solver) const {
+  RequireGridText(size_);
+  std::string puzzle(solution);
+  std::vector<unsigned> order(puzzle.size());
+  std::iota(order.begin(), order.end(), 0u);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  sudoku::Sudoku s(size_, type_);
+  for (auto cell : order) {
+    char given = puzzle[cell];
+    puzzle[cell] = '0';
+    sudoku::ReadPuzzle(puzzle, s);
+    if (solver.CountSolutions(s, 2) != 1)
+      puzzle[cell] = given;
+  }
+  return puzzle;
+}
+
+Technique Generator::Rate(std::string_view puzzle) const {
+  sudoku::Sudoku s(size_, type_);
+  if (sudoku::ReadPuzzle(puzzle, s) == 0)
+    return Technique::COUNT;
+  SolveStats stats;
+  if (!SmartSolver::Solve(s, stats))
+    return Technique::COUNT;
+  return HardestTechnique(stats);
+}
+
+bool Generator::Candidate(DifficultyBand band, std::mt19937_64 &rng, BacktrackingSolver &solver,
+                          GeneratedPuzzle &result) const {
+  result.solution = RandomSolution(rng, solver);
+  result.puzzle = RemoveGivens(result.solution, rng, solver);
+  result.hardest = Rate(result.puzzle);
+  if (result.hardest <= band.hardest)
+    return band.Contains(result.hardest);
+
+  // Givens only make a puzzle easier and keep the solution unique, so bisect
+  // for the shortest prefix of the removed givens, in random order, that
+  // brings the puzzle within the band. All of them give the solution itself,
+  // which needs no technique at all. The boundary often skips over the band,
+  // in that case the givens are tried in another order.
+  const std::string minimal = result.puzzle;
+  std::vector<unsigned> removed;
+  for (unsigned cell = 0; cell < minimal.size(); cell++) {
+    if (minimal[cell] == '0')
+      removed.push_back(cell);
+  }
+  auto with_givens = [&](size_t count) {
+    std::string puzzle = minimal;
+    for (size_t i = 0; i < count; i++) {
+      puzzle[removed[i]] = result.solution[removed[i]];
+    }
+    return puzzle;
+  };
+  for (unsigned order = 0; order < GIVEN_ORDERS; order++) {
+    std::shuffle(removed.begin(), removed.end(), rng);
+    size_t low = 0;
+    size_t high = removed.size();
+    Technique hardest = Technique::SINGLES;
+    while (high - low > 1) {
+      size_t middle = low + (high - low) / 2;
+      Technique rating = Rate(with_givens(middle));
+      if (rating <= band.hardest) {
+        high = middle;
+        hardest = rating;
+      } else {
+        low = middle;
+      }
+    }
+    result.puzzle = with_givens(high);
+    result.hardest = high == removed.size() ? Rate(result.puzzle) : hardest;
+    if (band.Contains(result.hardest))
+      return true;
+  }
+  return band.Contains(result.hardest);
+}
+
+GeneratorReport Generator::Generate(uint64_t count, DifficultyBand band, uint64_t seed, const Sink &sink,
+                                    uint64_t attempts) const {
+  RequireGridText(size_);
+  auto start = std::chrono::steady_clock::now();
+  GeneratorReport report;
+  std::mutex lock;
+  std::atomic<bool> done = count == 0;
+  std::atomic<uint64_t> started = 0;
+
+  auto worker = [&](unsigned id) {
+    // seed_seq only keeps the low 32 bits of each value.
+    std::seed_seq seq{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), id};
+    std::mt19937_64 rng(seq);
+    BacktrackingSolver solver(size_, type_);
+    GeneratedPuzzle puzzle;
+    while (!done) {
+      if (attempts != 0 && started++ >= attempts)
+        break;
+      bool fits = Candidate(band, rng, solver, puzzle);
+
+      std::lock_guard<std::mutex> guard(lock);
+      report.candidates++;
+      if (!fits || done)
+        continue;
+      sink(puzzle);
+      if (++report.generated == count)
+        done = true;
+    }
+  };
+
+  if (threads_ == 1) {
+    worker(0);
+  } else {
+    std::vector<std::thread> pool;
+    pool.reserve(threads_);
+    for (unsigned w = 0; w < threads_; w++) {
+      pool.emplace_back(worker, w);
+    }
+    for (auto &t : pool) {
+      t.join();
+    }
+  }
+
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return report;
+}
@@ -0,0 +1,111 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_GENERATOR_H
+#define SUDOKU_GENERATOR_H
+
+#include "BacktrackingSolver.h"
+#include "Sudoku.h"
+#include "Technique.h"
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+
+/*! Range of the hardest technique a puzzle needs, in the reference order.
+ *
+ * Technique::COUNT stands for the puzzles SmartSolver can't solve at all.
+ */
+struct DifficultyBand {
+  Technique easiest = Technique::SINGLES;
+  Technique hardest = Technique::COUNT;
+
+  bool Contains(Technique technique) const { return easiest <= technique && technique <= hardest; }
+};
+
+struct GeneratedPuzzle {
+  std::string puzzle;
+  std::string solution;
+  //! Hardest technique needed by SmartSolver, COUNT if it can't solve it.
+  Technique hardest;
+};
+
+struct GeneratorReport {
+  //! Puzzles that were handed to the sink.
+  uint64_t generated = 0;
+  //! Puzzles built, including the ones outside of the band.
+  uint64_t candidates = 0;
+  double seconds = 0;
+};
+
+/*! Generates puzzles with a unique solution on a pool of threads.
+ *
+ * Each candidate starts from a random solution, from which givens are removed
+ * in random order for as long as the solution stays unique. The candidate is
+ * then rated by SmartSolver in the reference order. Candidates that need a
+ * technique harder than the band get givens of the solution back until they
+ * fit, candidates that are too easy are dropped.
+ *
+ * Every worker uses its own random generator seeded from the seed and its
+ * index, the order in which the workers deliver their puzzles is not
+ * deterministic.
+ */
+class Generator {
+public:
+  //! Called for each accepted puzzle, the calls are serialized.
+  using Sink = std::function<void(const GeneratedPuzzle &)>;
+
+  /*! Construct a generator.
+   *
+   * @param threads Number of worker threads, 0 to use all hardware threads.
+   * @param size Size of the generated puzzles.
+   * @param type Type of the generated puzzles.
+   */
+  explicit Generator(unsigned threads = 0, unsigned size = 9, SudokuTypes type = BASIC);
+
+  /*! Generate count puzzles within the band.
+   *
+   * @param attempts Stop after this many candidates, even if fewer than count
+   *                 puzzles fit the band, 0 for no limit.
+   * @throws std::invalid_argument For puzzles larger than 35x35, which have no
+   *        text grid.
+   */
+  GeneratorReport Generate(uint64_t count, DifficultyBand band, uint64_t seed, const Sink &sink,
+                           uint64_t attempts = 0) const;
+
+  //! Return the number of worker threads used.
+  unsigned Threads() const { return threads_; }
+
+  //! Return a random solved grid, one character per square, throws
+  //! std::invalid_argument for puzzles larger than 35x35.
+  std::string RandomSolution(std::mt19937_64 &rng, BacktrackingSolver &solver) const;
+
+  /*! Return a random solved puzzle, built from a fixed pattern without any
+   * search, for puzzles of any size with boxes.
+   *
+   * The numbers, the rows inside of each band of boxes, the bands, the columns
+   * inside of each stack of boxes and the stacks are shuffled, which keeps the
+   * pattern a solution. Unlike RandomSolution, the result is not uniform over
+   * all the solutions, but it is cheap even for 64x64 puzzles. Only BASIC
+   * puzzles are supported.
+   */
+  sudoku::Sudoku PatternSolution(std::mt19937_64 &rng) const;
+
+  //! Remove givens of the solution in random order while the solution stays
+  //! unique, throws std::invalid_argument for puzzles larger than 35x35.
+  std::string RemoveGivens(std::string_view solution, std::mt19937_64 &rng, BacktrackingSolver &solver) const;
+
+  //! Return the hardest technique SmartSolver needs for the puzzle, COUNT if it can't solve it.
+  Technique Rate(std::string_view puzzle) const;
+
+private:
+  unsigned threads_;
+  unsigned size_;
+  SudokuTypes type_;
+
+  // Build a single candidate and fit it into the band, false if it is too easy.
+  bool Candidate(DifficultyBand band, std::mt19937_64 &rng, BacktrackingSolver &solver,
+                 GeneratedPuzzle &result) const;
+};
+
+#endif // SUDOKU_GENERATOR_H
@@ -0,0 +1,95 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "Pipeline.h"
+#include "Corpus.h"
+#include <algorithm>
+#include <chrono>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Records passed between the stages, reused once written.
+struct Batch {
+  std::vector<std::string> lines;
+  std::vector<BatchPuzzle> puzzles;
+  std::vector<std::string> grids;
+  size_t count = 0;
+};
+
+using BatchQueue = BoundedQueue<std::unique_ptr<Batch>>;
+
+} // namespace
+
+SolvePipeline::SolvePipeline(const BatchSolver &solver, size_t batch_size, size_t batches)
+    : solver_(solver), batch_size_(std::max<size_t>(batch_size, 1)), batches_(std::max<size_t>(batches, 1)) {}
+
+PipelineReport SolvePipeline::Run(std::istream &input, std::ostream &output) const {
+  auto start = std::chrono::steady_clock::now();
+  PipelineReport report;
+
+  // The batches circulate from the reader through the solver and the writer
+  // back to the reader, so none of the queues ever holds more than all of them.
+  BatchQueue recycled(batches_);
+  BatchQueue to_solve(batches_);
+  BatchQueue to_write(batches_);
+  for (size_t i = 0; i < batches_; i++) {
+    auto batch = std::make_unique<Batch>();
+    batch->lines.resize(batch_size_);
+    batch->grids.resize(batch_size_);
+    recycled.Push(std::move(batch));
+  }
+
+  std::thread reader([&] {
+    bool first = true;
+    std::unique_ptr<Batch> batch;
+    while (recycled.Pop(batch)) {
+      batch->count = Corpus::ReadRecords(input, batch->lines, first);
+      if (batch->count == 0 || !to_solve.Push(std::move(batch)))
+        break;
+    }
+    to_solve.Close();
+  });
+
+  std::thread solver([&] {
+    std::unique_ptr<Batch> batch;
+    while (to_solve.Pop(batch)) {
+      batch->puzzles.clear();
+      for (size_t i = 0; i < batch->count; i++) {
+        batch->puzzles.push_back(Corpus::SplitRecord(batch->lines[i]));
+      }
+      BatchResult result = solver_.Solve(batch->puzzles, batch->grids);
+      report.puzzles += batch->count;
+      report.solved += result.solved;
+      report.incorrect += result.incorrect;
+      report.searched += result.searched;
+      report.stats += result.stats;
+      if (!to_write.Push(std::move(batch)))
+        break;
+    }
+    to_write.Close();
+  });
+
+  std::unique_ptr<Batch> batch;
+  while (to_write.Pop(batch)) {
+    for (size_t i = 0; i < batch->count; i++) {
+      output << batch->grids[i] << '\n';
+    }
+    output.flush();
+    // Without anyone to write to, the other stages stop as well.
+    if (!output || !recycled.Push(std::move(batch)))
+      break;
+  }
+  recycled.Close();
+  to_solve.Close();
+  to_write.Close();
+  reader.join();
+  solver.join();
+
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return report;
+}
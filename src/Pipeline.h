@@ -0,0 +1,110 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_PIPELINE_H
+#define SUDOKU_PIPELINE_H
+
+#include "BatchSolver.h"
+#include "SolveStats.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <utility>
+
+/*! First in, first out queue of at most capacity items, shared by threads.
+ *
+ * Pushing into a full queue blocks until there is room, popping from an empty
+ * one blocks until there is an item. Once closed, pushing fails and popping
+ * only returns the items that are still in the queue.
+ */
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+  //! Append the item, false if the queue was closed.
+  bool Push(T item) {
+    std::unique_lock<std::mutex> guard(lock_);
+    not_full_.wait(guard, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_)
+      return false;
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  //! Take the first item, false if the queue is closed and empty.
+  bool Pop(T &item) {
+    std::unique_lock<std::mutex> guard(lock_);
+    not_empty_.wait(guard, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty())
+      return false;
+    item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  //! Wake up all waiting threads, see the class description.
+  void Close() {
+    std::lock_guard<std::mutex> guard(lock_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+private:
+  std::mutex lock_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> items_;
+  size_t capacity_;
+  bool closed_ = false;
+};
+
+struct PipelineReport {
+  //! Records read, without the header.
+  uint64_t puzzles = 0;
+  uint64_t solved = 0;
+  uint64_t incorrect = 0;
+  //! Solved puzzles that needed the backtracking fallback, included in solved.
+  uint64_t searched = 0;
+  SolveStats stats;
+  double seconds = 0;
+};
+
+/*! Solves a stream of puzzles, writing the result of each in input order.
+ *
+ * Every line of the input is a "puzzle[,solution]" record, a header line is
+ * skipped. For each record, one line with the state the puzzle ended in is
+ * written (see BatchSolver::Solve), an empty line if the puzzle can't be read.
+ *
+ * Reading, solving and writing run on separate threads and hand batches of
+ * records to each other through bounded queues, so the input and output
+ * overlap with the solving while only a fixed number of batches is kept in
+ * memory. The batches themselves are solved on the pool of the BatchSolver.
+ * Each batch is flushed once written, so the results of a slow producer
+ * don't wait for the end of the input.
+ */
+class SolvePipeline {
+public:
+  /*! Construct a pipeline.
+   *
+   * @param solver Solver of the batches, also decides the backtracking.
+   * @param batch_size Number of records in a batch.
+   * @param batches Number of batches in flight, at least one for each of the
+   *                three stages to run at the same time.
+   */
+  explicit SolvePipeline(const BatchSolver &solver, size_t batch_size = 4096, size_t batches = 4);
+
+  //! Solve all the records of the input, blocks until the input is exhausted.
+  PipelineReport Run(std::istream &input, std::ostream &output) const;
+
+private:
+  const BatchSolver &solver_;
+  size_t batch_size_;
+  size_t batches_;
+};
+
+#endif // SUDOKU_PIPELINE_H
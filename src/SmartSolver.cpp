@@ -2,331 +2,129 @@
 
 #include "SmartSolver.h"
 #include "core/SudokuAlgorithms.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
 
 
-bool SmartSolver::SingleStep(sudoku::Sudoku &sudoku, SolveStats &stats) {
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
+namespace {
 
-    auto changed_blocks = sudoku.ChangedBlocks();
-    if (changed_blocks.size() == 0) {
-      return false;
-    }
-    sudoku.ResetChange();
-
-    for (auto &block : changed_blocks) {
-      SolveHiddenGroups(block->GetSquares(), 1);
-      SolveNakedGroups(block->GetSquares(), 1);
-    }
-
-    if (sudoku.HasChange()) {
-      stats.groups[1]++;
-      return true;
+// Apply a technique to the whole puzzle, changed_blocks are the blocks
+// changed by the previous step.
+void ApplyTechnique(Technique technique, sudoku::Sudoku &sudoku, const sudoku::BlockMask &changed_blocks) {
+  const TechniqueInfo &info = GetTechniqueInfo(technique);
+  switch (info.kind) {
+  case TechniqueKind::GROUPS:
+    if (info.size == 1) {
+      sudoku.SolveNakedSingles();
+      for (auto block : changed_blocks) {
+        SolveHiddenGroups(sudoku.Squares(sudoku.Blocks()[block]), sudoku.Positions(sudoku.Blocks()[block]), 1);
+      }
+      break;
     }
-
     for (auto &block : sudoku.Blocks()) {
-      SolveHiddenGroups(block.GetSquares(), 2);
-      SolveNakedGroups(block.GetSquares(), 2);
+      SolveHiddenGroups(sudoku.Squares(block), sudoku.Positions(block), info.size);
+      SolveNakedGroups(sudoku.Squares(block), info.size);
     }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.groups[2]++;
-      return true;
-    }
-
+    break;
+  case TechniqueKind::KILLER_SUMS:
     // Limit squares to only possible sums of killer blocks.
     sudoku.PruneKillerBlockSums();
     sudoku.PruneSquaresFromKillerBlocks();
-
-    if (sudoku.HasSolution()) {
-        if (!sudoku.CheckAgainstSolution())
-            return false;
-    }
-
-    if (sudoku.HasChange()) {
-        stats.killer_sums++;
-        return true;
-    }
-
+    break;
+  case TechniqueKind::INTERSECTIONS:
     // Intersecting blocks rule
-    for (auto &block : sudoku.Blocks()) {
-      for (auto &rblock : sudoku.Blocks()) {
-        SolveBlockIntersection(block, rblock);
-      }
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.block_intersections++;
-      return true;
-    }
-
-    for (auto &block : sudoku.Blocks()) {
-      SolveHiddenGroups(block.GetSquares(), 3);
-      SolveNakedGroups(block.GetSquares(), 3);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.groups[3]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFish(2u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.fish[2]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveXChains(4u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.xchains[4u]++;
-      return true;
-    }
-
-    for (auto &block : sudoku.Blocks()) {
-      SolveHiddenGroups(block.GetSquares(), 4);
-      SolveNakedGroups(block.GetSquares(), 4);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.groups[4]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFish(3u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.fish[3]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFinnedFish(2u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.finned_fish[2]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveXChains(6u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.xchains[6]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFinnedFish(3u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.finned_fish[3]++;
-      return true;
-    }
-
+    sudoku.SolveBlockIntersections();
+    break;
+  case TechniqueKind::FISH:
     for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFish(4u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
+      sudoku.SolveFish(info.size, j);
     }
-
-    if (sudoku.HasChange()) {
-      stats.fish[4]++;
-      return true;
-    }
-
+    break;
+  case TechniqueKind::FINNED_FISH:
     for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFish(5u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.fish[5]++;
-      return true;
+      sudoku.SolveFinnedFish(info.size, j);
     }
-
+    break;
+  case TechniqueKind::XCHAINS:
     for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFish(6u, j);
+      sudoku.SolveXChains(info.size, j);
     }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-   
-    if (sudoku.HasChange()) {
-      stats.fish[6]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFish(7u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.fish[7]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveXChains(8u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.xchains[8]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFinnedFish(4u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.finned_fish[4]++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveXChains(10u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.xchains[10]++;
-      return true;
-    }
-
+    break;
+  case TechniqueKind::XYCHAINS:
     sudoku.SolveXYChains();
+    break;
+  }
+}
 
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.xychains++;
-      return true;
-    }
-
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFinnedFish(5u, j);
-    }
-
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
-
-    if (sudoku.HasChange()) {
-      stats.finned_fish[5]++;
-      return true;
-    }
+// Record a technique that made progress.
+void CountHit(Technique technique, SolveStats &stats) {
+  const TechniqueInfo &info = GetTechniqueInfo(technique);
+  switch (info.kind) {
+  case TechniqueKind::GROUPS:
+    stats.groups[info.size]++;
+    break;
+  case TechniqueKind::KILLER_SUMS:
+    stats.killer_sums++;
+    break;
+  case TechniqueKind::INTERSECTIONS:
+    stats.block_intersections++;
+    break;
+  case TechniqueKind::FISH:
+    stats.fish[info.size]++;
+    break;
+  case TechniqueKind::FINNED_FISH:
+    stats.finned_fish[info.size]++;
+    break;
+  case TechniqueKind::XCHAINS:
+    stats.xchains[info.size]++;
+    break;
+  case TechniqueKind::XYCHAINS:
+    stats.xychains++;
+    break;
+  }
+}
 
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFinnedFish(6u, j);
-    }
+} // namespace
 
-    if (sudoku.HasSolution()) {
-      if (!sudoku.CheckAgainstSolution())
-        return false;
-    }
+bool SmartSolver::SingleStep(sudoku::Sudoku &sudoku, SolveStats &stats) {
+  TechniqueScheduler reference;
+  return SingleStep(sudoku, stats, reference);
+}
 
-    if (sudoku.HasChange()) {
-      stats.finned_fish[6]++;
-      return true;
-    }
+bool SmartSolver::SingleStep(sudoku::Sudoku &sudoku, SolveStats &stats, TechniqueScheduler &scheduler) {
+  if (sudoku.HasSolution()) {
+    if (!sudoku.CheckAgainstSolution())
+      return false;
+  }
 
-    for (unsigned j = 1; j <= sudoku.Size(); j++) {
-      sudoku.SolveFinnedFish(7u, j);
+  auto changed_blocks = sudoku.ChangedBlocks();
+  if (!changed_blocks.Any()) {
+    return false;
+  }
+  sudoku.ResetChange();
+
+  const bool timed = SolveStats::TECHNIQUE_STATS || scheduler.Mode() == ScheduleMode::ADAPTIVE;
+  // Recording a run can reorder the techniques, iterate over a copy.
+  std::array<Technique, TECHNIQUE_COUNT> order{};
+  std::ranges::copy(scheduler.Order(sudoku.Size(), sudoku.Type()), order.begin());
+  for (auto technique : order) {
+    auto start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+    uint64_t eliminated = sudoku.Eliminated();
+    ApplyTechnique(technique, sudoku, changed_blocks);
+    if (timed) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+      uint64_t nanoseconds = static_cast<uint64_t>(elapsed.count());
+      scheduler.Record(sudoku.Size(), sudoku.Type(), technique, nanoseconds, sudoku.HasChange());
+      if constexpr (SolveStats::TECHNIQUE_STATS) {
+        auto &counters = stats.techniques[static_cast<unsigned>(technique)];
+        counters.nanoseconds += nanoseconds;
+        counters.invocations++;
+        if (sudoku.HasChange())
+          counters.productive++;
+        counters.eliminated += sudoku.Eliminated() - eliminated;
+      }
     }
 
     if (sudoku.HasSolution()) {
@@ -335,14 +133,20 @@ bool SmartSolver::SingleStep(sudoku::Sudoku &sudoku, SolveStats &stats) {
     }
 
     if (sudoku.HasChange()) {
-      stats.finned_fish[7]++;
+      CountHit(technique, stats);
       return true;
     }
+  }
 
-    return false;
+  return false;
 }
 
 bool SmartSolver::Solve(sudoku::Sudoku &sudoku, SolveStats &stats) {
-  while (!sudoku.IsSet() && SingleStep(sudoku, stats));
+  TechniqueScheduler reference;
+  return Solve(sudoku, stats, reference);
+}
+
+bool SmartSolver::Solve(sudoku::Sudoku &sudoku, SolveStats &stats, TechniqueScheduler &scheduler) {
+  while (!sudoku.IsSet() && SingleStep(sudoku, stats, scheduler));
   return sudoku.IsSet();
-}
\ No newline at end of file
+}
@@ -5,11 +5,16 @@
 
 #include "Sudoku.h"
 #include "SolveStats.h"
+#include "TechniqueScheduler.h"
 
 class SmartSolver {
 public:
+  //! Apply the first technique that makes progress, in the reference order.
   static bool SingleStep(sudoku::Sudoku &sudoku, SolveStats &stats);
+  //! Apply the first technique that makes progress, in the order of the scheduler.
+  static bool SingleStep(sudoku::Sudoku &sudoku, SolveStats &stats, TechniqueScheduler &scheduler);
   static bool Solve(sudoku::Sudoku &sudoku, SolveStats &stats);
+  static bool Solve(sudoku::Sudoku &sudoku, SolveStats &stats, TechniqueScheduler &scheduler);
 };
 
 #endif // SUDOKU_SOLVER_H
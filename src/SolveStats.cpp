@@ -37,8 +37,45 @@ SolveStats &SolveStats::operator+=(const SolveStats &stats) {
 
   killer_sums += stats.killer_sums;
 
+  for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+    techniques[i] += stats.techniques[i];
+  }
+
   return *this;
 }
+unsigned TechniqueHits(const SolveStats &stats, Technique technique) {
+  const TechniqueInfo &info = GetTechniqueInfo(technique);
+  auto sized = [&info](const std::unordered_map<unsigned, unsigned> &hits) {
+    auto it = hits.find(info.size);
+    return it == hits.end() ? 0u : it->second;
+  };
+  switch (info.kind) {
+  case TechniqueKind::GROUPS:
+    return sized(stats.groups);
+  case TechniqueKind::KILLER_SUMS:
+    return stats.killer_sums;
+  case TechniqueKind::INTERSECTIONS:
+    return stats.block_intersections;
+  case TechniqueKind::FISH:
+    return sized(stats.fish);
+  case TechniqueKind::FINNED_FISH:
+    return sized(stats.finned_fish);
+  case TechniqueKind::XCHAINS:
+    return sized(stats.xchains);
+  case TechniqueKind::XYCHAINS:
+    return stats.xychains;
+  }
+  return 0;
+}
+
+Technique HardestTechnique(const SolveStats &stats) {
+  for (unsigned i = TECHNIQUE_COUNT; i-- > 1;) {
+    if (TechniqueHits(stats, static_cast<Technique>(i)) != 0)
+      return static_cast<Technique>(i);
+  }
+  return Technique::SINGLES;
+}
+
 std::ostream &operator<<(std::ostream &s, const SolveStats &stats) {
   s << "Solver stats {" << std::endl;
   s << "\tGroups: ";
@@ -92,4 +129,86 @@ std::ostream &operator<<(std::ostream &s, const SolveStats &stats) {
   s << "};" << std::endl;
 
   return s;
-}
\ No newline at end of file
+}
+
+namespace {
+void WriteCounts(std::ostream &s, const std::unordered_map<unsigned, unsigned> &counts, unsigned first,
+                 unsigned last, unsigned step) {
+  s << "{";
+  bool first_entry = true;
+  for (unsigned i = first; i <= last; i += step) {
+    auto it = counts.find(i);
+    if (it == counts.end())
+      continue;
+    s << (first_entry ? "" : ", ") << "\"" << i << "\": " << it->second;
+    first_entry = false;
+  }
+  s << "}";
+}
+} // namespace
+
+std::ostream &operator<<(std::ostream &s, const SolveStatsJson &json) {
+  const SolveStats &stats = json.stats;
+  s << "{\"groups\": ";
+  WriteCounts(s, stats.groups, 1, 4, 1);
+  s << ", \"intersections\": " << stats.block_intersections;
+  s << ", \"xychains\": " << stats.xychains;
+  s << ", \"killer_sums\": " << stats.killer_sums;
+  s << ", \"fish\": ";
+  WriteCounts(s, stats.fish, 2, 7, 1);
+  s << ", \"finned_fish\": ";
+  WriteCounts(s, stats.finned_fish, 2, 7, 1);
+  s << ", \"xchains\": ";
+  WriteCounts(s, stats.xchains, 4, 24, 2);
+  s << ", \"techniques\": [";
+  if constexpr (SolveStats::TECHNIQUE_STATS) {
+    for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+      const auto &counters = stats.techniques[i];
+      s << (i == 0 ? "" : ", ") << "{\"name\": \"" << GetTechniqueInfo(static_cast<Technique>(i)).name
+        << "\", \"invocations\": " << counters.invocations << ", \"productive\": " << counters.productive
+        << ", \"eliminated\": " << counters.eliminated << ", \"nanoseconds\": " << counters.nanoseconds << "}";
+    }
+  }
+  s << "]}";
+  return s;
+}
+
+PuzzleRating::PuzzleRating(const SolveStats &stats, bool is_solved)
+    : solved(is_solved), hardest(HardestTechnique(stats)) {
+  for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+    hits[i] = TechniqueHits(stats, static_cast<Technique>(i));
+    nanoseconds[i] = stats.techniques[i].nanoseconds;
+    steps += hits[i];
+  }
+}
+
+std::ostream &operator<<(std::ostream &s, const RatingRecord &record) {
+  const PuzzleRating &rating = record.rating;
+  s << record.id << ',' << (rating.solved ? 1 : 0) << ',' << GetTechniqueInfo(rating.hardest).name << ','
+    << rating.steps << ',';
+  bool first = true;
+  for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+    if (rating.hits[i] == 0 && rating.nanoseconds[i] == 0)
+      continue;
+    s << (first ? "" : " ") << GetTechniqueInfo(static_cast<Technique>(i)).name << ':' << rating.hits[i] << ':'
+      << rating.nanoseconds[i];
+    first = false;
+  }
+  return s;
+}
+
+std::ostream &operator<<(std::ostream &s, const RatingRecordJson &record) {
+  const PuzzleRating &rating = record.rating;
+  s << "{\"id\": " << record.id << ", \"solved\": " << (rating.solved ? "true" : "false") << ", \"hardest\": \""
+    << GetTechniqueInfo(rating.hardest).name << "\", \"steps\": " << rating.steps << ", \"tiers\": {";
+  bool first = true;
+  for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+    if (rating.hits[i] == 0 && rating.nanoseconds[i] == 0)
+      continue;
+    s << (first ? "" : ", ") << '"' << GetTechniqueInfo(static_cast<Technique>(i)).name << "\": {\"hits\": "
+      << rating.hits[i] << ", \"nanoseconds\": " << rating.nanoseconds[i] << '}';
+    first = false;
+  }
+  s << "}}";
+  return s;
+}
@@ -3,11 +3,40 @@
 #ifndef SUDOKU_SOLVESTATS_H
 #define SUDOKU_SOLVESTATS_H
 
+#include "Technique.h"
+#include <array>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 #include <iosfwd>
 
+// Per-technique timers and counters, set to 0 (ENABLE_TECHNIQUE_STATS=OFF)
+// to skip their collection.
+#ifndef SUDOKU_TECHNIQUE_STATS
+#define SUDOKU_TECHNIQUE_STATS 1
+#endif
+
+//! Time spent and work done by a single technique.
+struct TechniqueCounters {
+  uint64_t nanoseconds = 0;
+  uint64_t invocations = 0;
+  //! Invocations that changed the puzzle.
+  uint64_t productive = 0;
+  //! Number of candidates removed from the squares.
+  uint64_t eliminated = 0;
+
+  TechniqueCounters &operator+=(const TechniqueCounters &counters) {
+    nanoseconds += counters.nanoseconds;
+    invocations += counters.invocations;
+    productive += counters.productive;
+    eliminated += counters.eliminated;
+    return *this;
+  }
+};
+
 struct SolveStats {
+  static constexpr bool TECHNIQUE_STATS = SUDOKU_TECHNIQUE_STATS != 0;
+
   std::unordered_map<unsigned, unsigned> groups;
   unsigned block_intersections;
   std::unordered_map<unsigned, unsigned> fish;
@@ -15,6 +44,8 @@ struct SolveStats {
   std::unordered_map<unsigned, unsigned> xchains;
   unsigned xychains;
   unsigned killer_sums;
+  //! Counters of each technique, indexed by Technique.
+  std::array<TechniqueCounters, TECHNIQUE_COUNT> techniques{};
   SolveStats() : groups(), block_intersections(0), fish(), finned_fish(),
                  xchains(), xychains(0), killer_sums(0) {}
   SolveStats &operator+=(const SolveStats &stats);
@@ -22,4 +53,54 @@ struct SolveStats {
 
 std::ostream &operator<<(std::ostream &s, const SolveStats &stats);
 
+//! Return the number of steps in which the technique made progress.
+unsigned TechniqueHits(const SolveStats &stats, Technique technique);
+
+//! Return the technique latest in the reference order that made progress,
+//! SINGLES if none did.
+Technique HardestTechnique(const SolveStats &stats);
+
+//! Difficulty of a single puzzle, derived from the stats of solving it.
+struct PuzzleRating {
+  bool solved = false;
+  //! Hardest technique that made progress, see HardestTechnique.
+  Technique hardest = Technique::SINGLES;
+  //! Number of steps that made progress.
+  unsigned steps = 0;
+  //! Steps in which each technique made progress, indexed by Technique.
+  std::array<unsigned, TECHNIQUE_COUNT> hits{};
+  //! Time spent in each technique, 0 without the technique stats.
+  std::array<uint64_t, TECHNIQUE_COUNT> nanoseconds{};
+
+  PuzzleRating() = default;
+  PuzzleRating(const SolveStats &stats, bool is_solved);
+};
+
+/*! Single line record of a rating, s << RatingRecord{id, rating}.
+ *
+ * "id,solved,hardest,steps,tiers", where tiers lists the techniques that
+ * made progress or took time as "name:hits:nanoseconds", separated by spaces.
+ */
+struct RatingRecord {
+  uint64_t id;
+  const PuzzleRating &rating;
+};
+
+std::ostream &operator<<(std::ostream &s, const RatingRecord &record);
+
+//! JSON form of the record, a single line object.
+struct RatingRecordJson {
+  uint64_t id;
+  const PuzzleRating &rating;
+};
+
+std::ostream &operator<<(std::ostream &s, const RatingRecordJson &record);
+
+//! JSON form of the stats, s << SolveStatsJson{stats}.
+struct SolveStatsJson {
+  const SolveStats &stats;
+};
+
+std::ostream &operator<<(std::ostream &s, const SolveStatsJson &json);
+
 #endif // SUDOKU_SOLVESTATS_H
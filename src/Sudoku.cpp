@@ -2,13 +2,17 @@
 
 #include "Sudoku.h"
 #include "core/BitSet.h"
+#include "core/GridParser.h"
+#include "core/NakedSingles.h"
 #include "core/SudokuAlgorithms.h"
+#include <algorithm>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <ostream>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 
@@ -22,94 +26,208 @@ const std::map<unsigned, unsigned> block_sums = {
 };
 
 namespace sudoku {
-Sudoku::Sudoku(unsigned size, SudokuTypes type)
-    : data_(size*size, sudoku::BitSet::SudokuSquare(size)),
-      block_mapping_(size, std::vector<std::vector<UniqueBlock *>>(
-                               size, std::vector<UniqueBlock *>())),
-      size_(size), solution_(nullptr), puzzle_type_(type) {
-  SetupCheckers(size, type);
-  MakeCopy();
+SudokuLayout::SudokuLayout(unsigned size, SudokuTypes type)
+    : mapping(size * size), offsets(size * size) {
+  if (size == 9 && type == BASIC) {
+    Load(STATIC_LAYOUT<9, false>);
+  } else if (size == 9 && type == DIAGONAL) {
+    Load(STATIC_LAYOUT<9, true>);
+  } else if (size == 16 && type == BASIC) {
+    Load(STATIC_LAYOUT<16, false>);
+  } else if (size == 16 && type == DIAGONAL) {
+    Load(STATIC_LAYOUT<16, true>);
+  } else {
+    Build(size, type);
+  }
+
+  // The blocks vector is fully built, pointers into it are now stable.
+  for (unsigned i = 0; i < size; i++) {
+    rows.push_back(&blocks[i]);
+    cols.push_back(&blocks[size + i]);
+  }
+  BuildIntersections(size);
 }
 
-bool Sudoku::HasConflict() {
-  for (const auto &check : checks_) {
-    if (check.HasConflict())
-      return true;
+void SudokuLayout::BuildIntersections(unsigned size) {
+  std::vector<Intersection> pairs(blocks.size());
+  std::vector<bool> shared(blocks.size());
+  for (unsigned forcing = 0; forcing < blocks.size(); forcing++) {
+    std::fill(shared.begin(), shared.end(), false);
+    for (auto cell : blocks[forcing].Cells()) {
+      unsigned forcing_offset = 0;
+      for (unsigned i = 0; i < mapping[cell].size(); i++) {
+        if (mapping[cell][i] == forcing)
+          forcing_offset = offsets[cell][i];
+      }
+      for (unsigned i = 0; i < mapping[cell].size(); i++) {
+        unsigned checked = mapping[cell][i];
+        if (checked == forcing)
+          continue;
+        if (!shared[checked]) {
+          pairs[checked] = Intersection{forcing, checked, BitSet::Empty(size), BitSet::Empty(size)};
+          shared[checked] = true;
+        }
+        pairs[checked].forcing_positions += forcing_offset + 1;
+        pairs[checked].checked_positions += offsets[cell][i] + 1;
+      }
+    }
+    for (unsigned checked = 0; checked < blocks.size(); checked++) {
+      if (shared[checked])
+        intersections.push_back(pairs[checked]);
+    }
   }
-  return false;
 }
 
-void Sudoku::SetupCheckers(unsigned int size, SudokuTypes type) {
+void SudokuLayout::AddBlock(std::vector<unsigned> cells, unsigned size) {
+  unsigned id = static_cast<unsigned>(blocks.size());
+  for (unsigned i = 0; i < cells.size(); i++) {
+    mapping[cells[i]].push_back(id);
+    offsets[cells[i]].push_back(i);
+  }
+  blocks.emplace_back(std::move(cells), size);
+}
+
+template <unsigned Size, bool Diagonal>
+void SudokuLayout::Load(const StaticLayout<Size, Diagonal> &table) {
+  using Table = StaticLayout<Size, Diagonal>;
+  blocks.reserve(Table::BLOCKS);
+  for (const auto &cells : table.block_cells) {
+    blocks.emplace_back(std::vector<unsigned>(cells.begin(), cells.end()), Size);
+  }
+  for (unsigned cell = 0; cell < Table::CELLS; cell++) {
+    unsigned count = table.cell_block_count[cell];
+    mapping[cell].assign(table.cell_blocks[cell].begin(), table.cell_blocks[cell].begin() + count);
+    offsets[cell].assign(table.cell_offsets[cell].begin(), table.cell_offsets[cell].begin() + count);
+  }
+  box_rows = Table::BOX;
+  box_cols = Table::BOX;
+  box_size = Table::BOX;
+
+  peer_words = static_cast<unsigned>(Table::CellMask::WORDS);
+  peers.reserve(Table::CELLS * Table::CellMask::WORDS);
+  for (const auto &mask : table.peers) {
+    peers.insert(peers.end(), mask.Words().begin(), mask.Words().end());
+  }
+}
+
+void SudokuLayout::Build(unsigned size, SudokuTypes type) {
   switch (type) {
   case BASIC:
-    checks_.reserve(3 * size);
+    blocks.reserve(3 * size);
     break;
   case DIAGONAL:
-    checks_.reserve(3 * size + 2);
+    blocks.reserve(3 * size + 2);
   }
 
-  for (size_t i = 0; i < size; i++) {
-    std::vector<::sudoku::BitSet *> row;
-    for (size_t j = 0; j < size; j++) {
-      row.push_back(&data_[i*Size()+j]);
-    }
-    checks_.emplace_back(row, Size());
-    for (size_t j = 0; j < size; j++) {
-      block_mapping_[i][j].push_back(&checks_[checks_.size() - 1]);
+  for (unsigned i = 0; i < size; i++) {
+    std::vector<unsigned> row;
+    for (unsigned j = 0; j < size; j++) {
+      row.push_back(i * size + j);
     }
-    row_checks_.push_back(&checks_[checks_.size() - 1]);
+    AddBlock(std::move(row), size);
   }
 
-  for (size_t j = 0; j < size; j++) {
-    std::vector<::sudoku::BitSet *> column;
-    for (size_t i = 0; i < size; i++) {
-      column.push_back(&data_[i*Size()+j]);
+  for (unsigned j = 0; j < size; j++) {
+    std::vector<unsigned> column;
+    for (unsigned i = 0; i < size; i++) {
+      column.push_back(i * size + j);
     }
-    checks_.emplace_back(column, Size());
-    for (size_t i = 0; i < size; i++) {
-      block_mapping_[i][j].push_back(&checks_[checks_.size() - 1]);
-    }
-    col_checks_.push_back(&checks_[checks_.size() - 1]);
+    AddBlock(std::move(column), size);
   }
 
-  std::unordered_map<unsigned, unsigned> blocksizes = {{9, 3}, {16, 4}};
-  unsigned bsize = blocksizes[size];
-  for (size_t i = 0; i < bsize; i++) {
-    for (size_t j = 0; j < bsize; j++) {
-      std::vector<::sudoku::BitSet *> block;
-      for (size_t x = i * bsize; x < (i + 1) * bsize; x++) {
-        for (size_t y = j * bsize; y < (j + 1) * bsize; y++) {
-          block.push_back(&data_[x*Size()+y]);
-        }
-      }
-      checks_.emplace_back(block, Size());
-      for (size_t x = i * bsize; x < (i + 1) * bsize; x++) {
-        for (size_t y = j * bsize; y < (j + 1) * bsize; y++) {
-          block_mapping_[x][y].push_back(&checks_[checks_.size() - 1]);
+  // The tallest box that is not higher than wide.
+  for (unsigned height = 2; height * height <= size; height++) {
+    if (size % height == 0)
+      box_rows = height;
+  }
+  if (box_rows != 0) {
+    box_cols = size / box_rows;
+    if (box_rows == box_cols)
+      box_size = box_rows;
+    for (unsigned i = 0; i < size; i += box_rows) {
+      for (unsigned j = 0; j < size; j += box_cols) {
+        std::vector<unsigned> block;
+        for (unsigned x = i; x < i + box_rows; x++) {
+          for (unsigned y = j; y < j + box_cols; y++) {
+            block.push_back(x * size + y);
+          }
         }
+        AddBlock(std::move(block), size);
       }
     }
   }
 
   if (type == DIAGONAL) {
-      std::vector<::sudoku::BitSet *> d1, d2;
-      for (size_t i = 0; i < size; i++) {
-          d1.push_back(&data_[i * Size() + i]);
-          d2.push_back(&data_[i * Size() + size - 1 - i]);
+      std::vector<unsigned> d1, d2;
+      for (unsigned i = 0; i < size; i++) {
+          d1.push_back(i * size + i);
+          d2.push_back(i * size + size - 1 - i);
       }
-      checks_.emplace_back(d1, Size());
-      checks_.emplace_back(d2, Size());
-      for (size_t i = 0; i < size; i++) {
-          block_mapping_[i][i].push_back(&checks_[checks_.size() - 2]);
-          block_mapping_[i][size - 1 - i].push_back(&checks_[checks_.size() - 1]);
+      AddBlock(std::move(d1), size);
+      AddBlock(std::move(d2), size);
+  }
+
+  peer_words = (size * size + 63) / 64;
+  peers.assign(static_cast<size_t>(size) * size * peer_words, 0);
+  for (unsigned cell = 0; cell < size * size; cell++) {
+    uint64_t *mask = &peers[static_cast<size_t>(cell) * peer_words];
+    for (auto block : mapping[cell]) {
+      for (auto peer : blocks[block].Cells()) {
+        if (peer != cell)
+          mask[peer / 64] |= UINT64_C(1) << (peer % 64);
       }
+    }
   }
 }
 
+std::shared_ptr<const SudokuLayout> SudokuLayout::Get(unsigned size, SudokuTypes type) {
+  // The common layouts don't need any locking after the first use.
+  if (size == 9 && type == BASIC) {
+    static const auto layout = std::make_shared<const SudokuLayout>(9, BASIC);
+    return layout;
+  }
+  if (size == 9 && type == DIAGONAL) {
+    static const auto layout = std::make_shared<const SudokuLayout>(9, DIAGONAL);
+    return layout;
+  }
+  if (size == 16 && type == BASIC) {
+    static const auto layout = std::make_shared<const SudokuLayout>(16, BASIC);
+    return layout;
+  }
+  if (size == 16 && type == DIAGONAL) {
+    static const auto layout = std::make_shared<const SudokuLayout>(16, DIAGONAL);
+    return layout;
+  }
+
+  static std::mutex mutex;
+  static std::map<std::pair<unsigned, SudokuTypes>, std::shared_ptr<const SudokuLayout>> layouts;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &layout = layouts[{size, type}];
+  if (!layout)
+    layout = std::make_shared<const SudokuLayout>(size, type);
+  return layout;
+}
+
+Sudoku::Sudoku(unsigned size, SudokuTypes type)
+    : layout_(SudokuLayout::Get(size, type)),
+      data_(size*size, sudoku::BitSet::SudokuSquare(size)),
+      changes_(layout_->mapping, PositionIndex(layout_->mapping, layout_->offsets,
+                                               static_cast<unsigned>(layout_->blocks.size()), size, data_.data())),
+      size_(size), solution_(nullptr), puzzle_type_(type) {
+}
+
+bool Sudoku::HasConflict() {
+  for (const auto &check : Blocks()) {
+    if (check.HasConflict(data_.data()))
+      return true;
+  }
+  return false;
+}
+
 void Sudoku::DebugPrint(std::ostream &s) {
   for (unsigned i = 0; i < Size(); i++) {
     for (unsigned j = 0; j < Size(); j++) {
-      s << data_[i*Size()+j].DebugString() << " ";
+      s << data_[i*Size()+j].DebugString(Size()) << " ";
     }
     s << std::endl;
   }
@@ -118,7 +236,7 @@ std::string Sudoku::DebugString() {
   std::stringstream s;
   for (unsigned i = 0; i < Size(); i++) {
     for (unsigned j = 0; j < Size(); j++) {
-      s << data_[i*Size()+j].DebugString() << " ";
+      s << data_[i*Size()+j].DebugString(Size()) << " ";
     }
     s << std::endl;
   }
@@ -126,53 +244,128 @@ std::string Sudoku::DebugString() {
 }
 
 
-bool Sudoku::HasChange() const {
-  for (unsigned i = 0; i < data_.size(); i++) {
-    if (data_[i] != data_copy_[i])
-      return true;
+bool Sudoku::IsSet() const {
+  for (unsigned i = 0; i < Size(); i++) {
+    for (unsigned j = 0; j < Size(); j++) {
+      if (!data_[i*Size()+j].HasSingletonValue())
+        return false;
+    }
   }
-  return false;
-}
-
-void Sudoku::ResetChange() {
-  MakeCopy();
+  return true;
 }
 
-std::unordered_set<UniqueBlock *> Sudoku::ChangedBlocks() const {
-  std::unordered_set<UniqueBlock *> result;
-  for (unsigned i = 0; i < data_.size(); i++) {
-    if (data_[i] != data_copy_[i]) {
-      for (auto &b : block_mapping_[i/Size()][i%Size()]) {
-        result.insert(b);
+void Sudoku::SolveNakedSingles() {
+  if (Size() > PackedGrid::STRIDE || layout_->box_size == 0) {
+    // Every block removes the numbers of its solved squares from the others
+    // in one pass, the squares solved on the way are then followed through
+    // their own blocks. Unlike pairing up the squares of a block, the cost
+    // doesn't grow with the number of solved squares in the large puzzles.
+    TrackedGrid grid = Grid();
+    std::vector<unsigned> solved;
+    auto prune = [&](unsigned cell, const BitSet &numbers) {
+      if (data_[cell].CountSet() <= 1 || !data_[cell].HasIntersection(numbers))
+        return;
+      grid[cell] -= numbers;
+      if (data_[cell].CountSet() == 1)
+        solved.push_back(cell);
+    };
+    for (auto &block : Blocks()) {
+      BitSet numbers = BitSet::Empty(Max());
+      for (auto cell : block.Cells()) {
+        if (data_[cell].CountSet() == 1)
+          numbers |= data_[cell];
+      }
+      for (auto cell : block.Cells()) {
+        prune(cell, numbers);
+      }
+    }
+    while (!solved.empty()) {
+      unsigned cell = solved.back();
+      solved.pop_back();
+      const BitSet number = data_[cell];
+      for (auto block : layout_->mapping[cell]) {
+        for (auto other : layout_->blocks[block].Cells()) {
+          prune(other, number);
+        }
       }
     }
+    return;
   }
-  return result;
-}
 
-bool Sudoku::IsSet() const {
+  PackedGrid packed;
   for (unsigned i = 0; i < Size(); i++) {
     for (unsigned j = 0; j < Size(); j++) {
-      if (!data_[i*Size()+j].HasSingletonValue())
-        return false;
+      packed.squares[i * PackedGrid::STRIDE + j] = SmallBitSet::FromValue(static_cast<uint16_t>(data_[i * Size() + j].Value()));
+    }
+  }
+  if (!PropagateNakedSingles(packed, Size(), layout_->box_size, puzzle_type_ == DIAGONAL))
+    return;
+
+  TrackedGrid grid = Grid();
+  for (unsigned i = 0; i < Size(); i++) {
+    for (unsigned j = 0; j < Size(); j++) {
+      grid[i * Size() + j] = BitSet::FromValue(packed.squares[i * PackedGrid::STRIDE + j].Value());
+    }
+  }
+}
+
+void Sudoku::SolveBlockIntersections() {
+  const auto &index = changes_.Index();
+  const auto &blocks = layout_->blocks;
+  const auto &intersections = layout_->intersections;
+  auto grid = Grid();
+
+  size_t pair = 0;
+  for (unsigned forcing = 0; forcing < blocks.size(); forcing++) {
+    // A number without any position in the block is a contradiction, every
+    // other block then counts as containing all of its positions, so the
+    // number is removed from all the squares outside of the block.
+    for (unsigned number = 1; number <= Max(); number++) {
+      if (index.Positions(forcing, number).CountSet() != 0)
+        continue;
+      for (unsigned cell = 0; cell < data_.size(); cell++) {
+        if (!std::ranges::binary_search(layout_->mapping[cell], forcing))
+          grid[cell] -= number;
+      }
+    }
+
+    for (; pair < intersections.size() && intersections[pair].forcing == forcing; pair++) {
+      const auto &intersection = intersections[pair];
+      const auto &checked = blocks[intersection.checked].Cells();
+      for (unsigned number = 1; number <= Max(); number++) {
+        const BitSet &positions = index.Positions(forcing, number);
+        if (positions.CountSet() == 0 || positions.HasAdditionalBits(intersection.forcing_positions))
+          continue;
+        BitSet outside = index.Positions(intersection.checked, number) - intersection.checked_positions;
+        for (auto position : BitSetBits(&outside)) {
+          grid[checked[position - 1]] -= number;
+        }
+      }
     }
   }
-  return true;
 }
 
 void Sudoku::SolveFish(unsigned int size, unsigned int number) {
-  ::sudoku::SolveFish(GetRowBlocks(), GetColBlocks(), size, number);
-  ::sudoku::SolveFish(GetColBlocks(), GetRowBlocks(), size, number);
+  // Row blocks are the first Size() blocks, followed by the column blocks.
+  auto positions = Positions().Positions(number);
+  auto rows = positions.first(Size());
+  auto cols = positions.subspan(Size(), Size());
+  // Larger fish are found as the complementary fish in the other direction.
+  if (size > MaxFishSize(rows, cols))
+    return;
+  ::sudoku::SolveFish(Grid(), rows, GetColBlocks(), size, number);
+  ::sudoku::SolveFish(Grid(), cols, GetRowBlocks(), size, number);
 }
 
 void Sudoku::SolveFinnedFish(unsigned int size, unsigned int number) {
-  ::sudoku::SolveFinnedFish(GetRowBlocks(), [this](unsigned num, 
+  auto positions = Positions().Positions(number);
+  ::sudoku::SolveFinnedFish(positions.first(Size()), [this](unsigned num, 
     unsigned row, unsigned col, 
     BitSet rows, BitSet cols) {
-      for (auto block : block_mapping_[row-1][col-1]) {
-        for (auto square : block->GetSquares()) {
-          unsigned r = static_cast<unsigned>((square-data_.data())/Size()) + 1;
-          unsigned c = static_cast<unsigned>((square-data_.data())%Size()) + 1;
+      for (auto block : GetBlockMapping((row-1)*Size() + (col-1))) {
+        for (auto square : Blocks()[block].Cells()) {
+          unsigned r = square/Size() + 1;
+          unsigned c = square%Size() + 1;
           // skip over squares that share the column or row with the fin
           if (row == r || col == c) continue;
 
@@ -196,17 +389,17 @@ void Sudoku::SolveFinnedFish(unsigned int size, unsigned int number) {
           }
           if (found) continue;
 
-          (*square) -= num;
+          Grid()[square] -= num;
         }
       }
   }, size, number);
-  ::sudoku::SolveFinnedFish(GetColBlocks(), [this](unsigned num, 
+  ::sudoku::SolveFinnedFish(positions.subspan(Size(), Size()), [this](unsigned num, 
     unsigned col, unsigned row, 
     BitSet cols, BitSet rows) {
-      for (auto block : block_mapping_[row-1][col-1]) {
-        for (auto square : block->GetSquares()) {
-          unsigned r = static_cast<unsigned>((square-data_.data())/Size()) + 1;
-          unsigned c = static_cast<unsigned>((square-data_.data())%Size()) + 1;
+      for (auto block : GetBlockMapping((row-1)*Size() + (col-1))) {
+        for (auto square : Blocks()[block].Cells()) {
+          unsigned r = square/Size() + 1;
+          unsigned c = square%Size() + 1;
           // skip over squares that share the column or row with the fin
           if (row == r || col == c) continue;
 
@@ -230,7 +423,7 @@ void Sudoku::SolveFinnedFish(unsigned int size, unsigned int number) {
           }
           if (found) continue;
 
-          (*square) -= num;
+          Grid()[square] -= num;
         }
       }
   }, size, number);
@@ -251,47 +444,47 @@ unsigned CountIntersections(const std::vector<T> &l, const std::vector<T> &r) {
 unsigned
 Sudoku::NumberOfSharedBlocks(std::pair<unsigned int, unsigned int> l,
                              std::pair<unsigned int, unsigned int> r) const {
-  return CountIntersections(block_mapping_[l.first][l.second],
-                            block_mapping_[r.first][r.second]);
+  return CountIntersections(GetBlockMapping(l.first*Size() + l.second),
+                            GetBlockMapping(r.first*Size() + r.second));
 }
 
 ChainsGraph Sudoku::GetChains(unsigned number) const {
   ChainsGraph result;
+  BuildChains(number, result);
+  return result;
+}
+
+void Sudoku::BuildChains(unsigned number, ChainsGraph &graph) const {
+  graph.Reset(static_cast<unsigned>(data_.size()));
+  // Row blocks are the first Size() blocks, their positions are the columns.
+  auto positions = Positions().Positions(number);
   for (unsigned i = 0; i < Size(); i++) {
-    for (unsigned j = 0; j < Size(); j++) {
-      if (data_[i*Size()+j].IsBitSet(number)) {
-        result.nodes.push_back(i*Size()+j);
-      }
+    for (auto j : BitSetBits(&positions[i])) {
+      graph.AddNode(i*Size() + j - 1);
     }
   }
-  for (const auto& b : checks_) {
-    auto pos = b.NumberPositions(number);
-    if (pos.CountSet() == 2) {
-      auto i = BitSetBits(&pos).begin();
-      BitSet* first = b.GetSquares()[(*i)-1];
-      i++;
-      BitSet* second = b.GetSquares()[(*i)-1];
 
-      result.strong_links.insert({first-&data_[0], second-&data_[0]});
-      result.weak_links.insert({first-&data_[0], second-&data_[0]});
-      result.strong_links.insert({second-&data_[0], first-&data_[0]});
-      result.weak_links.insert({second-&data_[0], first-&data_[0]});
-    } else if (pos.CountSet() > 2) {
+  for (auto square : graph.nodes) {
+    for (auto block : GetBlockMapping(square)) {
+      const BitSet &pos = positions[block];
+      unsigned count = pos.CountSet();
+      if (count < 2) continue;
+      // Two possible positions in a block form a strong link.
+      unsigned type = count == 2 ? (STRONG_LINK | WEAK_LINK) : WEAK_LINK;
       for (auto i : BitSetBits(&pos)) {
-        for (auto j : BitSetBits(&pos)) {
-          if (i == j) continue;
-
-          BitSet* first = b.GetSquares()[i-1];
-          BitSet* second = b.GetSquares()[j-1];
-          result.weak_links.insert({first-&data_[0], second-&data_[0]});
-        }
+        unsigned other = Blocks()[block].Cells()[i-1];
+        if (other != square)
+          graph.AddLink(other, type);
       }
     }
+    graph.EndNode();
   }
-  return result;
 }
 
 std::ostream &operator<<(std::ostream &s, const Sudoku &puzzle) {
+  // Past 'Z' the characters would alias other squares.
+  if (puzzle.Size() > MAX_GRID_NUMBER)
+    throw std::out_of_range("Only puzzles up to 35x35 have a text grid, use Serialize.");
   for (unsigned i = 0; i < puzzle.Size(); i++) {
     for (unsigned j = 0; j < puzzle.Size(); j++) {
       if (!puzzle[i][j].HasSingletonValue()) {
@@ -332,244 +525,332 @@ C  7  *  6   E  *  8  *   *  *  *  *   *  *  *  3
 *  *  5  A   *  *  *  B   *  E  *  8   6  *  2  *
 */
 std::istream &operator>>(std::istream &s, Sudoku &puzzle) {
-  std::string debug = "";
-  for (unsigned i = 0; i < puzzle.Size(); i++) {
-    for (unsigned j = 0; j < puzzle.Size(); j++) {
-      char c;
-      s >> c;
-      debug += c;
-      if (c == '*' || c == '0') {
-        puzzle[i][j] = BitSet::SudokuSquare(puzzle.Size());
-        continue;
-      }
-      if (isalpha(c))
-        puzzle[i][j] = BitSet::SingleBit(puzzle.Size(), static_cast<unsigned>(c - 'A') + 10u);
-      if (isdigit(c))
-        puzzle[i][j] = BitSet::SingleBit(puzzle.Size(), static_cast<unsigned>(c - '0'));
+  // Collect the squares straight from the buffer and parse them at once,
+  // instead of a formatted extraction for each of them.
+  const size_t cells = puzzle.Size() * puzzle.Size();
+  std::istream::sentry guard(s);
+  if (!guard)
+    return s;
+  thread_local std::string text;
+  text.clear();
+  std::streambuf *buffer = s.rdbuf();
+  while (text.size() < cells) {
+    int c = buffer->sbumpc();
+    if (c == std::char_traits<char>::eof()) {
+      s.setstate(std::ios::eofbit | std::ios::failbit);
+      break;
     }
+    if (!isspace(c))
+      text += static_cast<char>(c);
   }
+  ReadPuzzle(text, puzzle);
   return s;
 }
 
-void Sudoku::dfs_traverse(const ChainsGraph& g, unsigned length,
-                  const std::function<void(const std::vector<unsigned>&)> &cb,
-                  std::vector<unsigned> &path, bool weak) {
-  if (path.size() == length) {
-    cb(path);
-    return;
-  }
-
-  unsigned node = path[path.size()-1];
-  std::pair<std::unordered_multimap<unsigned,unsigned>::const_iterator,
-            std::unordered_multimap<unsigned,unsigned>::const_iterator> range;
+size_t ReadPuzzle(std::string_view data, Sudoku &puzzle) {
+  const unsigned cells = puzzle.Size() * puzzle.Size();
+  TrackedGrid grid = puzzle.Grid();
 
-  if (weak) {
-    range = g.weak_links.equal_range(node);
-  } else {
-    range = g.strong_links.equal_range(node);
+  // Records without any separators, as in the corpora, are parsed in bulk.
+  thread_local std::vector<BitSet> parsed;
+  parsed.resize(cells);
+  if (ParseGrid(data, puzzle.Size(), parsed.data())) {
+    for (unsigned cell = 0; cell < cells; cell++) {
+      grid[cell] = parsed[cell];
+    }
+    return cells;
   }
 
-  for (auto i = range.first; i != range.second; i++) {
-    bool found = false;
-    for (auto j : path) {
-      if (j == i->second) found = true;
-    }
-    if (found) continue;
-    path.push_back(i->second);
-    dfs_traverse(g, length, cb, path, !weak);
-    path.pop_back();
+  // Otherwise drop the whitespace separators and parse the squares the same way.
+  thread_local std::string squares;
+  squares.clear();
+  size_t pos = 0;
+  while (squares.size() < cells && pos < data.size()) {
+    char c = data[pos++];
+    if (!isspace(static_cast<unsigned char>(c)))
+      squares += c;
   }
+  if (squares.size() < cells || !ParseGrid(squares, puzzle.Size(), parsed.data()))
+    return 0;
+  for (unsigned cell = 0; cell < cells; cell++) {
+    grid[cell] = parsed[cell];
+  }
+  return pos;
 }
 
-void Sudoku::dfs_traverse(const ChainsGraph& g, unsigned length,
-                  const std::function<void(const std::vector<unsigned>&)> &cb) {
-  std::vector<unsigned> path;
-  for (auto n : g.nodes) {
-    path.push_back(n);
-    dfs_traverse(g, length, cb, path, false);
-    path.pop_back();
-  }
+namespace {
+// Scratch space reused between the calls on the same thread, so that
+// building and traversing the chain graphs doesn't allocate once warmed up.
+struct ChainsScratch {
+  ChainsGraph graph;
+  std::vector<ChainsGraph> graphs;
+  ChainsPath path;
+  AlternatingChainSearch search;
+  AlternatingChainSearch detour;
+  std::vector<unsigned> chain;
+  std::vector<unsigned> detour_chain;
+};
+
+ChainsScratch &GetChainsScratch() {
+  thread_local ChainsScratch scratch;
+  return scratch;
 }
 
-void Sudoku::SolveXChains(unsigned length, unsigned number) {
-  auto graph = GetChains(number);
-  auto cb = [this, number](const std::vector<unsigned> &path){
-    this->PruneNumbersSeenFrom(path, number);
-  };
-  dfs_traverse(graph, length, cb);
+// The other number of a square with two possibilities.
+unsigned OtherNumber(const BitSet &square, unsigned number) {
+  return (square - BitSet::SingleBit(BitSet::BITS, number)).SingletonValue();
 }
 
-bool Sudoku::dfs_traverse(const std::vector<ChainsGraph>& g, const
-                      std::function<bool
-    (const std::vector<unsigned>&)> &cb, std::vector<unsigned> &path,
-                  unsigned number, unsigned next_number) {
+template <typename Callback>
+bool TraverseXYChains(const std::vector<ChainsGraph> &graphs, const BitSet *grid, ChainsPath &path,
+                      Callback &cb, unsigned number, unsigned next_number) {
   if (next_number == number) {
-    return cb(path);
+    return cb(path.Squares());
   }
 
-  unsigned node = path[path.size()-1];
-  std::pair<std::unordered_multimap<unsigned,unsigned>::const_iterator,
-      std::unordered_multimap<unsigned,unsigned>::const_iterator> range;
-
-  range = g[next_number-1].weak_links.equal_range(node);
-  for (auto i = range.first; i != range.second; i++) {
-    bool found = false;
-    for (auto j : path) {
-      if (j == i->second) found = true;
-    }
-    if (found) continue;
+  const ChainsGraph &graph = graphs[next_number-1];
+  for (auto link : graph.Links(graph.NodeId(path.Back()))) {
+    unsigned square = graph.nodes[ChainsGraph::LinkNode(link)];
+    if (path.Contains(square)) continue;
+    if (grid[square].CountSet() != 2) continue;
 
-    if (data_[i->second].CountSet() != 2) continue;
-
-    // what is the other number in the square != source_number
-    unsigned next = 0;
-    for (auto it : BitSetBits(&data_[i->second])) {
-      if (it != next_number) {
-        next = it;
-        break;
-      }
-    }
-    if (next == 0) {
-      abort(); // something completely broken
-    }
-
-    path.push_back(i->second);
-    if (dfs_traverse(g, cb, path, number, next))
+    path.Push(square);
+    if (TraverseXYChains(graphs, grid, path, cb, number, OtherNumber(grid[square], next_number)))
       return true;
-    path.pop_back();
+    path.Pop();
   }
   return false;
 }
 
+template <typename Callback>
+bool TraverseXYChains(const std::vector<ChainsGraph> &graphs, const BitSet *grid, ChainsPath &path,
+                      Callback &&cb, unsigned number) {
+  const ChainsGraph &graph = graphs[number-1];
+  path.Reset(static_cast<unsigned>(graph.node_ids.size()));
+  for (auto n : graph.nodes) {
+    if (grid[n].CountSet() != 2) continue;
+    path.Push(n);
+    if (TraverseXYChains(graphs, grid, path, cb, number, OtherNumber(grid[n], number)))
+      return true;
+    path.Pop();
+  }
+  return false;
+}
+// Call cb(square, chain) for each square that the number can be removed from,
+// because it sees both ends of an alternating chain of at most max_length
+// squares that doesn't pass through it. A square can be reported multiple
+// times, for different ends.
+//
+// The chain is the shortest one between the ends, when it passes through the
+// square, the search is repeated with the square blocked to find a detour.
+template <typename Callback>
+void SearchXChains(const ChainsGraph &graph, const SudokuLayout &layout, unsigned max_length,
+                   ChainsScratch &scratch, Callback &&cb) {
+  if (max_length < 2)
+    return;
+  const unsigned max_links = max_length - 1;
+  auto on_chain = [](std::span<const unsigned> chain, unsigned square) {
+    return std::find(chain.begin(), chain.end(), square) != chain.end();
+  };
 
-bool Sudoku::dfs_traverse(const std::vector<ChainsGraph>& g, const
-                          std::function<bool(const
-                                                                 std::vector<unsigned>&)> &cb,
-                  unsigned number) {
-  std::vector<unsigned> path;
-  for (auto n : g[number-1].nodes) {
-    if (data_[n].CountSet() == 2) {
-      path.push_back(n);
-      // what is the other number in the square != source_number
-      unsigned next = 0;
-      for (auto it : BitSetBits(&data_[n])) {
-        if (it != number) {
-          next = it;
-          break;
+  for (unsigned source = 0; source < graph.nodes.size(); source++) {
+    scratch.search.Run(graph, source, max_links);
+    auto begin = layout.Peers(graph.nodes[source]);
+    for (unsigned end = 0; end < graph.nodes.size(); end++) {
+      if (end == source || !scratch.search.Reaches(end))
+        continue;
+      auto finish = layout.Peers(graph.nodes[end]);
+      bool have_chain = false;
+      for (unsigned word = 0; word < begin.size(); word++) {
+        uint64_t both = begin[word] & finish[word];
+        while (both != 0) {
+          unsigned square = word * 64 + static_cast<unsigned>(std::countr_zero(both));
+          both &= both - 1;
+          unsigned node = graph.NodeId(square);
+          if (node == ChainsGraph::NO_NODE)
+            continue;
+
+          if (!have_chain) {
+            scratch.search.Chain(end, scratch.chain);
+            have_chain = true;
+          }
+          if (!on_chain(scratch.chain, square)) {
+            cb(square, std::span<const unsigned>(scratch.chain));
+            continue;
+          }
+          scratch.detour.Run(graph, source, max_links, node);
+          if (scratch.detour.Reaches(end)) {
+            scratch.detour.Chain(end, scratch.detour_chain);
+            cb(square, std::span<const unsigned>(scratch.detour_chain));
+          }
         }
       }
-      if (next == 0) {
-        abort(); // something completely broken
-      }
-      if (dfs_traverse(g, cb, path, number, next))
-        return true;
-      path.pop_back();
     }
   }
-  return false;
+}
+} // namespace
+
+void Sudoku::SolveXChains(unsigned max_length, unsigned number) {
+  auto &scratch = GetChainsScratch();
+  BuildChains(number, scratch.graph);
+  SearchXChains(scratch.graph, *layout_, max_length, scratch,
+                [this, number](unsigned square, std::span<const unsigned>) { Grid()[square] -= number; });
+}
+
+std::vector<ChainElimination> Sudoku::FindXChains(unsigned max_length, unsigned number) const {
+  auto &scratch = GetChainsScratch();
+  BuildChains(number, scratch.graph);
+  std::vector<ChainElimination> found(data_.size());
+  SearchXChains(scratch.graph, *layout_, max_length, scratch,
+                [&found](unsigned square, std::span<const unsigned> chain) {
+                  auto &elimination = found[square];
+                  if (elimination.chain.empty() || chain.size() < elimination.chain.size())
+                    elimination = ChainElimination{square, std::vector<unsigned>(chain.begin(), chain.end())};
+                });
+
+  std::vector<ChainElimination> result;
+  for (auto &elimination : found) {
+    if (!elimination.chain.empty())
+      result.push_back(std::move(elimination));
+  }
+  return result;
 }
 
 void Sudoku::SolveXYChains() {
-  std::vector<ChainsGraph> graphs;
+  auto &scratch = GetChainsScratch();
+  scratch.graphs.resize(Size());
   for (unsigned i = 1; i <= Size(); i++) {
-    graphs.push_back(GetChains(i));
+    BuildChains(i, scratch.graphs[i-1]);
   }
 
   for (unsigned number = 1; number <= Size(); number++) {
-    auto cb = [this, number](const std::vector<unsigned> &path) -> bool {
+    auto cb = [this, number](std::span<const unsigned> path) -> bool {
       return this->PruneNumbersSeenFrom(path, number);
     };
-    if (dfs_traverse(graphs, cb, number)) return;
+    if (TraverseXYChains(scratch.graphs, data_.data(), scratch.path, cb, number)) return;
   }
 }
 
-bool Sudoku::PruneNumbersSeenFrom(const std::vector<unsigned>& path, unsigned
-                                                                         number) {
-  unsigned begin = path[0];
-  unsigned end = path[path.size()-1];
-
-  const auto &bb = block_mapping_[begin/Size()][begin%Size()];
-  const auto &be = block_mapping_[end/Size()][end%Size()];
+bool Sudoku::PruneNumbersSeenFrom(std::span<const unsigned> path, unsigned number) {
+  auto begin = layout_->Peers(path[0]);
+  auto end = layout_->Peers(path[path.size()-1]);
 
   bool modified = false;
+  for (unsigned word = 0; word < begin.size(); word++) {
+    // Squares seen from both ends of the path.
+    uint64_t both = begin[word] & end[word];
+    while (both != 0) {
+      unsigned square = word * 64 + static_cast<unsigned>(std::countr_zero(both));
+      both &= both - 1;
 
-  std::unordered_set<BitSet *> bs;
-  for (auto s : bb) {
-    for (unsigned i = 0; i < Size(); i++) {
       bool skip = false;
       for (auto j : path) {
-        if (&data_[j] == s->GetSquares()[i]) skip = true;
+        if (j == square) skip = true;
       }
       if (skip) continue;
-      bs.insert(s->GetSquares()[i]);
-    }
-  }
 
-  for (auto s : be) {
-    for (unsigned i = 0; i < Size(); i++) {
-      bool skip = false;
-      for (auto j : path) {
-        if (&data_[j] == s->GetSquares()[i]) skip = true;
-      }
-      if (skip) continue;
-      if (bs.find(s->GetSquares()[i]) != bs.end()) {
-        (*s->GetSquares()[i]) -= number;
-        modified = true;
-      }
+      Grid()[square] -= number;
+      modified = true;
     }
   }
 
   return modified;
 }
 
+const std::vector<KillerBlock> &Sudoku::KillerBlocks() const {
+    static const std::vector<KillerBlock> none;
+    return killers_ ? killers_->blocks : none;
+}
+
+Sudoku::KillerCages &Sudoku::MutableKillers() {
+    // Copies share the killer blocks, detach before the first modification.
+    if (!killers_)
+        killers_ = std::make_shared<KillerCages>();
+    else if (killers_.use_count() > 1)
+        killers_ = std::make_shared<KillerCages>(*killers_);
+    return *killers_;
+}
+
 void Sudoku::PruneKillerBlockSums() {
-    for (auto& killer : killers_) {
-        killer.PruneSumSets();
-        killer.PruneSumSetsBySquare();
+    if (!killers_)
+        return;
+    for (auto& killer : MutableKillers().blocks) {
+        killer.PruneSumSets(data_.data());
+        killer.PruneSumSetsBySquare(data_.data());
     }
 }
 
 void Sudoku::PruneSquaresFromKillerBlocks() {
-    for (auto& killer : killers_) {
+    for (auto& killer : KillerBlocks()) {
         BitSet u = killer.UnionSumSet();
-        for (auto& square : killer.GetSquares()) {
-            (*square) &= u;
+        for (auto square : killer.Cells()) {
+            Grid()[square] &= u;
         }
     }
 }
 
+namespace {
+// Throw std::out_of_range unless the squares are distinct squares of a puzzle
+// of the size and the sum is reachable by that many distinct numbers.
+void CheckKillerBlock(const std::vector<unsigned> &squares, unsigned sum, unsigned size) {
+    const size_t count = squares.size();
+    if (count < 2 || count > size)
+        throw std::out_of_range("Unexpected number of squares in a killer block.");
+    if (sum < count * (count + 1) / 2 || sum > count * (2 * size - count + 1) / 2)
+        throw std::out_of_range("Unexpected sum of a killer block.");
+    for (size_t i = 0; i < count; i++) {
+        if (squares[i] >= size * size)
+            throw std::out_of_range("Killer block square outside of the puzzle.");
+        if (std::find(squares.begin(), squares.begin() + static_cast<ptrdiff_t>(i), squares[i]) !=
+            squares.begin() + static_cast<ptrdiff_t>(i))
+            throw std::out_of_range("Duplicate square in a killer block.");
+    }
+}
+} // namespace
+
+void Sudoku::AddKillerBlock(std::vector<unsigned> squares, unsigned sum) {
+    CheckKillerBlock(squares, sum, Size());
+    MutableKillers().blocks.emplace_back(std::move(squares), Max(), sum);
+}
+
 void Sudoku::PreBuildKillerMapping() {
-    for (unsigned killerId = 0; killerId < killers_.size(); killerId++) {
-        auto &killer = killers_[killerId];
-        std::vector<UniqueBlock *> intersection = GetBlockMapping(killer.GetSquares()[0]);
-        for (unsigned i = 1; i < killer.GetSquares().size(); i++) {
-            std::vector<UniqueBlock *> current = GetBlockMapping(killer.GetSquares()[i]);
-            std::vector<UniqueBlock *> new_inter;
+    KillerCages &killers = MutableKillers();
+    for (unsigned killerId = 0; killerId < killers.blocks.size(); killerId++) {
+        auto &killer = killers.blocks[killerId];
+        std::vector<unsigned> intersection = GetBlockMapping(killer.Cells()[0]);
+        for (unsigned i = 1; i < killer.Cells().size(); i++) {
+            const std::vector<unsigned> &current = GetBlockMapping(killer.Cells()[i]);
+            std::vector<unsigned> new_inter;
             std::set_intersection(intersection.begin(), intersection.end(),
                                   current.begin(), current.end(),
                                   std::back_inserter(new_inter));
             intersection.swap(new_inter);
         }
 
-        for (auto &block : intersection) {
-            unsigned offset = static_cast<unsigned>(block - &checks_[0]);
-            contained_killer_blocks_.insert(std::make_pair(offset, killerId));
+        for (auto block : intersection) {
+            killers.contained.emplace_back(block, killerId);
         }
     }
+    std::sort(killers.contained.begin(), killers.contained.end());
 }
 
 void Sudoku::ProcessContainedKillerBlocks(unsigned blockId, unsigned &num_squares, unsigned &killer_sum, BitSet &found) {
     num_squares = 0;
     killer_sum = 0;
-    found = BitSet::SudokuSquare(checks_[blockId].Size());
-    auto range = contained_killer_blocks_.equal_range(blockId);
-    for (auto it = range.first; it != range.second; it++) {
-        num_squares += killers_[it->second].Size();
-        killer_sum += killers_[it->second].Sum();
+    const UniqueBlock &block = Blocks()[blockId];
+    found = BitSet::SudokuSquare(block.Size());
+    if (!killers_)
+        return;
+    const auto &contained = killers_->contained;
+    auto it = std::lower_bound(contained.begin(), contained.end(), std::make_pair(blockId, 0u));
+    for (; it != contained.end() && it->first == blockId; it++) {
+        const KillerBlock &killer = killers_->blocks[it->second];
+        num_squares += killer.Size();
+        killer_sum += killer.Sum();
         // go over all the squares within the killer block
-        for (auto &square : killers_[it->second].GetSquares()) {
-            for (unsigned i = 0; i < checks_[blockId].Size(); i++) {
-                if (square == checks_[blockId].GetSquares()[i]) {
+        for (auto square : killer.Cells()) {
+            for (unsigned i = 0; i < block.Size(); i++) {
+                if (square == block.Cells()[i]) {
                     found -= (i+1);
                 }
             }
@@ -578,31 +859,33 @@ void Sudoku::ProcessContainedKillerBlocks(unsigned blockId, unsigned &num_square
 }
 
 void Sudoku::AddKillerSingles() {
-    for (unsigned blockId = 0; blockId < checks_.size(); blockId++) {
+    for (unsigned blockId = 0; blockId < Blocks().size(); blockId++) {
+        const UniqueBlock &block = Blocks()[blockId];
         unsigned num_squares = 0;
         unsigned killer_sum = 0;
-        BitSet found = BitSet::SudokuSquare(checks_[blockId].Size());
+        BitSet found = BitSet::SudokuSquare(block.Size());
         ProcessContainedKillerBlocks(blockId, num_squares, killer_sum, found);
-        if (num_squares == checks_[blockId].Size() - 1) {
+        if (num_squares == block.Size() - 1) {
             assert(found.HasSingletonValue());
-            auto square = checks_[blockId].GetSquares()[found.SingletonValue()-1];
-            (*square) = BitSet::SingleBit(checks_[blockId].Max(), block_sums.at(checks_[blockId].Size()) - killer_sum);
+            auto square = block.Cells()[found.SingletonValue()-1];
+            Grid()[square] = BitSet::SingleBit(block.Max(), block_sums.at(block.Size()) - killer_sum);
         }
     }
 }
 
 void Sudoku::AddKillerRemainders(unsigned size) {
-    for (unsigned blockId = 0; blockId < checks_.size(); blockId++) {
+    for (unsigned blockId = 0; blockId < Blocks().size(); blockId++) {
+        const UniqueBlock &block = Blocks()[blockId];
         unsigned num_squares = 0;
         unsigned killer_sum = 0;
-        BitSet found = BitSet::SudokuSquare(checks_[blockId].Size());
+        BitSet found = BitSet::SudokuSquare(block.Size());
         ProcessContainedKillerBlocks(blockId, num_squares, killer_sum, found);
-        if (num_squares == checks_[blockId].Size() - size) {
-            std::vector<BitSet*> squares;
+        if (num_squares == block.Size() - size) {
+            std::vector<unsigned> squares;
             for (auto bit : BitSetBits(&found)) {
-                squares.push_back(checks_[blockId].GetSquares()[bit-1]);
+                squares.push_back(block.Cells()[bit-1]);
             }
-            killers_.emplace_back(std::move(squares), checks_[blockId].Max(), block_sums.at(checks_[blockId].Size()) - killer_sum);
+            MutableKillers().blocks.emplace_back(std::move(squares), block.Max(), block_sums.at(block.Size()) - killer_sum);
         }
     }
 }
@@ -610,9 +893,8 @@ void Sudoku::AddKillerRemainders(unsigned size) {
 void Sudoku::SerializeKillerBlock(const KillerBlock& k, std::ostream& s) const {
     s << 0 << ":"; // killer block tag
     s << k.Size() << ":" << k.Sum() << ":";
-    for (auto& square : k.GetSquares()) {
-        unsigned offset = static_cast<unsigned>(square-&data_[0]);
-        s << offset << ":";
+    for (auto square : k.Cells()) {
+        s << square << ":";
     }
 }
 
@@ -630,7 +912,7 @@ std::string Sudoku::Serialize() const {
     }
     // puzzle type
     s << static_cast<int>(puzzle_type_) << ":";
-    for (auto &killer : killers_) {
+    for (auto &killer : KillerBlocks()) {
         SerializeKillerBlock(killer, s);
     }
     return s.str();
@@ -642,16 +924,30 @@ void Sudoku::DeserializeKillerBlock(std::istream& s) {
     s >> number_of_squares >> delim >> sum >> delim;
     if (!s)
         throw std::runtime_error("Unexpected data in deserialized killer block.");
-    std::vector<BitSet*> squares;
+    std::vector<unsigned> squares;
     for (unsigned i = 0; i < number_of_squares; i++) {
         unsigned offset;
         s >> offset >> delim;
         if (!s)
             throw std::runtime_error("Unexpected offset data in deserialized killer block.");
-        squares.push_back(&data_[offset]);
+        if (offset >= data_.size())
+            throw std::out_of_range("Killer block square outside of the puzzle.");
+        squares.push_back(offset);
     }
 
-    killers_.emplace_back(std::move(squares), Max(), sum);
+    MutableKillers().blocks.emplace_back(std::move(squares), Max(), sum);
+}
+
+void Sudoku::ResetDeserialized() {
+    layout_ = SudokuLayout::Get(size_, puzzle_type_);
+    // Same state as a freshly constructed puzzle with the squares filled in.
+    changes_ = ChangeTracker(layout_->mapping, PositionIndex(layout_->mapping, layout_->offsets,
+                                                             static_cast<unsigned>(layout_->blocks.size()), size_, data_.data()));
+    for (unsigned i = 0; i < data_.size(); i++) {
+        if (data_[i] != BitSet::SudokuSquare(size_))
+            changes_.MarkChanged(i);
+    }
+    killers_.reset();
 }
 
 void Sudoku::Deserialize(const std::string &data) {
@@ -671,11 +967,7 @@ void Sudoku::Deserialize(const std::string &data) {
     if (!s)
         throw std::runtime_error("Unexpected data in deserialized puzzle.");
     size_ = rows;
-    data_ = std::vector<BitSet>(size_*size_, BitSet{size_});
-    block_mapping_ = std::vector<std::vector<std::vector<UniqueBlock *>>>(size_, std::vector<std::vector<UniqueBlock *>>(size_, std::vector<UniqueBlock *>()));
-    checks_.clear();
-    row_checks_.clear();
-    col_checks_.clear();
+    data_ = std::vector<BitSet>(size_*size_, BitSet::Empty(size_));
 
     for (unsigned i = 0; i < Size(); i++) {
         for (unsigned j = 0; j < Size(); j++) {
@@ -693,7 +985,7 @@ void Sudoku::Deserialize(const std::string &data) {
     if (type > static_cast<unsigned>(DIAGONAL))
         throw std::out_of_range("Unexpected type of sudoku.");
     puzzle_type_ = static_cast<SudokuTypes>(type);
-    SetupCheckers(size_, puzzle_type_);
+    ResetDeserialized();
 
     // Read additional blocks.
     unsigned block_type = 0;
@@ -705,4 +997,104 @@ void Sudoku::Deserialize(const std::string &data) {
     }
 }
 
+namespace {
+constexpr uint8_t BINARY_VERSION = 1;
+// Version, size, type, reserved byte and the number of killer blocks.
+constexpr size_t BINARY_HEADER_SIZE = 8;
+
+void PutLittleEndian(std::string &out, uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t GetLittleEndian(const char *data, unsigned bytes) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+} // namespace
+
+void Sudoku::SerializeBinary(std::string &out) const {
+    const unsigned mask_bytes = (size_ + 7) / 8;
+    out.reserve(out.size() + BINARY_HEADER_SIZE + data_.size() * mask_bytes);
+    out += static_cast<char>(BINARY_VERSION);
+    out += static_cast<char>(size_);
+    out += static_cast<char>(puzzle_type_);
+    out += '\0';
+    PutLittleEndian(out, KillerBlocks().size(), 4);
+    for (const auto &square : data_) {
+        PutLittleEndian(out, square.data_, mask_bytes);
+    }
+    for (const auto &killer : KillerBlocks()) {
+        PutLittleEndian(out, killer.Sum(), 2);
+        PutLittleEndian(out, killer.Size(), 2);
+        for (auto square : killer.Cells()) {
+            PutLittleEndian(out, square, 2);
+        }
+    }
+}
+
+size_t Sudoku::DeserializeBinary(std::string_view data) {
+    if (data.size() < BINARY_HEADER_SIZE)
+        throw std::runtime_error("Unexpected end of binary puzzle.");
+    if (static_cast<uint8_t>(data[0]) != BINARY_VERSION)
+        throw std::out_of_range("Currently only version 1 of binary format is supported.");
+    const unsigned size = static_cast<uint8_t>(data[1]);
+    const unsigned type = static_cast<uint8_t>(data[2]);
+    if (size == 0 || size > BitSet::BITS)
+        throw std::out_of_range("Unexpected size of sudoku.");
+    if (type > static_cast<unsigned>(DIAGONAL))
+        throw std::out_of_range("Unexpected type of sudoku.");
+    const uint64_t killers = GetLittleEndian(data.data() + 4, 4);
+
+    const unsigned mask_bytes = (size + 7) / 8;
+    const size_t cells = size * size;
+    if (data.size() - BINARY_HEADER_SIZE < cells * mask_bytes)
+        throw std::runtime_error("Unexpected end of binary puzzle.");
+    // Everything is validated before the puzzle is modified, so that a
+    // malformed record leaves the puzzle as it was.
+    const BitSet all = BitSet::SudokuSquare(size);
+    const char *squares_data = data.data() + BINARY_HEADER_SIZE;
+    for (size_t i = 0; i < cells; i++) {
+        if ((BitSet::FromValue(GetLittleEndian(squares_data + i * mask_bytes, mask_bytes)) - all) != BitSet::Empty(size))
+            throw std::out_of_range("Square possibilities outside of the puzzle.");
+    }
+    size_t pos = BINARY_HEADER_SIZE + cells * mask_bytes;
+
+    std::vector<KillerBlock> blocks;
+    for (uint64_t k = 0; k < killers; k++) {
+        if (data.size() - pos < 4)
+            throw std::runtime_error("Unexpected end of binary killer block.");
+        unsigned sum = static_cast<unsigned>(GetLittleEndian(data.data() + pos, 2));
+        unsigned count = static_cast<unsigned>(GetLittleEndian(data.data() + pos + 2, 2));
+        pos += 4;
+        if (count < 2 || count > size || sum < count * (count + 1) / 2 || sum > count * (2 * size - count + 1) / 2)
+            throw std::out_of_range("Unexpected killer block.");
+        if (data.size() - pos < 2 * size_t{count})
+            throw std::runtime_error("Unexpected end of binary killer block.");
+        std::vector<unsigned> squares;
+        for (unsigned i = 0; i < count; i++) {
+            unsigned offset = static_cast<unsigned>(GetLittleEndian(data.data() + pos, 2));
+            pos += 2;
+            squares.push_back(offset);
+        }
+        CheckKillerBlock(squares, sum, size);
+        blocks.emplace_back(std::move(squares), size, sum);
+    }
+
+    size_ = size;
+    puzzle_type_ = static_cast<SudokuTypes>(type);
+    data_.resize(cells);
+    for (size_t i = 0; i < cells; i++) {
+        data_[i].data_ = GetLittleEndian(squares_data + i * mask_bytes, mask_bytes);
+    }
+    ResetDeserialized();
+    if (!blocks.empty())
+        MutableKillers().blocks = std::move(blocks);
+    return pos;
+}
+
 } // namespace sudoku
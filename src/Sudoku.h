@@ -3,15 +3,21 @@
 #define SUDOKU_SUDOKU_H
 
 #include "core/BitSet.h"
+#include "core/ChainsGraph.h"
+#include "core/ChangeTracker.h"
+#include "core/StaticLayout.h"
 #include "core/UniqueBlock.h"
 #include <cstdint>
 #include <cstring>
 #include <functional>
 #include <iosfwd>
+#include <memory>
 #include <set>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "killer/KillerBlock.h"
 
@@ -20,30 +26,47 @@ enum SudokuTypes { BASIC = 1, DIAGONAL = 2 };
 namespace sudoku {
 class Sudoku;
 
+//! Write the puzzle as a text grid, throws std::out_of_range for puzzles
+//! larger than 35x35, use Sudoku::Serialize for those.
 std::ostream &operator<<(std::ostream &s, const Sudoku &puzzle);
 std::istream &operator>>(std::istream &s, Sudoku &puzzle);
 
+/*! Read the puzzle directly from its textual representation.
+ *
+ * Accepts the same format as operator>>, whitespace is skipped, '0', '.' and
+ * '*' denote an empty square.
+ *
+ * @param data Text containing the puzzle.
+ * @param puzzle Puzzle to fill, already constructed with the desired size.
+ * @return Number of characters consumed, 0 if data does not contain the whole
+ *         puzzle or has a character that isn't a square of the puzzle, in
+ *         which case the puzzle is left unmodified.
+ */
+size_t ReadPuzzle(std::string_view data, Sudoku &puzzle);
+
 class SudokuRow {
 public:
   SudokuRow() = delete;
   SudokuRow(const SudokuRow &) = default;
   SudokuRow(SudokuRow &&) = default;
 
-  BitSet &operator[](unsigned index) {
+  SquareRef operator[](unsigned index) {
     assert(index < len_);
-    return data_[index];
+    return grid_[offset_ + index];
   }
   const BitSet &operator[](unsigned index) const {
     assert(index < len_);
-    return data_[index];
+    return grid_.Data()[offset_ + index];
   }
 
   unsigned Size() const { return len_; }
 
 private:
-  SudokuRow(BitSet *data, unsigned len) : data_(data), len_(len) {}
+  SudokuRow(TrackedGrid grid, unsigned offset, unsigned len)
+      : grid_(grid), offset_(offset), len_(len) {}
 
-  BitSet *data_;
+  TrackedGrid grid_;
+  unsigned offset_;
   unsigned len_;
   friend class Sudoku;
   friend class ConstSudokuRow;
@@ -54,8 +77,8 @@ public:
   ConstSudokuRow() = delete;
   ConstSudokuRow(const ConstSudokuRow &) = default;
   ConstSudokuRow(ConstSudokuRow &&) = default;
-  ConstSudokuRow(const SudokuRow &r) : data_(r.data_), len_(r.len_) {}
-  ConstSudokuRow(SudokuRow &&r) : data_(r.data_), len_(r.len_) {}
+  ConstSudokuRow(const SudokuRow &r) : data_(r.grid_.Data() + r.offset_), len_(r.len_) {}
+  ConstSudokuRow(SudokuRow &&r) : data_(r.grid_.Data() + r.offset_), len_(r.len_) {}
 
   const BitSet &operator[](unsigned index) const {
     assert(index < len_);
@@ -72,36 +95,100 @@ private:
   friend class Sudoku;
 };
 
-struct ChainsGraph {
-  // Absolute position of the square inside of the puzzle.
-  std::vector<unsigned> nodes;
-  std::unordered_multimap<unsigned, unsigned> weak_links;
-  std::unordered_multimap<unsigned, unsigned> strong_links;
+/*! Block structure of a puzzle.
+ *
+ * Depends only on the size and type of the puzzle and never changes after
+ * construction, so a single instance is shared by all the puzzles of the
+ * same size and type, see Get().
+ */
+struct SudokuLayout {
+  std::vector<UniqueBlock> blocks;
+  std::vector<const UniqueBlock *> rows;
+  std::vector<const UniqueBlock *> cols;
+  // Ids of the blocks containing each square, in increasing order.
+  std::vector<std::vector<unsigned>> mapping;
+  // Position of each square inside of the blocks listed in mapping.
+  std::vector<std::vector<unsigned>> offsets;
+  // Squares in each row and column of a box, 0 if the puzzle size has no
+  // boxes. The boxes are as close to a square as the size allows, never
+  // higher than wide, e.g. 2x3 for 6x6 puzzles and 5x5 for 25x25 ones.
+  unsigned box_rows = 0;
+  unsigned box_cols = 0;
+  // Size of the boxes if they are square, 0 otherwise.
+  unsigned box_size = 0;
+  // Number of 64 bit words in the peer mask of a square.
+  unsigned peer_words = 0;
+  // Squares sharing a block with each square, peer_words per square.
+  std::vector<uint64_t> peers;
+
+  //! Ordered pair of blocks that share at least one square.
+  struct Intersection {
+    unsigned forcing;
+    unsigned checked;
+    // Positions of the shared squares inside of each of the blocks, 1-based
+    // the same as in PositionIndex.
+    BitSet forcing_positions;
+    BitSet checked_positions;
+  };
+  // All intersecting pairs of blocks, ordered by the forcing and then by the
+  // checked block id.
+  std::vector<Intersection> intersections;
+
+  /*! Build the layout for a puzzle.
+   *
+   * 9x9 and 16x16 puzzles are loaded from the compile-time tables in
+   * StaticLayout.h, other sizes are built at runtime. Sizes that are a prime
+   * number have no boxes, only rows, columns and possibly the diagonals.
+   */
+  SudokuLayout(unsigned size, SudokuTypes type);
+
+  //! Return the shared layout for the size and type, built on first use.
+  static std::shared_ptr<const SudokuLayout> Get(unsigned size, SudokuTypes type);
+
+  /*! Return the peers of a square as a bitmask over the squares of the puzzle.
+   *
+   * The squares seen from both a and b are the intersection of their peers.
+   */
+  std::span<const uint64_t> Peers(unsigned cell) const {
+    return std::span<const uint64_t>(peers).subspan(static_cast<size_t>(cell) * peer_words, peer_words);
+  }
+
+private:
+  template <unsigned Size, bool Diagonal>
+  void Load(const StaticLayout<Size, Diagonal> &table);
+  void Build(unsigned size, SudokuTypes type);
+  void AddBlock(std::vector<unsigned> cells, unsigned size);
+  void BuildIntersections(unsigned size);
 };
 
 class Sudoku {
 public:
   /*! Construct an empty Sudoku of the given size and type.
    *
-   * @param size Size of the Sudoku {9x9}, {16x16}, {25x25}.
+   * @param size Size of the Sudoku, from 4x4 up to 64x64. The boxes of the
+   *        BASIC puzzles follow from the size, see SudokuLayout, a prime
+   *        size only has rows and columns.
    * @param type BASIC or DIAGONAL
    */
   Sudoku(unsigned size = 9, SudokuTypes type = BASIC);
 
-  // Removed copy constructor.
-  Sudoku(const Sudoku &) = delete;
-  // Removed move constructor.
-  Sudoku(Sudoku &&) = delete;
-  // Removed assignment operator
-  Sudoku &operator=(const Sudoku &) = delete;
-  // Removed move assignment operator.
-  Sudoku &operator=(Sudoku &&) = delete;
+  /*! Copying a puzzle copies the squares, killer blocks and the change
+   * tracking state, the block structure is shared.
+   */
+  Sudoku(const Sudoku &) = default;
+  Sudoku(Sudoku &&) = default;
+  Sudoku &operator=(const Sudoku &) = default;
+  Sudoku &operator=(Sudoku &&) = default;
 
   /*! Build a strong/weak link graph of number possibilities
    *
    * @return The built graph.
    */
   ChainsGraph GetChains(unsigned number) const;
+  /*! Build a strong/weak link graph of number possibilities, reusing the
+   * storage of the graph.
+   */
+  void BuildChains(unsigned number, ChainsGraph &graph) const;
 
   /*! Build a weak link graph of squares with two possibilities.
    *
@@ -109,7 +196,7 @@ public:
    */
    ChainsGraph GetPairChains() const;
 
-  bool PruneNumbersSeenFrom(const std::vector<unsigned>& path, unsigned number);
+  bool PruneNumbersSeenFrom(std::span<const unsigned> path, unsigned number);
 
   void SetSolution(const Sudoku* solution) {
     solution_ = solution;
@@ -139,13 +226,33 @@ public:
   std::string Serialize() const;
   void Deserialize(const std::string& data);
 
+  /*! Append the binary form of the puzzle to the buffer.
+   *
+   * Version 1 of the format, all values little endian:
+   *   - u8 version, u8 size, u8 type, u8 reserved, u32 number of killer blocks
+   *   - the possibilities of each square, bit number-1 set for each possible
+   *     number, packed into (size+7)/8 bytes
+   *   - for each killer block: u16 sum, u16 number of squares, u16 squares
+   *
+   * Like the text form, it keeps the possibilities, the type and the killer
+   * blocks, so the two convert into each other without loss.
+   */
+  void SerializeBinary(std::string &out) const;
+  /*! Replace the puzzle with the binary form at the start of the data.
+   *
+   * @return Number of bytes read.
+   * @throws std::runtime_error, std::out_of_range If the data is truncated
+   *         or malformed, the puzzle is left unmodified.
+   */
+  size_t DeserializeBinary(std::string_view data);
+
   /*! Square bracket operator to allow for 2D access.
    *
    * @param index Row index to return.
    * @return A wrapper object around a row in the puzzle.
    */
   SudokuRow operator[](unsigned index) {
-    return SudokuRow(&data_[index*Size()], Size());
+    return SudokuRow(Grid(), index*Size(), Size());
   }
   /*! Square bracket operator to allow for 2D access.
    *
@@ -161,14 +268,16 @@ public:
    * @return True if a square was changed since last ResetChange(), false
    *         otherwise.
    */
-  bool HasChange() const;
+  bool HasChange() const { return changes_.HasChange(); }
   //! Reset the changed flag on all squares in the puzzle.
-  void ResetChange();
+  void ResetChange() { changes_.Reset(); }
   /*! Return the set of blocks that contain changed squares.
    *
-   * @return Set of blocks.
+   * @return Set of indexes into Blocks().
    */
-  std::unordered_set<UniqueBlock *> ChangedBlocks() const;
+  BlockMask ChangedBlocks() const { return changes_.ChangedBlocks(); }
+  //! Return the total number of candidates removed from the squares so far.
+  uint64_t Eliminated() const { return changes_.Eliminated(); }
 
   //! Return the size of the Sudoku.
   unsigned Size() const { return size_; }
@@ -176,19 +285,46 @@ public:
   //! Return the maximum number used in the Sudoku.
   unsigned Max() const { return size_; }
 
+  //! Return the type of the Sudoku.
+  SudokuTypes Type() const { return puzzle_type_; }
+
   //! Return a const reference to the list of blocks.
-  const std::vector<UniqueBlock> &Blocks() const { return checks_; }
-  //! Return a reference to the list of blocks.
-  std::vector<UniqueBlock> &Blocks() { return checks_; }
+  const std::vector<UniqueBlock> &Blocks() const { return layout_->blocks; }
   //! Return a const reference to the row blocks.
-  const std::vector<UniqueBlock *> &GetRowBlocks() const {
-    return row_checks_;
+  const std::vector<const UniqueBlock *> &GetRowBlocks() const {
+    return layout_->rows;
   }
   //! Return a const reference to the column blocks.
-  const std::vector<UniqueBlock *> &GetColBlocks() const {
-    return col_checks_;
+  const std::vector<const UniqueBlock *> &GetColBlocks() const {
+    return layout_->cols;
   }
 
+  //! Return the id of a block of this puzzle, i.e. its index in Blocks().
+  unsigned BlockId(const UniqueBlock &block) const {
+    return static_cast<unsigned>(&block - Blocks().data());
+  }
+
+  //! Return the positions of the numbers inside of the blocks, kept up to date with the squares.
+  const PositionIndex &Positions() const { return changes_.Index(); }
+  //! Return the positions of all the numbers inside of a block of this puzzle.
+  BlockPositions Positions(const UniqueBlock &block) const {
+    return Positions().Numbers(BlockId(block));
+  }
+
+  //! Return the squares of a block of this puzzle.
+  BlockSquares<TrackedGrid> Squares(const UniqueBlock &block) {
+    return block.GetSquares(Grid());
+  }
+  //! Return the squares of a block of this puzzle.
+  BlockSquares<const BitSet *> Squares(const UniqueBlock &block) const {
+    return block.GetSquares(Data());
+  }
+
+  //! Return the squares of the puzzle in row-major order, modifications are tracked.
+  TrackedGrid Grid() { return TrackedGrid(data_.data(), changes_); }
+  //! Return the squares of the puzzle in row-major order.
+  const BitSet *Data() const { return data_.data(); }
+
   //! Return whether all squares are set.
   bool IsSet() const;
   //! Return whether there is any conflict in the puzzle.
@@ -198,18 +334,63 @@ public:
   void DebugPrint(std::ostream &s);
   std::string DebugString();
 
-  //! Solve fish for a given size and a number.
+  /*! Remove the numbers of solved squares from all the blocks containing
+   * them, until there are no more naked singles to propagate.
+   *
+   * Puzzles up to 16x16 with square boxes use the packed grid kernels (see
+   * NakedSingles.h), the other ones propagate through the blocks of the
+   * layout, at a cost bounded by the squares of the blocks.
+   */
+  void SolveNakedSingles();
+
+  /*! Remove numbers locked inside of an intersection of two blocks from the
+   * rest of the second block (pointing and claiming).
+   *
+   * Gives the same results as SolveBlockIntersection() over all the pairs of
+   * Blocks(), but only visits the pairs that intersect and tests each number
+   * with a few bit operations on the position index.
+   */
+  void SolveBlockIntersections();
+
+  /*! Solve fish for a given size and a number.
+   *
+   * Fish larger than half of the unsolved rows are skipped, they make the same
+   * eliminations as the smaller fish in the other direction.
+   */
   void SolveFish(unsigned size, unsigned number);
 
   //! Solve finned fish for a given size and a number.
   void SolveFinnedFish(unsigned size, unsigned number);
 
-  //! Solve X chains for a given length and a number.
-  void SolveXChains(unsigned length, unsigned number);
+  /*! Solve X chains up to a given length for a number.
+   *
+   * Covers chains of all the even lengths up to max_length (the number of
+   * squares of the chain) in one breadth first pass, with the same
+   * eliminations as traversing the chains of each length.
+   */
+  void SolveXChains(unsigned max_length, unsigned number);
+
+  /*! Find the X chain eliminations up to a given length for a number,
+   * without modifying the puzzle.
+   *
+   * @return Eliminations ordered by square, each with the shortest chain
+   *         that implies it.
+   */
+  std::vector<ChainElimination> FindXChains(unsigned max_length, unsigned number) const;
 
   //! Solve XY chains for a given number.
   void SolveXYChains();
 
+  /*! Add a killer block of at least two squares, the numbers in the squares are unique and add up to the sum.
+   *
+   * @throws std::out_of_range If the squares aren't distinct squares of the
+   *         puzzle, there are more of them than numbers, or no distinct
+   *         numbers add up to the sum.
+   */
+  void AddKillerBlock(std::vector<unsigned> squares, unsigned sum);
+  //! Return the killer blocks of the puzzle.
+  const std::vector<KillerBlock> &KillerBlocks() const;
+
   //! Remove impossible sums from killer blocks, based on the square contents.
   void PruneKillerBlockSums();
   //! Remove impossible number from squares inside of killer blocks.
@@ -223,34 +404,32 @@ public:
   void AddKillerRemainders(unsigned size);
 
 private:
-  std::vector<UniqueBlock> checks_;
-  std::vector<UniqueBlock *> row_checks_;
-  std::vector<UniqueBlock *> col_checks_;
+  std::shared_ptr<const SudokuLayout> layout_;
   std::vector<BitSet> data_;
-  std::vector<BitSet> data_copy_;
-  std::vector<std::vector<std::vector<UniqueBlock *>>> block_mapping_;
-  std::vector<KillerBlock> killers_;
-  std::unordered_multimap<unsigned, unsigned> contained_killer_blocks_;
+  ChangeTracker changes_;
+  // Killer blocks of the puzzle, shared between copies of the puzzle until
+  // one of them modifies the blocks (see MutableKillers()).
+  struct KillerCages {
+    std::vector<KillerBlock> blocks;
+    // (block, killer block) pairs of killer blocks fully contained in a
+    // standard block, sorted by block.
+    std::vector<std::pair<unsigned, unsigned>> contained;
+  };
+  std::shared_ptr<KillerCages> killers_;
 
   unsigned size_;
   const Sudoku* solution_;
   SudokuTypes puzzle_type_;
 
-  void MakeCopy() { data_copy_ = data_;}
-  void SwapCopy() {
-    for (unsigned i = 0; i < Size()*Size(); i++) {
-      data_[i] = data_copy_[i];
-    }
-  }
-
+  KillerCages &MutableKillers();
   void DeserializeKillerBlock(std::istream& s);
   void SerializeKillerBlock(const KillerBlock& k, std::ostream& s) const;
+  // Reset the change tracking to that of a fresh puzzle of the current size
+  // and type with the squares filled in, and drop the killer blocks.
+  void ResetDeserialized();
 
-  void SetupCheckers(unsigned size, SudokuTypes type);
-
-  std::vector<UniqueBlock *> GetBlockMapping(BitSet* square) const {
-      unsigned off = static_cast<unsigned>(square - &data_[0]);
-      return block_mapping_[off/Size()][off%Size()];
+  const std::vector<unsigned> &GetBlockMapping(unsigned square) const {
+      return layout_->mapping[square];
   }
 
   unsigned NumberOfSharedBlocks(std::pair<unsigned, unsigned> l,
@@ -258,31 +437,15 @@ private:
 
   void ProcessContainedKillerBlocks(unsigned blockId, unsigned &num_squares, unsigned &killer_sum, BitSet &found);
 
-  bool dfs_traverse(const std::vector<ChainsGraph>& g, const std::function<bool
-      (const std::vector<unsigned>&)> &cb, std::vector<unsigned> &path,
-                    unsigned number, unsigned next_number);
-
-  bool dfs_traverse(const std::vector<ChainsGraph>& g, const std::function<bool
-                                                                           (const
-                                                              std::vector<unsigned>&)> &cb,
-               unsigned number);
-
-  void dfs_traverse(const ChainsGraph& g, unsigned length,
-                    const std::function<void(const std::vector<unsigned>&)>
-                        &cb);
-
-  void dfs_traverse(const ChainsGraph& g, unsigned length,
-                    const std::function<void(const std::vector<unsigned>&)> &cb,
-                    std::vector<unsigned> &path, bool weak);
-
-  friend std::vector<std::vector<std::vector<UniqueBlock *>>> &
+  friend const std::vector<std::vector<unsigned>> &
   TestGetMappings(Sudoku &s);
 
   friend std::istream &operator>>(std::istream &s, Sudoku &puzzle);
+  friend size_t ReadPuzzle(std::string_view data, Sudoku &puzzle);
 
   friend void TestInjectKillerBlock(Sudoku &s, unsigned sum, const std::vector<unsigned>& offsets);
-  friend std::unordered_multimap<unsigned, unsigned>& TestGetContainedKillerBlocks(Sudoku &s) {
-      return s.contained_killer_blocks_;
+  friend const std::vector<std::pair<unsigned, unsigned>>& TestGetContainedKillerBlocks(Sudoku &s) {
+      return s.MutableKillers().contained;
   }
 };
 } // namespace sudoku
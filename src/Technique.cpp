@@ -0,0 +1,49 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "Technique.h"
+#include <iterator>
+
+namespace {
+
+const TechniqueInfo TECHNIQUES[] = {
+    {TechniqueKind::GROUPS, 1, "singles"},
+    {TechniqueKind::GROUPS, 2, "groups_2"},
+    {TechniqueKind::KILLER_SUMS, 0, "killer_sums"},
+    {TechniqueKind::INTERSECTIONS, 0, "intersections"},
+    {TechniqueKind::GROUPS, 3, "groups_3"},
+    {TechniqueKind::FISH, 2, "fish_2"},
+    {TechniqueKind::XCHAINS, 4, "xchains_4"},
+    {TechniqueKind::GROUPS, 4, "groups_4"},
+    {TechniqueKind::FISH, 3, "fish_3"},
+    {TechniqueKind::FINNED_FISH, 2, "finned_fish_2"},
+    {TechniqueKind::XCHAINS, 6, "xchains_6"},
+    {TechniqueKind::FINNED_FISH, 3, "finned_fish_3"},
+    {TechniqueKind::FISH, 4, "fish_4"},
+    {TechniqueKind::FISH, 5, "fish_5"},
+    {TechniqueKind::FISH, 6, "fish_6"},
+    {TechniqueKind::FISH, 7, "fish_7"},
+    {TechniqueKind::XCHAINS, 8, "xchains_8"},
+    {TechniqueKind::FINNED_FISH, 4, "finned_fish_4"},
+    {TechniqueKind::XCHAINS, 10, "xchains_10"},
+    {TechniqueKind::XYCHAINS, 0, "xychains"},
+    {TechniqueKind::FINNED_FISH, 5, "finned_fish_5"},
+    {TechniqueKind::FINNED_FISH, 6, "finned_fish_6"},
+    {TechniqueKind::FINNED_FISH, 7, "finned_fish_7"},
+};
+static_assert(std::size(TECHNIQUES) == TECHNIQUE_COUNT);
+
+} // namespace
+
+const TechniqueInfo &GetTechniqueInfo(Technique technique) {
+  return TECHNIQUES[static_cast<unsigned>(technique)];
+}
+
+bool FindTechnique(std::string_view name, Technique &technique) {
+  for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+    if (name == TECHNIQUES[i].name) {
+      technique = static_cast<Technique>(i);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,54 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_TECHNIQUE_H
+#define SUDOKU_TECHNIQUE_H
+
+#include <string_view>
+
+//! Solving techniques, in the reference order of SmartSolver::SingleStep.
+enum class Technique : unsigned {
+  SINGLES,
+  GROUPS_2,
+  KILLER_SUMS,
+  INTERSECTIONS,
+  GROUPS_3,
+  FISH_2,
+  XCHAINS_4,
+  GROUPS_4,
+  FISH_3,
+  FINNED_FISH_2,
+  XCHAINS_6,
+  FINNED_FISH_3,
+  FISH_4,
+  FISH_5,
+  FISH_6,
+  FISH_7,
+  XCHAINS_8,
+  FINNED_FISH_4,
+  XCHAINS_10,
+  XYCHAINS,
+  FINNED_FISH_5,
+  FINNED_FISH_6,
+  FINNED_FISH_7,
+  COUNT
+};
+
+constexpr unsigned TECHNIQUE_COUNT = static_cast<unsigned>(Technique::COUNT);
+
+//! Family of a technique, techniques of the same family differ only in size.
+enum class TechniqueKind { GROUPS, KILLER_SUMS, INTERSECTIONS, FISH, FINNED_FISH, XCHAINS, XYCHAINS };
+
+struct TechniqueInfo {
+  TechniqueKind kind;
+  //! Size of the group or fish, maximum length of the chain, 0 if not applicable.
+  unsigned size;
+  const char *name;
+};
+
+//! Return the description of a technique.
+const TechniqueInfo &GetTechniqueInfo(Technique technique);
+
+//! Find a technique by its name, return whether it exists.
+bool FindTechnique(std::string_view name, Technique &technique);
+
+#endif // SUDOKU_TECHNIQUE_H
@@ -0,0 +1,74 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "TechniqueScheduler.h"
+#include <algorithm>
+
+namespace {
+
+// Expected time spent per productive run, techniques that were never run
+// come first, so that every technique gets profiled.
+double ExpectedCost(const TechniqueProfile &profile) {
+  if (profile.invocations == 0)
+    return 0;
+  double mean = static_cast<double>(profile.nanoseconds) / static_cast<double>(profile.invocations);
+  double rate = (static_cast<double>(profile.productive) + 1) / (static_cast<double>(profile.invocations) + 2);
+  return mean / rate;
+}
+
+} // namespace
+
+const std::array<Technique, TECHNIQUE_COUNT> &TechniqueScheduler::ReferenceOrder() {
+  static const auto order = [] {
+    std::array<Technique, TECHNIQUE_COUNT> result{};
+    for (unsigned i = 0; i < TECHNIQUE_COUNT; i++) {
+      result[i] = static_cast<Technique>(i);
+    }
+    return result;
+  }();
+  return order;
+}
+
+std::span<const Technique> TechniqueScheduler::Order(unsigned size, SudokuTypes type) {
+  if (mode_ == ScheduleMode::REFERENCE)
+    return ReferenceOrder();
+  return variants_[{size, type}].order;
+}
+
+void TechniqueScheduler::Record(unsigned size, SudokuTypes type, Technique technique, uint64_t nanoseconds,
+                                bool productive) {
+  if (mode_ == ScheduleMode::REFERENCE)
+    return;
+  Variant &variant = variants_[{size, type}];
+  TechniqueProfile &profile = variant.profiles[static_cast<unsigned>(technique)];
+  profile.invocations++;
+  profile.nanoseconds += nanoseconds;
+  if (productive)
+    profile.productive++;
+
+  if (++variant.since_reorder >= REORDER_INTERVAL) {
+    Reorder(variant);
+    variant.since_reorder = 0;
+  }
+}
+
+TechniqueProfile TechniqueScheduler::Profile(unsigned size, SudokuTypes type, Technique technique) const {
+  auto it = variants_.find({size, type});
+  if (it == variants_.end())
+    return {};
+  return it->second.profiles[static_cast<unsigned>(technique)];
+}
+
+void TechniqueScheduler::Reorder(Variant &variant) const {
+  auto skipped = [&variant](Technique technique) {
+    const auto &profile = variant.profiles[static_cast<unsigned>(technique)];
+    return profile.productive == 0 && profile.invocations >= SKIP_INVOCATIONS;
+  };
+  // Singles stay first, ties keep the reference order.
+  variant.order = ReferenceOrder();
+  std::stable_sort(variant.order.begin() + 1, variant.order.end(), [&](Technique lhs, Technique rhs) {
+    if (skipped(lhs) != skipped(rhs))
+      return skipped(rhs);
+    return ExpectedCost(variant.profiles[static_cast<unsigned>(lhs)]) <
+           ExpectedCost(variant.profiles[static_cast<unsigned>(rhs)]);
+  });
+}
@@ -0,0 +1,85 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_TECHNIQUESCHEDULER_H
+#define SUDOKU_TECHNIQUESCHEDULER_H
+
+#include "Sudoku.h"
+#include "Technique.h"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <utility>
+
+enum class ScheduleMode {
+  //! Always use the reference order, the results are reproducible.
+  REFERENCE,
+  //! Order the techniques by their observed cost and productivity, the
+  //! solved puzzles can differ from the reference order and between runs.
+  ADAPTIVE
+};
+
+//! Observed cost and productivity of a technique.
+struct TechniqueProfile {
+  uint64_t invocations = 0;
+  //! Invocations that changed the puzzle.
+  uint64_t productive = 0;
+  uint64_t nanoseconds = 0;
+};
+
+/*! Decides the order in which SmartSolver tries the techniques.
+ *
+ * In the adaptive mode, the scheduler records the cost and productivity of
+ * each technique, separately for each puzzle size and type, and periodically
+ * reorders the techniques by the expected time spent per productive run.
+ * Techniques that haven't changed a puzzle after SKIP_INVOCATIONS runs are
+ * moved behind all the others, so they only run once nothing else helps.
+ *
+ * Each step applies the first technique that changes the puzzle and the
+ * techniques only look at the blocks changed by the previous step, so a
+ * different order can get a puzzle stuck in a different state. The number of
+ * puzzles solved in the adaptive mode therefore varies between runs and can
+ * differ from the reference order in both directions.
+ *
+ * Naked and hidden singles always run first, since every step starts by
+ * propagating the changes of the previous one.
+ *
+ * The scheduler is not thread safe, each thread should use its own.
+ */
+class TechniqueScheduler {
+public:
+  explicit TechniqueScheduler(ScheduleMode mode = ScheduleMode::REFERENCE) : mode_(mode) {}
+
+  ScheduleMode Mode() const { return mode_; }
+
+  //! Return the order in which to try the techniques on a puzzle of the size and type.
+  std::span<const Technique> Order(unsigned size, SudokuTypes type);
+
+  //! Record a single run of a technique, ignored in the reference mode.
+  void Record(unsigned size, SudokuTypes type, Technique technique, uint64_t nanoseconds, bool productive);
+
+  //! Return the recorded profile of a technique.
+  TechniqueProfile Profile(unsigned size, SudokuTypes type, Technique technique) const;
+
+  //! Reference order of the techniques.
+  static const std::array<Technique, TECHNIQUE_COUNT> &ReferenceOrder();
+
+  //! Number of recorded runs between reorders.
+  static constexpr uint64_t REORDER_INTERVAL = 256;
+  //! Number of fruitless runs after which a technique is only used as a last resort.
+  static constexpr uint64_t SKIP_INVOCATIONS = 1024;
+
+private:
+  struct Variant {
+    std::array<TechniqueProfile, TECHNIQUE_COUNT> profiles{};
+    std::array<Technique, TECHNIQUE_COUNT> order = ReferenceOrder();
+    uint64_t since_reorder = 0;
+  };
+
+  void Reorder(Variant &variant) const;
+
+  ScheduleMode mode_;
+  std::map<std::pair<unsigned, SudokuTypes>, Variant> variants_;
+};
+
+#endif // SUDOKU_TECHNIQUESCHEDULER_H
@@ -1,6 +1,17 @@
+#include "BacktrackingSolver.h"
+#include "Generator.h"
+#include "Sudoku.h"
+#include "SmartSolver.h"
+#include "SolveStats.h"
+#include "core/GridParser.h"
+#include "core/NakedSingles.h"
+#include "core/SudokuAlgorithms.h"
+#include "../test/TestPuzzles.h"
 #include <benchmark/benchmark.h>
 #include <functional>
+#include <numeric>
 #include <random>
+#include <sstream>
 
 template <typename T>
 void generic_recursive_find(
@@ -238,4 +249,318 @@ BENCHMARK_REGISTER_F(RandomData, TrackChangeIncremental)
     ->RangeMultiplier(2)
     ->Range(8, 8 << 5);
 
+// compare the cost of cloning a puzzle (e.g. before guessing a value)
+
+static void BM_CloneRebuild(benchmark::State &state) {
+  // A fresh puzzle with all the squares copied over, which was the only way
+  // to clone a puzzle when the blocks were pointing into the square storage.
+  unsigned size = static_cast<unsigned>(state.range());
+  sudoku::Sudoku source(size);
+  for (auto _ : state) {
+    sudoku::Sudoku clone(size);
+    for (unsigned i = 0; i < size; i++) {
+      for (unsigned j = 0; j < size; j++) {
+        clone[i][j] = source[i][j];
+      }
+    }
+    benchmark::DoNotOptimize(clone.Data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_CloneSerialize(benchmark::State &state) {
+  unsigned size = static_cast<unsigned>(state.range());
+  sudoku::Sudoku source(size);
+  for (auto _ : state) {
+    sudoku::Sudoku clone(size);
+    clone.Deserialize(source.Serialize());
+    benchmark::DoNotOptimize(clone.Data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_CloneCopy(benchmark::State &state) {
+  unsigned size = static_cast<unsigned>(state.range());
+  sudoku::Sudoku source(size);
+  for (auto _ : state) {
+    sudoku::Sudoku clone(source);
+    benchmark::DoNotOptimize(clone.Data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_CloneCopyKiller(benchmark::State &state) {
+  // Every row paired up into two square killer blocks. The copy shares the
+  // killer blocks with the source instead of duplicating them.
+  unsigned size = static_cast<unsigned>(state.range());
+  sudoku::Sudoku source(size);
+  for (unsigned row = 0; row < size; row++) {
+    for (unsigned col = 0; col + 1 < size; col += 2) {
+      source.AddKillerBlock({row * size + col, row * size + col + 1}, size + 1);
+    }
+  }
+  source.PreBuildKillerMapping();
+  for (auto _ : state) {
+    sudoku::Sudoku clone(source);
+    benchmark::DoNotOptimize(clone.Data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_CloneSerializeBinary(benchmark::State &state) {
+  unsigned size = static_cast<unsigned>(state.range());
+  sudoku::Sudoku source(size);
+  std::string data;
+  for (auto _ : state) {
+    sudoku::Sudoku clone(size);
+    data.clear();
+    source.SerializeBinary(data);
+    clone.DeserializeBinary(data);
+    benchmark::DoNotOptimize(clone.Data());
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(BM_CloneRebuild)->Arg(9)->Arg(16);
+BENCHMARK(BM_CloneSerialize)->Arg(9)->Arg(16);
+BENCHMARK(BM_CloneSerializeBinary)->Arg(9)->Arg(16);
+BENCHMARK(BM_CloneCopy)->Arg(9)->Arg(16);
+BENCHMARK(BM_CloneCopyKiller)->Arg(9)->Arg(16);
+
+// naked single propagation over a whole puzzle
+
+static void BM_NakedSinglesBlocks(benchmark::State &state) {
+  sudoku::Sudoku source(9);
+  sudoku::ReadPuzzle(SINGLES_PUZZLE, source);
+  for (auto _ : state) {
+    sudoku::Sudoku puzzle(source);
+    for (auto &block : puzzle.Blocks()) {
+      sudoku::SolveNakedGroups(puzzle.Squares(block), 1);
+    }
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+}
+
+static void BM_NakedSinglesKernel(benchmark::State &state, sudoku::SinglesKernel kernel) {
+  sudoku::Sudoku source(9);
+  sudoku::ReadPuzzle(SINGLES_PUZZLE, source);
+  sudoku::PackedGrid packed;
+  for (unsigned i = 0; i < 9; i++) {
+    for (unsigned j = 0; j < 9; j++) {
+      packed.squares[i * sudoku::PackedGrid::STRIDE + j] =
+          sudoku::SmallBitSet::FromValue(static_cast<uint16_t>(source.Data()[i * 9 + j].Value()));
+    }
+  }
+  for (auto _ : state) {
+    sudoku::PackedGrid grid = packed;
+    sudoku::PropagateNakedSingles(grid, 9, 3, false, kernel);
+    benchmark::DoNotOptimize(grid.squares.data());
+  }
+}
+
+BENCHMARK(BM_NakedSinglesBlocks);
+BENCHMARK_CAPTURE(BM_NakedSinglesKernel, scalar, sudoku::SinglesKernel::SCALAR);
+BENCHMARK_CAPTURE(BM_NakedSinglesKernel, avx2, sudoku::SinglesKernel::AVX2);
+
+// reading a corpus record, by the bulk parser and through the stream
+
+static void BM_ParseGrid(benchmark::State &state, sudoku::GridKernel kernel) {
+  std::vector<sudoku::BitSet> squares(81);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sudoku::ParseGrid(SINGLES_PUZZLE, 9, squares.data(), kernel));
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_ReadPuzzle(benchmark::State &state) {
+  sudoku::Sudoku puzzle(9);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sudoku::ReadPuzzle(SINGLES_PUZZLE, puzzle));
+  }
+}
+
+static void BM_StreamPuzzle(benchmark::State &state) {
+  sudoku::Sudoku puzzle(9);
+  std::stringstream stream;
+  for (auto _ : state) {
+    stream.clear();
+    stream.str(SINGLES_PUZZLE);
+    stream >> puzzle;
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+}
+
+static void BM_MatchesGrid(benchmark::State &state, sudoku::GridKernel kernel) {
+  sudoku::Sudoku puzzle(9);
+  sudoku::ReadPuzzle(SINGLES_PUZZLE, puzzle);
+  SolveStats stats;
+  SmartSolver::Solve(puzzle, stats);
+  std::string solution;
+  for (unsigned i = 0; i < 81; i++) {
+    solution += static_cast<char>('0' + puzzle.Data()[i].SingletonValue());
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sudoku::MatchesGrid(solution, 9, puzzle.Data(), kernel));
+  }
+}
+
+BENCHMARK_CAPTURE(BM_ParseGrid, scalar, sudoku::GridKernel::SCALAR);
+BENCHMARK_CAPTURE(BM_ParseGrid, avx2, sudoku::GridKernel::AVX2);
+BENCHMARK(BM_ReadPuzzle);
+BENCHMARK(BM_StreamPuzzle);
+BENCHMARK_CAPTURE(BM_MatchesGrid, scalar, sudoku::GridKernel::SCALAR);
+BENCHMARK_CAPTURE(BM_MatchesGrid, avx2, sudoku::GridKernel::AVX2);
+
+// naked and hidden group search of a given size over all the blocks
+
+static void BM_GroupSearch(benchmark::State &state) {
+  sudoku::Sudoku source(9);
+  sudoku::ReadPuzzle(SINGLES_PUZZLE, source);
+  source.SolveNakedSingles();
+  unsigned size = static_cast<unsigned>(state.range());
+  for (auto _ : state) {
+    sudoku::Sudoku puzzle(source);
+    for (auto &block : puzzle.Blocks()) {
+      sudoku::SolveHiddenGroups(puzzle.Squares(block), puzzle.Positions(block), size);
+      sudoku::SolveNakedGroups(puzzle.Squares(block), size);
+    }
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+}
+
+BENCHMARK(BM_GroupSearch)->Arg(2)->Arg(3)->Arg(4);
+
+// locked candidates, all pairs of blocks vs the precomputed intersections
+
+static void BM_BlockIntersectionPairs(benchmark::State &state) {
+  sudoku::Sudoku source(9);
+  sudoku::ReadPuzzle(SINGLES_PUZZLE, source);
+  source.SolveNakedSingles();
+  for (auto _ : state) {
+    sudoku::Sudoku puzzle(source);
+    for (auto &block : puzzle.Blocks()) {
+      for (auto &rblock : puzzle.Blocks()) {
+        sudoku::SolveBlockIntersection(puzzle.Grid(), block, rblock);
+      }
+    }
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+}
+
+static void BM_BlockIntersections(benchmark::State &state) {
+  sudoku::Sudoku source(9);
+  sudoku::ReadPuzzle(SINGLES_PUZZLE, source);
+  source.SolveNakedSingles();
+  for (auto _ : state) {
+    sudoku::Sudoku puzzle(source);
+    puzzle.SolveBlockIntersections();
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+}
+
+BENCHMARK(BM_BlockIntersectionPairs);
+BENCHMARK(BM_BlockIntersections);
+
+// chain techniques on a puzzle that the solver gets stuck on, X chains of all
+// the lengths up to the argument, XY chains for 0
+
+static void BM_Chains(benchmark::State &state) {
+  sudoku::Sudoku stuck(9);
+  sudoku::ReadPuzzle(STUCK_PUZZLE, stuck);
+  SolveStats stats;
+  SmartSolver::Solve(stuck, stats);
+  unsigned length = static_cast<unsigned>(state.range());
+  for (auto _ : state) {
+    sudoku::Sudoku puzzle(stuck);
+    for (unsigned number = 1; number <= puzzle.Size(); number++) {
+      if (length == 0) {
+        puzzle.SolveXYChains();
+        break;
+      }
+      puzzle.SolveXChains(length, number);
+    }
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+}
+
+BENCHMARK(BM_Chains)->Arg(0)->Arg(4)->Arg(6)->Arg(8)->Arg(10);
+
+// backtracking search, including the proof that the solution is unique
+
+static void BM_Backtracking(benchmark::State &state, const char *puzzle) {
+  sudoku::Sudoku source(9);
+  sudoku::ReadPuzzle(puzzle, source);
+  BacktrackingSolver solver;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(solver.CountSolutions(source, 2));
+  }
+}
+
+BENCHMARK_CAPTURE(BM_Backtracking, singles, SINGLES_PUZZLE);
+BENCHMARK_CAPTURE(BM_Backtracking, hard, HARD_PUZZLE);
+
+// pruning the sets of a killer cage by the squares of a partially solved
+// puzzle, as on every step of a killer solve
+
+static void BM_KillerPrune(benchmark::State &state) {
+  unsigned max = static_cast<unsigned>(state.range(0));
+  unsigned squares = static_cast<unsigned>(state.range(1));
+  std::vector<unsigned> cells(squares);
+  std::iota(cells.begin(), cells.end(), 0u);
+  const sudoku::KillerBlock source(cells, max, squares * (max + 1) / 2);
+  std::mt19937 rng(1);
+  std::vector<sudoku::BitSet> grid(squares);
+  for (auto &square : grid) {
+    square = sudoku::BitSet::SudokuSquare(max);
+    for (unsigned number = 1; number <= max; number++) {
+      if (rng() % 4 == 0)
+        square -= number;
+    }
+  }
+  for (auto _ : state) {
+    sudoku::KillerBlock cage(source);
+    cage.PruneSumSets(grid.data());
+    cage.PruneSumSetsBySquare(grid.data());
+    benchmark::DoNotOptimize(cage.UnionSumSet());
+  }
+}
+
+BENCHMARK(BM_KillerPrune)->Args({9, 3})->Args({9, 5})->Args({16, 4})->Args({16, 8})->Args({25, 6});
+
+// solving the puzzles of the large grids, 70% of the squares of random
+// solutions given, how the time per puzzle grows with the size
+
+static void BM_LargeGrid(benchmark::State &state) {
+  unsigned size = static_cast<unsigned>(state.range());
+  Generator generator(1, size);
+  std::mt19937_64 rng(size);
+  std::bernoulli_distribution given(0.7);
+  std::vector<sudoku::Sudoku> corpus;
+  for (unsigned i = 0; i < 8; i++) {
+    sudoku::Sudoku puzzle = generator.PatternSolution(rng);
+    auto grid = puzzle.Grid();
+    for (unsigned cell = 0; cell < size * size; cell++) {
+      if (!given(rng))
+        grid[cell] = sudoku::BitSet::SudokuSquare(size);
+    }
+    corpus.push_back(std::move(puzzle));
+  }
+
+  BacktrackingSolver backtracking(size);
+  size_t next = 0;
+  uint64_t smart = 0;
+  for (auto _ : state) {
+    sudoku::Sudoku puzzle(corpus[next++ % corpus.size()]);
+    SolveStats stats;
+    if (SmartSolver::Solve(puzzle, stats))
+      smart++;
+    else
+      backtracking.Solve(puzzle);
+    benchmark::DoNotOptimize(puzzle.Data());
+  }
+  state.counters["smart"] = benchmark::Counter(static_cast<double>(smart) / static_cast<double>(state.iterations()));
+}
+
+BENCHMARK(BM_LargeGrid)->Arg(9)->Arg(16)->Arg(25)->Arg(36)->Arg(49)->Arg(64)->Unit(benchmark::kMillisecond);
+
 BENCHMARK_MAIN();
@@ -2,24 +2,28 @@
 
 #include "BitSet.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
 namespace sudoku {
 
-void BitSet::Serialize(std::ostream &s) const {
+template <typename Word>
+void BasicBitSet<Word>::Serialize(std::ostream &s) const {
   s << data_;
 }
 
-void BitSet::Deserialize(std::istream &s, unsigned max) {
+template <typename Word>
+void BasicBitSet<Word>::Deserialize(std::istream &s, [[maybe_unused]] unsigned max) {
+  assert(max <= BITS);
   s >> data_;
-  max_ = max;
 }
 
-std::string BitSet::DebugString() const {
+template <typename Word>
+std::string BasicBitSet<Word>::DebugString(unsigned max_value) const {
   std::stringstream s;
   s << "[";
-  for (unsigned i = 0; i < max_; i++) {
+  for (unsigned i = 0; i < max_value; i++) {
     if (IsBitSet(i + 1)) {
       if (i + 1 > 9) {
         s << static_cast<char>(i - 9 + 'A');
@@ -34,9 +38,18 @@ std::string BitSet::DebugString() const {
   return s.str();
 }
 
-std::ostream& operator << (std::ostream& s, const BitSet& b) {
-  s << b.DebugString();
+template <typename Word>
+std::ostream& operator << (std::ostream& s, const BasicBitSet<Word>& b) {
+  s << b.DebugString(std::max(9u, b.Highest()));
   return s;
 }
 
-}
\ No newline at end of file
+template class BasicBitSet<uint16_t>;
+template class BasicBitSet<uint32_t>;
+template class BasicBitSet<uint64_t>;
+
+template std::ostream& operator << (std::ostream& s, const BasicBitSet<uint16_t>& b);
+template std::ostream& operator << (std::ostream& s, const BasicBitSet<uint32_t>& b);
+template std::ostream& operator << (std::ostream& s, const BasicBitSet<uint64_t>& b);
+
+}
@@ -9,50 +9,58 @@
 #include <iosfwd>
 #include <cassert>
 #include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 namespace sudoku {
 
-class BitSet {
+/*! Set of numbers in the range [1, BITS], i.e. the possibilities of a square.
+ *
+ * The range of the set isn't stored, so the size of the set is the size of
+ * the storage word. Use SmallBitSet for puzzles up to 16x16 and BitSet for
+ * puzzles up to 64x64.
+ */
+template <typename Word>
+class BasicBitSet {
+  static_assert(std::is_unsigned_v<Word>, "BasicBitSet requires an unsigned storage type");
+
  public:
+  //! Maximum number that can be stored in the set.
+  static constexpr unsigned BITS = sizeof(Word) * 8;
+
   // All default constructors.
-  constexpr BitSet() noexcept = default;
-  constexpr BitSet(const BitSet &) noexcept = default;
-  constexpr BitSet(BitSet &&) noexcept = default;
-  constexpr BitSet &operator=(const BitSet &) noexcept = default;
-  constexpr BitSet &operator=(BitSet &&) noexcept = default;
-
-  [[nodiscard]] constexpr auto operator<=>(const BitSet &rhs) const noexcept = default;
-
-  [[nodiscard]] static constexpr BitSet SudokuSquare(unsigned max_value = 9) noexcept {
-    assert(max_value <= 64);
-    BitSet result;
-    result.data_ = ~((~UINT64_C(0)) << static_cast<uint64_t>(max_value));
-    result.max_ = static_cast<uint8_t>(max_value);
-    return result;
+  constexpr BasicBitSet() noexcept = default;
+  constexpr BasicBitSet(const BasicBitSet &) noexcept = default;
+  constexpr BasicBitSet(BasicBitSet &&) noexcept = default;
+  constexpr BasicBitSet &operator=(const BasicBitSet &) noexcept = default;
+  constexpr BasicBitSet &operator=(BasicBitSet &&) noexcept = default;
+
+  [[nodiscard]] constexpr auto operator<=>(const BasicBitSet &rhs) const noexcept = default;
+
+  [[nodiscard]] static constexpr BasicBitSet SudokuSquare(unsigned max_value = 9) noexcept {
+    return Set(max_value, max_value);
   }
 
-  [[nodiscard]] static constexpr BitSet Set(unsigned max_value = 9, unsigned bits_set = 9) noexcept {
-    assert(max_value <= 64);
-    BitSet result;
-    result.data_ = ~((~UINT64_C(0)) << static_cast<uint64_t>(bits_set));
-    result.max_ = static_cast<uint8_t>(max_value);
-    return result;
+  [[nodiscard]] static constexpr BasicBitSet Set([[maybe_unused]] unsigned max_value = 9, unsigned bits_set = 9) noexcept {
+    assert(max_value <= BITS && bits_set <= max_value);
+    if (bits_set == BITS)
+      return BasicBitSet(static_cast<Word>(~Word(0)));
+    return BasicBitSet(static_cast<Word>((Word(1) << bits_set) - 1u));
   }
 
-  [[nodiscard]] static constexpr BitSet Empty(unsigned max_value = 9) noexcept {
-    assert(max_value <= 64);
-    BitSet result;
-    result.data_ = UINT64_C(0);
-    result.max_ = static_cast<uint8_t>(max_value);
-    return result;
+  [[nodiscard]] static constexpr BasicBitSet Empty([[maybe_unused]] unsigned max_value = 9) noexcept {
+    assert(max_value <= BITS);
+    return BasicBitSet();
   }
 
   /*! Construct a single-bit BitSet.
 	 * @param number The ordinal number of the bit to be set.
 	 * @return BitSet with a single bit set.
 	 */
-  [[nodiscard]] static constexpr BitSet SingleBit(unsigned max_value, unsigned number) noexcept {
-    return BitSet(SingleBitValue(number), static_cast<uint8_t>(max_value));
+  [[nodiscard]] static constexpr BasicBitSet SingleBit([[maybe_unused]] unsigned max_value, unsigned number) noexcept {
+    assert(max_value <= BITS && number <= max_value);
+    return BasicBitSet(SingleBitValue(number));
   }
 
   /*! Set minus operation
@@ -60,8 +68,8 @@ class BitSet {
 	 * @param rhs Right hand side of the operator.
 	 * @return Result of the set minus operation.
 	 */
-  [[nodiscard]] friend constexpr BitSet operator-(const BitSet &lhs, const BitSet &rhs) noexcept {
-    return BitSet(lhs.data_ & ~rhs.data_, lhs.max_);
+  [[nodiscard]] friend constexpr BasicBitSet operator-(const BasicBitSet &lhs, const BasicBitSet &rhs) noexcept {
+    return BasicBitSet(static_cast<Word>(lhs.data_ & ~rhs.data_));
   }
 
   /*! Set union operation
@@ -69,8 +77,8 @@ class BitSet {
 	 * @param rhs Right hand side of the operator.
 	 * @return Result of the set union operation.
 	 */
-  [[nodiscard]] friend constexpr BitSet operator|(const BitSet &lhs, const BitSet &rhs) noexcept {
-    return BitSet(lhs.data_ | rhs.data_, lhs.max_);
+  [[nodiscard]] friend constexpr BasicBitSet operator|(const BasicBitSet &lhs, const BasicBitSet &rhs) noexcept {
+    return BasicBitSet(static_cast<Word>(lhs.data_ | rhs.data_));
   }
 
   /*! Set intersection operation
@@ -78,16 +86,16 @@ class BitSet {
 	 * @param rhs Right hand side of the operator.
 	 * @return Result of the set intersection operation.
 	 */
-  [[nodiscard]] friend constexpr BitSet operator&(const BitSet &lhs, const BitSet &rhs) noexcept {
-    return BitSet(lhs.data_ & rhs.data_, lhs.max_);
+  [[nodiscard]] friend constexpr BasicBitSet operator&(const BasicBitSet &lhs, const BasicBitSet &rhs) noexcept {
+    return BasicBitSet(static_cast<Word>(lhs.data_ & rhs.data_));
   }
 
   /*! Set minus operation
 	 * @param rhs Right hand side of the operator.
 	 * @return Result of the set minus operation.
 	 */
-  constexpr BitSet &operator-=(const BitSet &rhs) noexcept {
-    data_ &= ~rhs.data_;
+  constexpr BasicBitSet &operator-=(const BasicBitSet &rhs) noexcept {
+    data_ = static_cast<Word>(data_ & ~rhs.data_);
     return *this;
   }
 
@@ -95,8 +103,8 @@ class BitSet {
 	 * @param rhs Right hand side of the operator.
 	 * @return Result of the set union operation.
 	 */
-  constexpr BitSet &operator|=(const BitSet &rhs) noexcept {
-    data_ |= rhs.data_;
+  constexpr BasicBitSet &operator|=(const BasicBitSet &rhs) noexcept {
+    data_ = static_cast<Word>(data_ | rhs.data_);
     return *this;
   }
 
@@ -104,8 +112,8 @@ class BitSet {
    * @param rhs Right hand side of the operator.
 	 * @return Result of the set intersection operation.
 	 */
-  constexpr BitSet &operator&=(const BitSet &rhs) noexcept {
-    data_ &= rhs.data_;
+  constexpr BasicBitSet &operator&=(const BasicBitSet &rhs) noexcept {
+    data_ = static_cast<Word>(data_ & rhs.data_);
     return *this;
   }
 
@@ -114,8 +122,8 @@ class BitSet {
    * @param number Number to add, indexed from 1.
    * @return this
    */
-  constexpr BitSet &operator+=(unsigned number) noexcept {
-    data_ |= SingleBitValue(number);
+  constexpr BasicBitSet &operator+=(unsigned number) noexcept {
+    data_ = static_cast<Word>(data_ | SingleBitValue(number));
     return *this;
   }
 
@@ -124,9 +132,9 @@ class BitSet {
    * @param number Number to add, indexed from 1.
    * @return A new Square with the possiblity added.
    */
-  [[nodiscard]] constexpr BitSet operator+(unsigned number) const noexcept {
-    BitSet result(*this);
-    result.data_ |= SingleBitValue(number);
+  [[nodiscard]] constexpr BasicBitSet operator+(unsigned number) const noexcept {
+    BasicBitSet result(*this);
+    result += number;
     return result;
   }
 
@@ -135,8 +143,8 @@ class BitSet {
    * @param number Number to remove.
    * @return this
    */
-  constexpr BitSet &operator-=(unsigned number) noexcept {
-    data_ &= ~SingleBitValue(number);
+  constexpr BasicBitSet &operator-=(unsigned number) noexcept {
+    data_ = static_cast<Word>(data_ & ~SingleBitValue(number));
     return *this;
   }
 
@@ -145,9 +153,9 @@ class BitSet {
    * @param number Number to remove.
    * @return A new Square with the number removed.
    */
-  [[nodiscard]] constexpr BitSet operator-(unsigned number) const noexcept {
-    BitSet result(*this);
-    result.data_ &= ~SingleBitValue(number);
+  [[nodiscard]] constexpr BasicBitSet operator-(unsigned number) const noexcept {
+    BasicBitSet result(*this);
+    result -= number;
     return result;
   }
 
@@ -156,7 +164,7 @@ class BitSet {
    * @param rhs The bitset to check intersection with.
    * @return True if the bitsets intersect on at least one bit. False otherwise.
    */
-  [[nodiscard]] constexpr bool HasIntersection(const BitSet &rhs) const noexcept {
+  [[nodiscard]] constexpr bool HasIntersection(const BasicBitSet &rhs) const noexcept {
     return (data_ & rhs.data_) != 0;
   }
 
@@ -164,7 +172,7 @@ class BitSet {
 	 * @param rhs The bitset to check against.
 	 * @return True if this bitset contains bits not contained within the given bitset, false otherwise.
 	 */
-  [[nodiscard]] constexpr bool HasAdditionalBits(const BitSet &rhs) const noexcept {
+  [[nodiscard]] constexpr bool HasAdditionalBits(const BasicBitSet &rhs) const noexcept {
     return (data_ & rhs.data_) != data_;
   }
 
@@ -197,21 +205,28 @@ class BitSet {
     return (data_ & SingleBitValue(bit)) != 0;
   }
 
+  /*! Return the highest number in the set.
+   * @return Highest number in the set, 0 for an empty set.
+   */
+  [[nodiscard]] constexpr unsigned Highest() const noexcept {
+    return static_cast<unsigned>(std::bit_width(data_));
+  }
+
+  //! Return the raw storage word, bit 0 represents number 1.
+  [[nodiscard]] constexpr Word Value() const noexcept { return data_; }
+
+  //! Construct the set from a raw storage word, see Value().
+  [[nodiscard]] static constexpr BasicBitSet FromValue(Word value) noexcept {
+    return BasicBitSet(value);
+  }
+
   /*! Generate a debug a string representing the possibilities in the bitset.
    *
+   * @param max_value Number of possibilities to print.
    * @return Debug string in the following format [1..456..9] where 1,4,5,6,9
    * are possibilities.
    */
-  std::string DebugString() const;
-
-  /*! Return the ordinal value of the maximum bit that can be set.
-   * @return Ordinal value of the maximum bit that can be set.
-   */
-  [[nodiscard]] constexpr unsigned Max() const noexcept { 
-	  return max_; 
-	}
-
-  friend std::ostream& operator << (std::ostream& s, const BitSet& b);
+  std::string DebugString(unsigned max_value) const;
 
 protected:
   /*! Serialize the value of this bitset into a stream.
@@ -227,42 +242,61 @@ protected:
   /*! Explicit from value constructor.
 	 * @param value The value to set this bitset to.
 	 */
-  explicit constexpr BitSet(uint64_t value) noexcept : data_(value) {}
+  explicit constexpr BasicBitSet(Word value) noexcept : data_(value) {}
 
   /*! Generate a value with a single bit set.
 	 * @param number The ordinal of the bit to be set.
 	 * @return Value with a single bit set.
 	 */
-  [[nodiscard]] static constexpr uint64_t SingleBitValue(unsigned number) noexcept {
-    return UINT64_C(1) << (static_cast<uint64_t>(number) - UINT64_C(1));
+  [[nodiscard]] static constexpr Word SingleBitValue(unsigned number) noexcept {
+    return static_cast<Word>(Word(1) << (number - 1u));
   }
 
  private:
-  uint64_t data_ = 0;
-  uint8_t max_ = 0;
-
-  constexpr BitSet(uint64_t data, uint8_t max) noexcept : data_(data), max_(max) {}
+  Word data_ = 0;
 
-  friend constexpr BitSet NextSet(const BitSet& set) noexcept;
+  template <typename W>
+  friend constexpr BasicBitSet<W> NextSet(const BasicBitSet<W>& set, unsigned max_value) noexcept;
   friend class Sudoku;
 };
 
-inline constexpr BitSet NextSet(const BitSet& set) noexcept {
+//! Print the set using DebugString(), with at least 9 possibilities.
+template <typename Word>
+std::ostream& operator << (std::ostream& s, const BasicBitSet<Word>& b);
+
+//! Possibilities of a square in puzzles up to 64x64.
+using BitSet = BasicBitSet<uint64_t>;
+//! Possibilities of a square in puzzles up to 16x16, packed into 16 bits.
+using SmallBitSet = BasicBitSet<uint16_t>;
+
+static_assert(sizeof(BitSet) == sizeof(uint64_t));
+static_assert(sizeof(SmallBitSet) == sizeof(uint16_t));
+
+/*! Return the next set with the same number of bits in the range [1, max_value].
+ *
+ * Sets are enumerated in increasing order, an empty set is returned after
+ * the last one.
+ */
+template <typename Word>
+inline constexpr BasicBitSet<Word> NextSet(const BasicBitSet<Word>& set, unsigned max_value) noexcept {
     // Get the rightmost 1 bit and add it to the number.
     // This will give us the next one bit that needs to be set.
-	uint64_t shifted = set.data_ + (1 << std::countr_zero(set.data_));
-	if (shifted < set.data_ || std::bit_floor(shifted) > (UINT64_C(1) << (static_cast<uint64_t>(set.max_-1))))
-		return BitSet::Empty(set.max_);
+	Word lowest = static_cast<Word>(Word(1) << std::countr_zero(set.data_));
+	Word shifted = static_cast<Word>(set.data_ + lowest);
+	if (shifted < set.data_ || static_cast<unsigned>(std::bit_width(shifted)) > max_value)
+		return BasicBitSet<Word>();
 	// XOR to get the changed bits (all the consecutive ones, that flipped to 0s and the new left 1).
-	uint64_t isolated = set.data_^shifted;
+	Word isolated = static_cast<Word>(set.data_^shifted);
 	// shift the pattern to the right, discarding the two leftmost bits
 	// we discard two bits because, isolated has all the changed bits (which already is one extra)
 	// and shifted already has the new left bit added, which is the second bit
-	isolated /= (UINT64_C(1) << std::countr_zero(set.data_));
-	isolated >>= 2;
-	return BitSet(shifted | isolated, set.max_);
+	isolated = static_cast<Word>(isolated / lowest);
+	isolated = static_cast<Word>(isolated >> 2);
+	return BasicBitSet<Word>(static_cast<Word>(shifted | isolated));
 }
 
+//! Iterates over the numbers in a set, in increasing order.
+template <typename Set>
 struct BitIterator {
     using iterator_category = std::input_iterator_tag;
     using value_type = unsigned;
@@ -270,46 +304,43 @@ struct BitIterator {
     using pointer = unsigned*;
     using reference = unsigned&;
 
-    constexpr BitIterator(const sudoku::BitSet* set) : set_(set), current_(0u) { NextBit(); }
-    constexpr BitIterator(const sudoku::BitSet* set, unsigned val) : set_(set), current_(val) {}
+    constexpr explicit BitIterator(const Set* set) : remaining_(set->Value()) {}
+    constexpr BitIterator() : remaining_(0) {}
     constexpr BitIterator(const BitIterator& rhs) = default;
     [[nodiscard]] constexpr BitIterator& operator=(const BitIterator& rhs) noexcept = default;
 
     [[nodiscard]] constexpr bool operator != (const BitIterator& rhs) const noexcept {
-        return current_ != rhs.current_;
+        return remaining_ != rhs.remaining_;
     }
 
     friend constexpr BitIterator& operator++(BitIterator& it) noexcept {
-        it.NextBit();
+        it.remaining_ &= static_cast<decltype(it.remaining_)>(it.remaining_ - 1u);
         return it;
     }
     friend constexpr BitIterator operator++(BitIterator& it, int) noexcept {
         BitIterator result(it);
-        it.NextBit();
+        ++it;
         return result;
     }
 
-    [[nodiscard]] constexpr value_type operator*() const noexcept { return current_; }
-
-  private:
-    constexpr void NextBit() noexcept {
-      current_++;
-      while (current_ <= set_->Max() && !set_->IsBitSet(current_))
-        current_++;
+    [[nodiscard]] constexpr value_type operator*() const noexcept {
+        return static_cast<unsigned>(std::countr_zero(remaining_)) + 1u;
     }
 
-    const sudoku::BitSet* set_;
-    unsigned current_;
+  private:
+    decltype(std::declval<Set>().Value()) remaining_;
 };
 
+//! Iterates over all the sets of the given size in the range [1, range].
+template <typename Set>
 struct SetIterator {
     using iterator_category = std::input_iterator_tag;
-    using value_type = sudoku::BitSet;
+    using value_type = Set;
     using difference_type = void;
-    using pointer = sudoku::BitSet*;
-    using reference = sudoku::BitSet&;
+    using pointer = Set*;
+    using reference = Set&;
 
-    constexpr SetIterator(const sudoku::BitSet set) noexcept : current_(set) {}
+    constexpr SetIterator(const Set set, unsigned range) noexcept : current_(set), range_(range) {}
     constexpr SetIterator(const SetIterator&) noexcept = default;
     [[nodiscard]] constexpr SetIterator& operator=(const SetIterator&) noexcept = default;
 
@@ -318,34 +349,37 @@ struct SetIterator {
     }
 
     friend constexpr SetIterator& operator++(SetIterator& it) noexcept {
-        it.current_ = sudoku::NextSet(it.current_);
+        it.current_ = sudoku::NextSet(it.current_, it.range_);
         return it;
     }
     friend constexpr SetIterator operator++(SetIterator& it, int) noexcept {
         SetIterator result(it);
-        it.current_ = sudoku::NextSet(it.current_);
+        ++it;
         return result;
     }
 
     constexpr value_type operator*() const { return current_; }
-    constexpr const sudoku::BitSet* operator->() const { return &current_; }
+    constexpr const Set* operator->() const { return &current_; }
 
   private:
-    sudoku::BitSet current_;    
+    Set current_;
+    unsigned range_;
 };
 
+template <typename Set>
 struct BitSetBits {
-    constexpr BitSetBits(const sudoku::BitSet* set) noexcept : set_(set) {}
-    [[nodiscard]] constexpr auto begin() const noexcept { return BitIterator(set_); };
-    [[nodiscard]] constexpr auto end() const noexcept { return BitIterator(set_, set_->Max()+1); };
+    constexpr BitSetBits(const Set* set) noexcept : set_(set) {}
+    [[nodiscard]] constexpr auto begin() const noexcept { return BitIterator<Set>(set_); };
+    [[nodiscard]] constexpr auto end() const noexcept { return BitIterator<Set>(); };
   private:
-    const sudoku::BitSet* set_;
+    const Set* set_;
 };
 
+template <typename SetType = BitSet>
 struct BitSetSets {
     constexpr BitSetSets(unsigned range = 9u, unsigned size = 9u) noexcept : range_(range), size_(size) {}
-    [[nodiscard]] constexpr auto begin() const noexcept { return SetIterator(sudoku::BitSet::Set(range_, size_)); };
-    [[nodiscard]] constexpr auto end() const noexcept { return SetIterator(sudoku::BitSet::Empty(range_)); };
+    [[nodiscard]] constexpr auto begin() const noexcept { return SetIterator<SetType>(SetType::Set(range_, size_), range_); };
+    [[nodiscard]] constexpr auto end() const noexcept { return SetIterator<SetType>(SetType::Empty(range_), range_); };
   private:
     unsigned range_;
     unsigned size_;
@@ -0,0 +1,151 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_BITMASK_H_
+#define CORE_BITMASK_H_
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace sudoku {
+
+/*! Fixed-size set of indexes in the range [0, Bits).
+ *
+ * Unlike BitSet, which represents the possibilities of a single square, this
+ * is used for sets of squares or blocks. Iteration yields the indexes of the
+ * set bits in increasing order.
+ */
+template <size_t Bits>
+class FixedBitmask {
+public:
+  static constexpr size_t WORDS = (Bits + 63) / 64;
+
+  struct Iterator {
+    using iterator_category = std::input_iterator_tag;
+    using value_type = unsigned;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const unsigned *;
+    using reference = unsigned;
+
+    [[nodiscard]] constexpr unsigned operator*() const noexcept {
+      return static_cast<unsigned>(word_ * 64 + static_cast<size_t>(std::countr_zero(bits_)));
+    }
+    constexpr Iterator &operator++() noexcept {
+      bits_ &= bits_ - 1;
+      Skip();
+      return *this;
+    }
+    constexpr Iterator operator++(int) noexcept {
+      Iterator result(*this);
+      ++(*this);
+      return result;
+    }
+    [[nodiscard]] constexpr bool operator==(const Iterator &rhs) const noexcept {
+      return word_ == rhs.word_ && bits_ == rhs.bits_;
+    }
+
+    constexpr void Skip() noexcept {
+      while (bits_ == 0 && ++word_ < WORDS)
+        bits_ = mask_->words_[word_];
+    }
+
+    const FixedBitmask *mask_;
+    size_t word_;
+    uint64_t bits_;
+  };
+
+  constexpr FixedBitmask() noexcept = default;
+
+  [[nodiscard]] constexpr bool operator==(const FixedBitmask &) const noexcept = default;
+
+  //! Add the index to the set.
+  constexpr void Set(unsigned index) noexcept {
+    assert(index < Bits);
+    words_[index / 64] |= UINT64_C(1) << (index % 64);
+  }
+  //! Remove the index from the set.
+  constexpr void Reset(unsigned index) noexcept {
+    assert(index < Bits);
+    words_[index / 64] &= ~(UINT64_C(1) << (index % 64));
+  }
+  //! Return whether the index is in the set.
+  [[nodiscard]] constexpr bool IsSet(unsigned index) const noexcept {
+    assert(index < Bits);
+    return (words_[index / 64] >> (index % 64)) & 1u;
+  }
+  //! Remove all indexes from the set.
+  constexpr void Clear() noexcept { words_ = {}; }
+
+  //! Return whether the set is non-empty.
+  [[nodiscard]] constexpr bool Any() const noexcept {
+    for (auto w : words_) {
+      if (w != 0)
+        return true;
+    }
+    return false;
+  }
+  //! Return the number of indexes in the set.
+  [[nodiscard]] constexpr unsigned Count() const noexcept {
+    unsigned result = 0;
+    for (auto w : words_) {
+      result += static_cast<unsigned>(std::popcount(w));
+    }
+    return result;
+  }
+
+  constexpr FixedBitmask &operator|=(const FixedBitmask &rhs) noexcept {
+    for (size_t i = 0; i < WORDS; i++) {
+      words_[i] |= rhs.words_[i];
+    }
+    return *this;
+  }
+  constexpr FixedBitmask &operator&=(const FixedBitmask &rhs) noexcept {
+    for (size_t i = 0; i < WORDS; i++) {
+      words_[i] &= rhs.words_[i];
+    }
+    return *this;
+  }
+  //! Remove the indexes of rhs from the set.
+  constexpr FixedBitmask &operator-=(const FixedBitmask &rhs) noexcept {
+    for (size_t i = 0; i < WORDS; i++) {
+      words_[i] &= ~rhs.words_[i];
+    }
+    return *this;
+  }
+  [[nodiscard]] friend constexpr FixedBitmask operator-(FixedBitmask lhs, const FixedBitmask &rhs) noexcept {
+    return lhs -= rhs;
+  }
+  [[nodiscard]] friend constexpr FixedBitmask operator|(FixedBitmask lhs, const FixedBitmask &rhs) noexcept {
+    return lhs |= rhs;
+  }
+  [[nodiscard]] friend constexpr FixedBitmask operator&(FixedBitmask lhs, const FixedBitmask &rhs) noexcept {
+    return lhs &= rhs;
+  }
+
+  //! Return the underlying words, bit i of the set is bit i%64 of word i/64.
+  [[nodiscard]] constexpr const std::array<uint64_t, WORDS> &Words() const noexcept { return words_; }
+  //! Replace a whole word of the set, the bits past Bits have to stay zero.
+  constexpr void SetWord(size_t word, uint64_t value) noexcept {
+    assert(word < WORDS);
+    words_[word] = value;
+  }
+
+  [[nodiscard]] constexpr Iterator begin() const noexcept {
+    Iterator result{this, 0, words_[0]};
+    result.Skip();
+    return result;
+  }
+  [[nodiscard]] constexpr Iterator end() const noexcept {
+    return Iterator{this, WORDS, 0};
+  }
+
+private:
+  std::array<uint64_t, WORDS> words_{};
+};
+
+} // namespace sudoku
+
+#endif // CORE_BITMASK_H_
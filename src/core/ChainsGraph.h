@@ -0,0 +1,267 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_CHAINS_GRAPH_H_
+#define CORE_CHAINS_GRAPH_H_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace sudoku {
+
+//! Types of links between two squares, encoded in the low bits of a link.
+enum LinkType : unsigned { WEAK_LINK = 1, STRONG_LINK = 2 };
+
+/*! Strong/weak link graph of the squares that can contain a number.
+ *
+ * Stored in compressed sparse row format, the links of node i are
+ * links[offsets[i]] .. links[offsets[i+1]-1], sorted by the target node.
+ * Each link encodes the target node index shifted by LINK_BITS together with
+ * the LinkType bits. Every strong link is also a weak link.
+ *
+ * The vectors are reused when the graph is rebuilt, so rebuilding a graph of
+ * the same (or smaller) puzzle doesn't allocate.
+ */
+struct ChainsGraph {
+  static constexpr unsigned LINK_BITS = 2;
+  static constexpr unsigned LINK_MASK = (1u << LINK_BITS) - 1;
+  static constexpr unsigned NO_NODE = ~0u;
+
+  // Absolute position of the square inside of the puzzle, in increasing order.
+  std::vector<unsigned> nodes;
+  std::vector<unsigned> offsets;
+  std::vector<unsigned> links;
+  // Node index of each square of the puzzle, NO_NODE for squares without the number.
+  std::vector<unsigned> node_ids;
+
+  //! Remove all nodes and links, the graph will cover a puzzle with the given number of squares.
+  void Reset(unsigned squares) {
+    nodes.clear();
+    offsets.assign(1, 0);
+    links.clear();
+    node_ids.assign(squares, NO_NODE);
+  }
+
+  //! Add a node, nodes have to be added in increasing order, before any links.
+  void AddNode(unsigned square) {
+    node_ids[square] = static_cast<unsigned>(nodes.size());
+    nodes.push_back(square);
+  }
+
+  /*! Add a link from the current node to the square.
+   *
+   * Links are added for one node at a time in node order, each node is
+   * completed by EndNode(), including nodes without any links.
+   */
+  void AddLink(unsigned square, unsigned type) {
+    links.push_back((node_ids[square] << LINK_BITS) | type);
+  }
+  //! Sort the links of the current node and merge the duplicates.
+  void EndNode() {
+    auto begin = links.begin() + offsets.back();
+    std::sort(begin, links.end());
+    auto out = begin;
+    for (auto it = begin; it != links.end(); ++it) {
+      if (out != begin && LinkNode(*(out - 1)) == LinkNode(*it)) {
+        *(out - 1) |= *it;
+      } else {
+        *out++ = *it;
+      }
+    }
+    links.erase(out, links.end());
+    offsets.push_back(static_cast<unsigned>(links.size()));
+  }
+
+  [[nodiscard]] static constexpr unsigned LinkNode(unsigned link) noexcept { return link >> LINK_BITS; }
+  [[nodiscard]] static constexpr unsigned LinkTypes(unsigned link) noexcept { return link & LINK_MASK; }
+
+  //! Return the links of the node.
+  [[nodiscard]] std::span<const unsigned> Links(unsigned node) const noexcept {
+    return std::span<const unsigned>(links).subspan(offsets[node], offsets[node + 1] - offsets[node]);
+  }
+
+  //! Return the node index of the square, NO_NODE if the square isn't in the graph.
+  [[nodiscard]] unsigned NodeId(unsigned square) const noexcept { return node_ids[square]; }
+
+  //! Return the number of links of the given type from the square.
+  [[nodiscard]] unsigned CountLinks(unsigned square, LinkType type) const noexcept {
+    unsigned node = NodeId(square);
+    if (node == NO_NODE)
+      return 0;
+    auto range = Links(node);
+    return static_cast<unsigned>(std::count_if(range.begin(), range.end(),
+                                               [type](unsigned link) { return (link & type) != 0; }));
+  }
+};
+
+/*! Path through the squares of a puzzle, with a visited mask for cycle checks.
+ *
+ * Meant to be reused between traversals, so that the traversal itself
+ * doesn't allocate.
+ */
+class ChainsPath {
+public:
+  //! Clear the path, the path will cover a puzzle with the given number of squares.
+  void Reset(unsigned squares) {
+    squares_.clear();
+    squares_.reserve(squares);
+    visited_.assign((squares + 63) / 64, 0);
+  }
+
+  void Push(unsigned square) {
+    squares_.push_back(square);
+    visited_[square / 64] |= UINT64_C(1) << (square % 64);
+  }
+  void Pop() {
+    unsigned square = squares_.back();
+    squares_.pop_back();
+    visited_[square / 64] &= ~(UINT64_C(1) << (square % 64));
+  }
+
+  [[nodiscard]] bool Contains(unsigned square) const noexcept {
+    return (visited_[square / 64] >> (square % 64)) & 1u;
+  }
+  [[nodiscard]] size_t Size() const noexcept { return squares_.size(); }
+  [[nodiscard]] unsigned Back() const noexcept { return squares_.back(); }
+  [[nodiscard]] std::span<const unsigned> Squares() const noexcept { return squares_; }
+
+private:
+  std::vector<unsigned> squares_;
+  std::vector<uint64_t> visited_;
+};
+
+namespace detail {
+template <typename Callback>
+void TraverseAlternatingChains(const ChainsGraph &graph, unsigned length, ChainsPath &path, Callback &cb,
+                               unsigned node, bool weak) {
+  if (path.Size() == length) {
+    cb(path.Squares());
+    return;
+  }
+
+  const unsigned type = weak ? WEAK_LINK : STRONG_LINK;
+  for (auto link : graph.Links(node)) {
+    if ((link & type) == 0)
+      continue;
+    unsigned next = ChainsGraph::LinkNode(link);
+    unsigned square = graph.nodes[next];
+    if (path.Contains(square))
+      continue;
+    path.Push(square);
+    TraverseAlternatingChains(graph, length, path, cb, next, !weak);
+    path.Pop();
+  }
+}
+} // namespace detail
+
+/*! Call the callback for each path of length squares that alternates
+ * strong and weak links, starting with a strong link.
+ *
+ * @param graph Graph to traverse.
+ * @param length Number of squares in the reported paths.
+ * @param path Scratch path, reset by the traversal.
+ * @param cb Callback receiving the squares of the path.
+ */
+template <typename Callback>
+void TraverseAlternatingChains(const ChainsGraph &graph, unsigned length, ChainsPath &path, Callback &&cb) {
+  path.Reset(static_cast<unsigned>(graph.node_ids.size()));
+  for (unsigned node = 0; node < graph.nodes.size(); node++) {
+    path.Push(graph.nodes[node]);
+    detail::TraverseAlternatingChains(graph, length, path, cb, node, false);
+    path.Pop();
+  }
+}
+
+//! Removal of a number from a square, together with the chain that implies it.
+struct ChainElimination {
+  unsigned square;
+  // Squares of the chain, in order from one end to the other.
+  std::vector<unsigned> chain;
+};
+
+/*! Breadth first search for the shortest alternating chains from a node.
+ *
+ * Searches the states (node, parity of the number of links so far), where
+ * the first link and every other link after it has to be strong. Reaching a
+ * node over an odd number of links means that either the source or the
+ * reached node contains the number. Nodes are never revisited with the same
+ * parity, so the search is linear in the size of the graph.
+ *
+ * The storage is reused between searches.
+ */
+class AlternatingChainSearch {
+public:
+  /*! Search for the chains from the source node.
+   *
+   * @param graph Graph to search.
+   * @param source Node index of the first square of the chains.
+   * @param max_links Maximum number of links in a chain.
+   * @param blocked Node index that can't be part of any chain, NO_NODE for none.
+   */
+  void Run(const ChainsGraph &graph, unsigned source, unsigned max_links, unsigned blocked = ChainsGraph::NO_NODE) {
+    const unsigned states = static_cast<unsigned>(graph.nodes.size()) * 2;
+    graph_ = &graph;
+    source_ = source;
+    links_.assign(states, UNREACHED);
+    parents_.resize(states);
+    queue_.clear();
+
+    links_[source * 2] = 0;
+    queue_.push_back(source * 2);
+    for (size_t head = 0; head < queue_.size(); head++) {
+      unsigned state = queue_[head];
+      unsigned node = state / 2;
+      unsigned parity = state % 2;
+      if (links_[state] == max_links)
+        continue;
+      // Even parity continues with a strong link, odd parity with any link.
+      const unsigned type = parity == 0 ? STRONG_LINK : WEAK_LINK;
+      for (auto link : graph.Links(node)) {
+        if ((link & type) == 0)
+          continue;
+        unsigned next = ChainsGraph::LinkNode(link);
+        if (next == source || next == blocked)
+          continue;
+        unsigned next_state = next * 2 + (1 - parity);
+        if (links_[next_state] != UNREACHED)
+          continue;
+        links_[next_state] = links_[state] + 1;
+        parents_[next_state] = state;
+        queue_.push_back(next_state);
+      }
+    }
+  }
+
+  //! Return whether the last search found a chain from the source to the node.
+  [[nodiscard]] bool Reaches(unsigned node) const noexcept { return links_[node * 2 + 1] != UNREACHED; }
+
+  //! Return the number of links of the shortest chain to the node.
+  [[nodiscard]] unsigned Links(unsigned node) const noexcept { return links_[node * 2 + 1]; }
+
+  //! Store the squares of the shortest chain from the source to the node.
+  void Chain(unsigned node, std::vector<unsigned> &squares) const {
+    squares.resize(Links(node) + 1);
+    unsigned state = node * 2 + 1;
+    for (size_t i = squares.size() - 1; i > 0; i--) {
+      squares[i] = graph_->nodes[state / 2];
+      state = parents_[state];
+    }
+    squares[0] = graph_->nodes[source_];
+  }
+
+private:
+  static constexpr unsigned UNREACHED = ~0u;
+
+  const ChainsGraph *graph_ = nullptr;
+  unsigned source_ = 0;
+  std::vector<unsigned> links_;
+  std::vector<unsigned> parents_;
+  std::vector<unsigned> queue_;
+};
+
+} // namespace sudoku
+
+#endif // CORE_CHAINS_GRAPH_H_
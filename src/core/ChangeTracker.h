@@ -0,0 +1,186 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_CHANGE_TRACKER_H_
+#define CORE_CHANGE_TRACKER_H_
+
+#include "BitSet.h"
+#include "Bitmask.h"
+#include "PositionIndex.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sudoku {
+
+//! Upper bound on the number of blocks in a puzzle (3*64 + 2 diagonals).
+constexpr unsigned MAX_BLOCKS = 256;
+
+//! Set of block ids.
+using BlockMask = FixedBitmask<MAX_BLOCKS>;
+
+/*! Dirty tracking of the squares of a puzzle.
+ *
+ * Squares are marked when they are modified, together with all the blocks
+ * they belong to, so that checking for a change doesn't need to compare the
+ * puzzle against a snapshot. The tracker also keeps the position index of
+ * the puzzle in sync with the modifications.
+ */
+class ChangeTracker {
+public:
+  /*! Construct the tracker for a puzzle.
+   *
+   * @param mapping Ids of the blocks containing each square, has to outlive
+   *        the tracker.
+   * @param index Position index of the current squares of the puzzle.
+   */
+  ChangeTracker(const std::vector<std::vector<unsigned>> &mapping, PositionIndex index)
+      : mapping_(&mapping), cells_((mapping.size() + 63) / 64, 0), index_(std::move(index)) {}
+
+  //! Record the modification of a square from before to after.
+  void Update(unsigned cell, const BitSet &before, const BitSet &after) noexcept {
+    MarkChanged(cell);
+    index_.Update(cell, before, after);
+    eliminated_ += (before - after).CountSet();
+  }
+
+  //! Mark the square and all the blocks it belongs to as changed.
+  void MarkChanged(unsigned cell) noexcept {
+    uint64_t bit = UINT64_C(1) << (cell % 64);
+    if (cells_[cell / 64] & bit)
+      return;
+    cells_[cell / 64] |= bit;
+    for (auto block : (*mapping_)[cell]) {
+      blocks_.Set(block);
+    }
+  }
+
+  //! Return whether any square was changed since the last Reset().
+  [[nodiscard]] bool HasChange() const noexcept { return blocks_.Any(); }
+  //! Return whether the square was changed since the last Reset().
+  [[nodiscard]] bool IsChanged(unsigned cell) const noexcept {
+    return (cells_[cell / 64] >> (cell % 64)) & 1u;
+  }
+  //! Return the set of blocks containing a changed square.
+  [[nodiscard]] const BlockMask &ChangedBlocks() const noexcept { return blocks_; }
+
+  //! Clear all the change marks, the position index is not affected.
+  void Reset() noexcept {
+    std::fill(cells_.begin(), cells_.end(), 0);
+    blocks_.Clear();
+  }
+
+  //! Return the positions of the numbers inside of the blocks.
+  [[nodiscard]] const PositionIndex &Index() const noexcept { return index_; }
+
+  //! Return the total number of candidates removed from the squares, not affected by Reset().
+  [[nodiscard]] uint64_t Eliminated() const noexcept { return eliminated_; }
+
+private:
+  const std::vector<std::vector<unsigned>> *mapping_;
+  std::vector<uint64_t> cells_;
+  BlockMask blocks_;
+  PositionIndex index_;
+  uint64_t eliminated_ = 0;
+};
+
+/*! Reference to a square of a tracked grid.
+ *
+ * Reads go straight to the square, writes that modify the square mark it
+ * as changed.
+ */
+class SquareRef {
+public:
+  SquareRef(BitSet &square, ChangeTracker &tracker, unsigned cell) noexcept
+      : square_(&square), tracker_(&tracker), cell_(cell) {}
+  SquareRef(const SquareRef &) noexcept = default;
+
+  SquareRef &operator=(const BitSet &value) noexcept {
+    if (*square_ != value) {
+      tracker_->Update(cell_, *square_, value);
+      *square_ = value;
+    }
+    return *this;
+  }
+  SquareRef &operator=(const SquareRef &rhs) noexcept {
+    return *this = static_cast<const BitSet &>(rhs);
+  }
+
+  SquareRef &operator+=(unsigned number) noexcept { return *this = *square_ + number; }
+  SquareRef &operator-=(unsigned number) noexcept { return *this = *square_ - number; }
+  SquareRef &operator-=(const BitSet &rhs) noexcept { return *this = *square_ - rhs; }
+  SquareRef &operator|=(const BitSet &rhs) noexcept { return *this = *square_ | rhs; }
+  SquareRef &operator&=(const BitSet &rhs) noexcept { return *this = *square_ & rhs; }
+
+  operator const BitSet &() const noexcept { return *square_; }
+
+  [[nodiscard]] bool HasIntersection(const BitSet &rhs) const noexcept { return square_->HasIntersection(rhs); }
+  [[nodiscard]] bool HasAdditionalBits(const BitSet &rhs) const noexcept { return square_->HasAdditionalBits(rhs); }
+  [[nodiscard]] unsigned CountSet() const noexcept { return square_->CountSet(); }
+  [[nodiscard]] unsigned SingletonValue() const noexcept { return square_->SingletonValue(); }
+  [[nodiscard]] bool HasSingletonValue() const noexcept { return square_->HasSingletonValue(); }
+  [[nodiscard]] bool IsBitSet(unsigned bit) const noexcept { return square_->IsBitSet(bit); }
+  [[nodiscard]] std::string DebugString(unsigned max_value) const { return square_->DebugString(max_value); }
+
+  [[nodiscard]] friend bool operator==(const SquareRef &lhs, const SquareRef &rhs) noexcept {
+    return *lhs.square_ == *rhs.square_;
+  }
+  [[nodiscard]] friend bool operator==(const SquareRef &lhs, const BitSet &rhs) noexcept {
+    return *lhs.square_ == rhs;
+  }
+  friend std::ostream &operator<<(std::ostream &s, const SquareRef &square) {
+    return s << *square.square_;
+  }
+
+private:
+  BitSet *square_;
+  ChangeTracker *tracker_;
+  unsigned cell_;
+};
+
+//! Pointer to a square of a tracked grid, see SquareRef.
+class TrackedSquare {
+public:
+  TrackedSquare(BitSet *square, ChangeTracker *tracker, unsigned cell) noexcept
+      : square_(square), tracker_(tracker), cell_(cell) {}
+
+  [[nodiscard]] SquareRef operator*() const noexcept { return SquareRef(*square_, *tracker_, cell_); }
+  [[nodiscard]] const BitSet *operator->() const noexcept { return square_; }
+
+private:
+  BitSet *square_;
+  ChangeTracker *tracker_;
+  unsigned cell_;
+};
+
+/*! Grid of squares with change tracking.
+ *
+ * Has the same interface as a plain BitSet pointer to the first square of
+ * the grid, which makes it possible to use it with the templated algorithms.
+ */
+class TrackedGrid {
+public:
+  TrackedGrid(BitSet *data, ChangeTracker &tracker) noexcept
+      : data_(data), tracker_(&tracker) {}
+
+  [[nodiscard]] SquareRef operator[](unsigned cell) const noexcept {
+    return SquareRef(data_[cell], *tracker_, cell);
+  }
+  [[nodiscard]] TrackedSquare operator+(unsigned cell) const noexcept {
+    return TrackedSquare(data_ + cell, tracker_, cell);
+  }
+
+  //! Return the untracked squares of the grid.
+  [[nodiscard]] const BitSet *Data() const noexcept { return data_; }
+
+private:
+  BitSet *data_;
+  ChangeTracker *tracker_;
+};
+
+} // namespace sudoku
+
+#endif // CORE_CHANGE_TRACKER_H_
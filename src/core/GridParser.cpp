@@ -0,0 +1,205 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#include "GridParser.h"
+#include "NakedSingles.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define SUDOKU_HAS_AVX2_KERNEL 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define SUDOKU_TARGET_AVX2
+#else
+#define SUDOKU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace sudoku {
+
+namespace {
+
+// Squares of the largest supported puzzle.
+constexpr unsigned MAX_SQUARES = 64 * 64;
+
+// Value of a character that isn't a square.
+constexpr uint8_t INVALID = 0xFF;
+
+// Both kernels work in two steps, the characters are turned into the numbers
+// of the squares first (0 for an empty square), which are then expanded into
+// the possibilities. Nothing is written before the whole text is checked.
+
+uint8_t CharValue(char c) {
+  if (c >= '0' && c <= '9')
+    return static_cast<uint8_t>(c - '0');
+  if (c >= 'A' && c <= 'Z')
+    return static_cast<uint8_t>(c - 'A' + 10);
+  if (c >= 'a' && c <= 'z')
+    return static_cast<uint8_t>(c - 'a' + 10);
+  if (c == '.' || c == '*')
+    return 0;
+  return INVALID;
+}
+
+bool ValuesScalar(const char *text, unsigned begin, unsigned count, unsigned size, uint8_t *values) {
+  for (unsigned i = begin; i < count; i++) {
+    values[i] = CharValue(text[i]);
+    if (values[i] > size)
+      return false;
+  }
+  return true;
+}
+
+void ExpandScalar(const uint8_t *values, unsigned begin, unsigned count, unsigned size, BitSet *squares) {
+  for (unsigned i = begin; i < count; i++) {
+    squares[i] = values[i] == 0 ? BitSet::SudokuSquare(size) : BitSet::SingleBit(size, values[i]);
+  }
+}
+
+bool MatchesScalar(const uint8_t *values, unsigned begin, unsigned count, unsigned size, const BitSet *squares) {
+  for (unsigned i = begin; i < count; i++) {
+    if (values[i] == 0 || squares[i] != BitSet::SingleBit(size, values[i]))
+      return false;
+  }
+  return true;
+}
+
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+
+// Classifies 32 characters at once, a character is a digit if it is at most
+// 9 above '0' and a letter if it is at most 25 above 'a' once folded to lower
+// case, both as unsigned bytes.
+SUDOKU_TARGET_AVX2 bool ValuesAvx2(const char *text, unsigned count, unsigned size, uint8_t *values) {
+  const __m256i zero_char = _mm256_set1_epi8('0');
+  const __m256i a_char = _mm256_set1_epi8('a');
+  const __m256i lower_case = _mm256_set1_epi8(0x20);
+  const __m256i nine = _mm256_set1_epi8(9);
+  const __m256i twenty_five = _mm256_set1_epi8(25);
+  const __m256i ten = _mm256_set1_epi8(10);
+  const __m256i dot = _mm256_set1_epi8('.');
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i largest = _mm256_set1_epi8(static_cast<char>(size));
+
+  __m256i valid = _mm256_set1_epi8(-1);
+  unsigned i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i));
+    __m256i digit = _mm256_sub_epi8(c, zero_char);
+    __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit);
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(c, lower_case), a_char);
+    __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, twenty_five), letter);
+    __m256i is_empty = _mm256_or_si256(_mm256_cmpeq_epi8(c, dot), _mm256_cmpeq_epi8(c, star));
+
+    __m256i value = _mm256_blendv_epi8(_mm256_and_si256(is_letter, _mm256_add_epi8(letter, ten)), digit, is_digit);
+    __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(value, largest), value);
+    __m256i known = _mm256_or_si256(_mm256_or_si256(is_digit, is_letter), is_empty);
+    valid = _mm256_and_si256(valid, _mm256_and_si256(known, in_range));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(values + i), value);
+  }
+  if (_mm256_movemask_epi8(valid) != -1)
+    return false;
+  return ValuesScalar(text, i, count, size, values);
+}
+
+// The possibilities of four squares, a shift by more than 63 bits gives zero,
+// which covers the empty squares.
+SUDOKU_TARGET_AVX2 __m256i SingleBits(const uint8_t *values, __m256i one) {
+  int32_t packed;
+  std::memcpy(&packed, values, sizeof(packed));
+  __m256i value = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+  return _mm256_sllv_epi64(one, _mm256_sub_epi64(value, one));
+}
+
+SUDOKU_TARGET_AVX2 void ExpandAvx2(const uint8_t *values, unsigned count, unsigned size, BitSet *squares) {
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i full = _mm256_set1_epi64x(static_cast<long long>(BitSet::SudokuSquare(size).Value()));
+  const __m256i zero = _mm256_setzero_si256();
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i bits = SingleBits(values + i, one);
+    __m256i empty = _mm256_cmpeq_epi64(bits, zero);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(squares + i), _mm256_or_si256(bits, _mm256_and_si256(empty, full)));
+  }
+  ExpandScalar(values, i, count, size, squares);
+}
+
+SUDOKU_TARGET_AVX2 bool MatchesAvx2(const uint8_t *values, unsigned count, unsigned size, const BitSet *squares) {
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i equal = _mm256_set1_epi64x(-1);
+  unsigned i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i bits = SingleBits(values + i, one);
+    __m256i square = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(squares + i));
+    // An empty square of the solution gives no bits, which an empty square of
+    // the puzzle would match.
+    __m256i matched = _mm256_andnot_si256(_mm256_cmpeq_epi64(bits, zero), _mm256_cmpeq_epi64(bits, square));
+    equal = _mm256_and_si256(equal, matched);
+  }
+  if (_mm256_movemask_epi8(equal) != -1)
+    return false;
+  return MatchesScalar(values, i, count, size, squares);
+}
+
+#endif
+
+bool UseAvx2(GridKernel kernel) {
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+  return kernel == GridKernel::AVX2 && HasAvx2Kernel();
+#else
+  (void)kernel;
+  return false;
+#endif
+}
+
+// Read the numbers of the squares, false if the text isn't a grid of the size.
+bool Values(std::string_view text, unsigned size, uint8_t *values, bool avx2) {
+  assert(size <= BitSet::BITS);
+  const unsigned count = size * size;
+  if (text.size() < count)
+    return false;
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+  if (avx2)
+    return ValuesAvx2(text.data(), count, size, values);
+#else
+  (void)avx2;
+#endif
+  return ValuesScalar(text.data(), 0, count, size, values);
+}
+
+} // namespace
+
+GridKernel BestGridKernel() {
+  return HasAvx2Kernel() ? GridKernel::AVX2 : GridKernel::SCALAR;
+}
+
+bool ParseGrid(std::string_view text, unsigned size, BitSet *squares, GridKernel kernel) {
+  uint8_t values[MAX_SQUARES];
+  const bool avx2 = UseAvx2(kernel);
+  if (!Values(text, size, values, avx2))
+    return false;
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+  if (avx2) {
+    ExpandAvx2(values, size * size, size, squares);
+    return true;
+  }
+#endif
+  ExpandScalar(values, 0, size * size, size, squares);
+  return true;
+}
+
+bool MatchesGrid(std::string_view text, unsigned size, const BitSet *squares, GridKernel kernel) {
+  uint8_t values[MAX_SQUARES];
+  const bool avx2 = UseAvx2(kernel);
+  if (!Values(text, size, values, avx2))
+    return false;
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+  if (avx2)
+    return MatchesAvx2(values, size * size, size, squares);
+#endif
+  return MatchesScalar(values, 0, size * size, size, squares);
+}
+
+} // namespace sudoku
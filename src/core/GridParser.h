@@ -0,0 +1,51 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_GRID_PARSER_H_
+#define CORE_GRID_PARSER_H_
+
+#include "BitSet.h"
+#include <string_view>
+
+namespace sudoku {
+
+//! Largest number that has a square character, larger puzzles have no grid text.
+constexpr unsigned MAX_GRID_NUMBER = 35;
+
+//! Implementations of the grid parser and the solution comparator.
+enum class GridKernel { SCALAR, AVX2 };
+
+//! Return the fastest kernel supported on this machine, detected once at runtime.
+GridKernel BestGridKernel();
+
+/*! Convert the squares of a grid, one character per square, into their
+ * possibilities.
+ *
+ * '0', '.' and '*' are empty squares with all the numbers possible, '1' to
+ * '9' and 'A' to 'Z' (in either case) stand for the numbers 1 to 35. There
+ * are no separators, see ReadPuzzle for the text that has them.
+ *
+ * @param text At least size*size characters, only the first ones are read.
+ * @param size Size of the puzzle, at most 64.
+ * @param squares Receives the size*size squares, not modified if the text is
+ *        rejected.
+ * @param kernel Implementation to use, AVX2 falls back to SCALAR if it isn't
+ *        supported.
+ * @return False if the text is too short, or has a character that isn't a
+ *         square or a number larger than size.
+ */
+bool ParseGrid(std::string_view text, unsigned size, BitSet *squares, GridKernel kernel = BestGridKernel());
+
+/*! Return whether the squares hold exactly the numbers of the solution.
+ *
+ * @param text Solution, at least size*size characters as in ParseGrid, an
+ *        empty square in it never matches.
+ * @param size Size of the puzzle, at most 64.
+ * @param squares The size*size squares to compare.
+ * @param kernel Implementation to use, AVX2 falls back to SCALAR if it isn't
+ *        supported.
+ */
+bool MatchesGrid(std::string_view text, unsigned size, const BitSet *squares, GridKernel kernel = BestGridKernel());
+
+} // namespace sudoku
+
+#endif // CORE_GRID_PARSER_H_
@@ -0,0 +1,225 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#include "NakedSingles.h"
+
+#include <cassert>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define SUDOKU_HAS_AVX2_KERNEL 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows AVX2 intrinsics in any function.
+#define SUDOKU_TARGET_AVX2
+#else
+#define SUDOKU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace sudoku {
+
+namespace {
+
+constexpr unsigned STRIDE = PackedGrid::STRIDE;
+
+// Both kernels follow the same steps in each pass:
+//  1. Mask out the solved squares (the ones with exactly one bit set).
+//  2. OR-reduce the solved masks per row, column, box and diagonal.
+//  3. Remove the reduced masks from the unsolved squares.
+// and repeat until a pass doesn't change anything.
+
+// Union of the solved squares for each row of each box band, box masks are
+// broadcast to all the columns of the box.
+using BandMasks = std::array<SmallBitSet, STRIDE * STRIDE>;
+
+void ReduceBoxes(const SmallBitSet *solved, unsigned size, unsigned box, BandMasks &bands) {
+  for (unsigned band = 0; band < size / box; band++) {
+    SmallBitSet *masks = &bands[band * STRIDE];
+    for (unsigned col = 0; col < size; col += box) {
+      SmallBitSet mask;
+      for (unsigned row = band * box; row < (band + 1) * box; row++) {
+        for (unsigned i = col; i < col + box; i++) {
+          mask |= solved[row * STRIDE + i];
+        }
+      }
+      for (unsigned i = col; i < col + box; i++) {
+        masks[i] = mask;
+      }
+    }
+  }
+}
+
+void ReduceDiagonals(const SmallBitSet *solved, unsigned size, SmallBitSet &main, SmallBitSet &anti) {
+  main = SmallBitSet();
+  anti = SmallBitSet();
+  for (unsigned i = 0; i < size; i++) {
+    main |= solved[i * STRIDE + i];
+    anti |= solved[i * STRIDE + size - 1 - i];
+  }
+}
+
+bool IsSolved(SmallBitSet square) {
+  return (square.Value() & (square.Value() - 1)) == 0;
+}
+
+bool PropagateScalar(PackedGrid &grid, unsigned size, unsigned box, bool diagonal) {
+  SmallBitSet *squares = grid.squares.data();
+  alignas(32) std::array<SmallBitSet, STRIDE * STRIDE> solved{};
+  BandMasks bands{};
+  bool modified = false;
+  while (true) {
+    std::array<SmallBitSet, STRIDE> rows{};
+    std::array<SmallBitSet, STRIDE> cols{};
+    for (unsigned row = 0; row < size; row++) {
+      for (unsigned col = 0; col < size; col++) {
+        SmallBitSet square = squares[row * STRIDE + col];
+        SmallBitSet value = IsSolved(square) ? square : SmallBitSet();
+        solved[row * STRIDE + col] = value;
+        rows[row] |= value;
+        cols[col] |= value;
+      }
+    }
+    ReduceBoxes(solved.data(), size, box, bands);
+    SmallBitSet main, anti;
+    if (diagonal)
+      ReduceDiagonals(solved.data(), size, main, anti);
+
+    bool changed = false;
+    for (unsigned row = 0; row < size; row++) {
+      for (unsigned col = 0; col < size; col++) {
+        SmallBitSet &square = squares[row * STRIDE + col];
+        if (IsSolved(square))
+          continue;
+        SmallBitSet peers = rows[row] | cols[col] | bands[(row / box) * STRIDE + col];
+        if (diagonal && row == col)
+          peers |= main;
+        if (diagonal && row + col == size - 1)
+          peers |= anti;
+        SmallBitSet pruned = square - peers;
+        if (pruned != square) {
+          square = pruned;
+          changed = true;
+        }
+      }
+    }
+    if (!changed)
+      return modified;
+    modified = true;
+  }
+}
+
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+
+// Broadcast the union of all the squares of the row into all the lanes.
+SUDOKU_TARGET_AVX2 __m256i HorizontalOr(__m256i v) {
+  v = _mm256_or_si256(v, _mm256_permute2x128_si256(v, v, 0x01));
+  v = _mm256_or_si256(v, _mm256_shuffle_epi32(v, 0x4E));
+  v = _mm256_or_si256(v, _mm256_shuffle_epi32(v, 0xB1));
+  return _mm256_or_si256(v, _mm256_or_si256(_mm256_slli_epi32(v, 16), _mm256_srli_epi32(v, 16)));
+}
+
+SUDOKU_TARGET_AVX2 bool PropagateAvx2(PackedGrid &grid, unsigned size, unsigned box, bool diagonal) {
+  // SmallBitSet is a bare 16 bit word, so each row of squares is loaded
+  // directly as 16 lanes.
+  SmallBitSet *squares = grid.squares.data();
+  alignas(32) std::array<SmallBitSet, STRIDE * STRIDE> solved{};
+  alignas(32) BandMasks bands{};
+  alignas(32) std::array<SmallBitSet, STRIDE> diagonals{};
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i zero = _mm256_setzero_si256();
+
+  __m256i rows[STRIDE];
+  for (unsigned row = 0; row < size; row++) {
+    rows[row] = _mm256_load_si256(reinterpret_cast<const __m256i *>(&squares[row * STRIDE]));
+  }
+
+  bool modified = false;
+  while (true) {
+    __m256i singles[STRIDE];
+    __m256i cols = zero;
+    for (unsigned row = 0; row < size; row++) {
+      __m256i v = rows[row];
+      singles[row] = _mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_sub_epi16(v, one)), zero);
+      __m256i value = _mm256_and_si256(v, singles[row]);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(&solved[row * STRIDE]), value);
+      cols = _mm256_or_si256(cols, value);
+    }
+    ReduceBoxes(solved.data(), size, box, bands);
+    SmallBitSet main, anti;
+    if (diagonal)
+      ReduceDiagonals(solved.data(), size, main, anti);
+
+    __m256i changed = zero;
+    for (unsigned row = 0; row < size; row++) {
+      __m256i v = rows[row];
+      __m256i value = _mm256_load_si256(reinterpret_cast<const __m256i *>(&solved[row * STRIDE]));
+      __m256i band = _mm256_load_si256(reinterpret_cast<const __m256i *>(&bands[(row / box) * STRIDE]));
+      __m256i peers = _mm256_or_si256(_mm256_or_si256(HorizontalOr(value), cols), band);
+      if (diagonal) {
+        diagonals[row] = main;
+        diagonals[size - 1 - row] |= anti;
+        peers = _mm256_or_si256(peers, _mm256_load_si256(reinterpret_cast<const __m256i *>(diagonals.data())));
+        diagonals[row] = SmallBitSet();
+        diagonals[size - 1 - row] = SmallBitSet();
+      }
+      __m256i pruned = _mm256_blendv_epi8(_mm256_andnot_si256(peers, v), v, singles[row]);
+      changed = _mm256_or_si256(changed, _mm256_xor_si256(pruned, v));
+      rows[row] = pruned;
+    }
+    if (_mm256_testz_si256(changed, changed))
+      break;
+    modified = true;
+  }
+
+  for (unsigned row = 0; row < size; row++) {
+    _mm256_store_si256(reinterpret_cast<__m256i *>(&squares[row * STRIDE]), rows[row]);
+  }
+  return modified;
+}
+
+bool DetectAvx2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  // The OS has to save the YMM registers on context switch.
+  if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+} // namespace
+
+bool HasAvx2Kernel() {
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+  static const bool supported = DetectAvx2();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+SinglesKernel BestSinglesKernel() {
+  return HasAvx2Kernel() ? SinglesKernel::AVX2 : SinglesKernel::SCALAR;
+}
+
+bool PropagateNakedSingles(PackedGrid &grid, unsigned size, unsigned box, bool diagonal, SinglesKernel kernel) {
+  assert(size <= PackedGrid::STRIDE && box * box == size);
+#ifdef SUDOKU_HAS_AVX2_KERNEL
+  if (kernel == SinglesKernel::AVX2 && HasAvx2Kernel())
+    return PropagateAvx2(grid, size, box, diagonal);
+#else
+  (void)kernel;
+#endif
+  return PropagateScalar(grid, size, box, diagonal);
+}
+
+} // namespace sudoku
@@ -0,0 +1,53 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_NAKED_SINGLES_H_
+#define CORE_NAKED_SINGLES_H_
+
+#include "BitSet.h"
+#include <array>
+
+namespace sudoku {
+
+/*! Candidate grid of up to 16x16 squares in a contiguous buffer.
+ *
+ * Each square is stored as a SmallBitSet and each row is padded to STRIDE
+ * squares, so that a row fits exactly into a single 256 bit
+ * vector. Padding squares have to be zero.
+ */
+struct alignas(32) PackedGrid {
+  //! Number of squares reserved for each row.
+  static constexpr unsigned STRIDE = 16;
+
+  std::array<SmallBitSet, STRIDE * STRIDE> squares{};
+};
+
+//! Implementations of the naked single propagation.
+enum class SinglesKernel { SCALAR, AVX2 };
+
+//! Return whether the CPU (and the build) supports the AVX2 kernel.
+bool HasAvx2Kernel();
+
+//! Return the fastest kernel supported on this machine, detected once at runtime.
+SinglesKernel BestSinglesKernel();
+
+/*! Remove the numbers of solved squares from all their peers until there
+ * is nothing left to remove.
+ *
+ * Peers are the squares sharing a row, a column, a box and, for diagonal
+ * puzzles, a diagonal. Solved squares are never modified, a square left with
+ * no possibilities stays empty.
+ *
+ * @param grid Grid to propagate in.
+ * @param size Size of the puzzle, at most PackedGrid::STRIDE.
+ * @param box Size of the square boxes, size has to be box*box.
+ * @param diagonal Whether the diagonals are blocks as well.
+ * @param kernel Implementation to use, AVX2 falls back to SCALAR if it isn't
+ *        supported.
+ * @return Whether any square was modified.
+ */
+bool PropagateNakedSingles(PackedGrid &grid, unsigned size, unsigned box, bool diagonal,
+                           SinglesKernel kernel = BestSinglesKernel());
+
+} // namespace sudoku
+
+#endif // CORE_NAKED_SINGLES_H_
@@ -0,0 +1,104 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_POSITION_INDEX_H_
+#define CORE_POSITION_INDEX_H_
+
+#include "BitSet.h"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace sudoku {
+
+//! Positions of each number inside of a single block, indexed by number-1.
+class BlockPositions {
+public:
+  BlockPositions(const BitSet *first, size_t stride, size_t count) noexcept
+      : first_(first), stride_(stride), count_(count) {}
+
+  [[nodiscard]] const BitSet &operator[](size_t index) const noexcept { return first_[index * stride_]; }
+  [[nodiscard]] size_t size() const noexcept { return count_; }
+
+private:
+  const BitSet *first_;
+  size_t stride_;
+  size_t count_;
+};
+
+/*! Transposed view of a grid, the positions of each number inside of each
+ * block.
+ *
+ * Positions are 1-based indexes into the cells of the block, the same as
+ * returned by UniqueBlock::NumberPositions(). The index is kept up to date
+ * by reporting every modification of a square through Update().
+ */
+class PositionIndex {
+public:
+  PositionIndex() = default;
+
+  /*! Construct the index for a grid.
+   *
+   * @param mapping Ids of the blocks containing each square, has to outlive
+   *        the index.
+   * @param offsets Position of each square inside of the blocks in mapping,
+   *        has to outlive the index.
+   * @param blocks Number of blocks.
+   * @param max Maximum number in the puzzle.
+   * @param grid Current squares of the puzzle.
+   */
+  PositionIndex(const std::vector<std::vector<unsigned>> &mapping,
+                const std::vector<std::vector<unsigned>> &offsets,
+                unsigned blocks, unsigned max, const BitSet *grid)
+      : mapping_(&mapping), offsets_(&offsets), blocks_(blocks), max_(max),
+        positions_(static_cast<size_t>(blocks) * max, BitSet::Empty(max)) {
+    for (unsigned cell = 0; cell < mapping.size(); cell++) {
+      Update(cell, BitSet::Empty(max), grid[cell]);
+    }
+  }
+
+  //! Reflect the modification of a square from before to after.
+  void Update(unsigned cell, const BitSet &before, const BitSet &after) noexcept {
+    const auto &blocks = (*mapping_)[cell];
+    const auto &offsets = (*offsets_)[cell];
+    BitSet removed = before - after;
+    for (auto number : BitSetBits(&removed)) {
+      BitSet *positions = &positions_[(number - 1) * blocks_];
+      for (size_t i = 0; i < blocks.size(); i++) {
+        positions[blocks[i]] -= offsets[i] + 1;
+      }
+    }
+    BitSet added = after - before;
+    for (auto number : BitSetBits(&added)) {
+      BitSet *positions = &positions_[(number - 1) * blocks_];
+      for (size_t i = 0; i < blocks.size(); i++) {
+        positions[blocks[i]] += offsets[i] + 1;
+      }
+    }
+  }
+
+  //! Return the positions of the number inside of each block, indexed by block id.
+  [[nodiscard]] std::span<const BitSet> Positions(unsigned number) const noexcept {
+    return std::span<const BitSet>(positions_).subspan((number - 1) * blocks_, blocks_);
+  }
+  //! Return the positions of the number inside of the block.
+  [[nodiscard]] const BitSet &Positions(unsigned block, unsigned number) const noexcept {
+    return positions_[(number - 1) * blocks_ + block];
+  }
+  //! Return the positions of all the numbers inside of the block.
+  [[nodiscard]] BlockPositions Numbers(unsigned block) const noexcept {
+    return BlockPositions(positions_.data() + block, blocks_, max_);
+  }
+
+private:
+  const std::vector<std::vector<unsigned>> *mapping_ = nullptr;
+  const std::vector<std::vector<unsigned>> *offsets_ = nullptr;
+  unsigned blocks_ = 0;
+  unsigned max_ = 0;
+  // Number-major, the positions of a number in all the blocks are contiguous.
+  std::vector<BitSet> positions_;
+};
+
+} // namespace sudoku
+
+#endif // CORE_POSITION_INDEX_H_
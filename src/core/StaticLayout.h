@@ -0,0 +1,108 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#ifndef CORE_STATIC_LAYOUT_H_
+#define CORE_STATIC_LAYOUT_H_
+
+#include "Bitmask.h"
+
+#include <array>
+
+namespace sudoku {
+
+//! Return the size of the square boxes of a puzzle, 0 if size isn't a square.
+constexpr unsigned BoxSize(unsigned size) {
+  for (unsigned box = 1; box * box <= size; box++) {
+    if (box * box == size)
+      return box;
+  }
+  return 0;
+}
+
+/*! Block structure of a puzzle, generated at compile time.
+ *
+ * Blocks are numbered the same way as in SudokuLayout: rows, columns, boxes
+ * in row-major order and, for diagonal puzzles, the main and the anti
+ * diagonal.
+ */
+template <unsigned Size, bool Diagonal>
+struct StaticLayout {
+  static constexpr unsigned BOX = BoxSize(Size);
+  static_assert(BOX != 0, "Static layouts require square boxes");
+
+  static constexpr unsigned CELLS = Size * Size;
+  static constexpr unsigned BLOCKS = 3 * Size + (Diagonal ? 2 : 0);
+  //! Maximum number of blocks containing a single square.
+  static constexpr unsigned CELL_BLOCKS = Diagonal ? 5 : 3;
+
+  //! Set of squares of the puzzle.
+  using CellMask = FixedBitmask<CELLS>;
+
+  // Squares of each block.
+  std::array<std::array<unsigned, Size>, BLOCKS> block_cells{};
+  // Ids of the blocks containing each square in increasing order, the
+  // number of the blocks and the position of the square inside of them.
+  std::array<std::array<unsigned, CELL_BLOCKS>, CELLS> cell_blocks{};
+  std::array<unsigned, CELLS> cell_block_count{};
+  std::array<std::array<unsigned, CELL_BLOCKS>, CELLS> cell_offsets{};
+  // Squares sharing a block with each square, not including the square.
+  std::array<CellMask, CELLS> peers{};
+};
+
+template <unsigned Size, bool Diagonal>
+inline consteval StaticLayout<Size, Diagonal> generate_layout() {
+  using Layout = StaticLayout<Size, Diagonal>;
+  Layout result;
+  unsigned block = 0;
+  auto add_cell = [&result](unsigned id, unsigned offset, unsigned cell) {
+    result.block_cells[id][offset] = cell;
+    unsigned &count = result.cell_block_count[cell];
+    result.cell_blocks[cell][count] = id;
+    result.cell_offsets[cell][count] = offset;
+    count++;
+  };
+
+  for (unsigned i = 0; i < Size; i++, block++) {
+    for (unsigned j = 0; j < Size; j++) {
+      add_cell(block, j, i * Size + j);
+    }
+  }
+  for (unsigned j = 0; j < Size; j++, block++) {
+    for (unsigned i = 0; i < Size; i++) {
+      add_cell(block, i, i * Size + j);
+    }
+  }
+  for (unsigned i = 0; i < Size; i += Layout::BOX) {
+    for (unsigned j = 0; j < Size; j += Layout::BOX, block++) {
+      unsigned offset = 0;
+      for (unsigned x = i; x < i + Layout::BOX; x++) {
+        for (unsigned y = j; y < j + Layout::BOX; y++) {
+          add_cell(block, offset++, x * Size + y);
+        }
+      }
+    }
+  }
+  if constexpr (Diagonal) {
+    for (unsigned i = 0; i < Size; i++) {
+      add_cell(block, i, i * Size + i);
+      add_cell(block + 1, i, i * Size + Size - 1 - i);
+    }
+  }
+
+  for (unsigned cell = 0; cell < Layout::CELLS; cell++) {
+    for (unsigned k = 0; k < result.cell_block_count[cell]; k++) {
+      for (auto peer : result.block_cells[result.cell_blocks[cell][k]]) {
+        if (peer != cell)
+          result.peers[cell].Set(peer);
+      }
+    }
+  }
+  return result;
+}
+
+//! Compile-time block structure of a puzzle.
+template <unsigned Size, bool Diagonal>
+inline constexpr StaticLayout<Size, Diagonal> STATIC_LAYOUT = generate_layout<Size, Diagonal>();
+
+} // namespace sudoku
+
+#endif // CORE_STATIC_LAYOUT_H_
@@ -11,8 +11,12 @@
 
 namespace sudoku {
 
+// The square-based algorithms accept any random access range of pointers to
+// squares, e.g. std::vector<BitSet*> or the BlockSquares of a UniqueBlock.
+
 // Built for number of squares == max
-inline BitSet Union(const std::vector<BitSet*> &squares, BitSet selector) {
+template <typename Squares>
+inline BitSet Union(const Squares &squares, BitSet selector) {
     BitSet result = BitSet::Empty(static_cast<unsigned>(squares.size()));
     for (auto iter : BitSetBits(&selector)) {
       result |= *squares[iter-1];
@@ -20,7 +24,8 @@ inline BitSet Union(const std::vector<BitSet*> &squares, BitSet selector) {
     return result;
 }
 
-inline BitSet NumberPositions(const std::vector<BitSet*> &squares, unsigned number) {
+template <typename Squares>
+inline BitSet NumberPositions(const Squares &squares, unsigned number) {
     BitSet result = BitSet::Empty(static_cast<unsigned>(squares.size()));
     for (unsigned i = 0; i < squares.size(); i++) {
         if (squares[i]->IsBitSet(number))
@@ -29,95 +34,303 @@ inline BitSet NumberPositions(const std::vector<BitSet*> &squares, unsigned numb
     return result;
 }
 
-inline void SolveNakedGroups(const std::vector<BitSet*> &squares, unsigned size) {
+namespace detail {
+// Choose the members of a group from the largest one down, which visits the
+// groups in increasing order like BitSetSets, and abandon a branch as soon as
+// the union of the members has more than size bits. The union is read again
+// for every candidate member, since the groups found earlier can shrink it.
+template <typename Value, typename Found>
+void SearchGroups(const unsigned *elements, unsigned below, const Value &value, unsigned size, BitSet group,
+                  unsigned depth, const Found &found) {
+    if (depth == size) {
+        found(group);
+        return;
+    }
+    for (unsigned k = size - depth - 1; k < below; k++) {
+        BitSet merged = value(elements[k]);
+        for (auto member : BitSetBits(&group)) {
+            merged |= value(member);
+        }
+        if (merged.CountSet() <= size)
+            SearchGroups(elements, k, value, size, group + elements[k], depth + 1, found);
+    }
+}
+
+// Search the groups among the set bits of elements, see SearchGroups.
+template <typename Value, typename Found>
+void SearchGroups(BitSet elements, const Value &value, unsigned size, const Found &found) {
+    unsigned indexes[BitSet::BITS];
+    unsigned count = 0;
+    for (auto element : BitSetBits(&elements)) {
+        indexes[count++] = element;
+    }
+    if (size == 0 || size > count)
+        return;
+    SearchGroups(indexes, count, value, size, BitSet::Empty(count), 0, found);
+}
+} // namespace detail
+
+/*! Solve naked groups inside of a range of squares.
+ *
+ * Groups larger than one are only searched for among the unsolved squares,
+ * a group including a solved square only repeats the removal of the solved
+ * number. Blocks with at most size unsolved squares are skipped. The groups
+ * are built a square at a time and a branch ends once its squares have more
+ * than size numbers, so the cost depends on the squares with few numbers
+ * left rather than on the number of all the sets of unsolved squares.
+ */
+template <typename Squares>
+inline void SolveNakedGroups(const Squares &squares, unsigned size) {
     const unsigned num_elem = static_cast<unsigned>(squares.size());
-    for (auto iter : BitSetSets(num_elem, size)) {
+    BitSet unsolved = BitSet::Empty(num_elem);
+    for (unsigned i = 0; i < num_elem; i++) {
+        if (size == 1 || squares[i]->CountSet() > 1)
+            unsolved += i + 1;
+    }
+    if (size > 1 && unsolved.CountSet() <= size)
+        return;
+    auto square = [&squares](unsigned i) -> BitSet { return *squares[i-1]; };
+    detail::SearchGroups(unsolved, square, size, [&](BitSet iter) {
         BitSet u = Union(squares, iter);
         if (u.CountSet() == size) {
-            for (BitSet* s : squares) {
+            for (auto s : squares) {
                 if (s->HasAdditionalBits(u)) {
                     (*s) -= u;
                 }
             }
         }
-    }
+    });
 }
 
-inline void SolveHiddenGroups(const std::vector<BitSet*> &squares, unsigned size) {
+/*! Positions of the numbers inside of a range of squares, computed on access.
+ *
+ * Indexed by number-1, the same interface as BlockPositions.
+ */
+template <typename Squares>
+class SquarePositions {
+public:
+    explicit SquarePositions(const Squares &squares) noexcept : squares_(&squares) {}
+
+    [[nodiscard]] BitSet operator[](size_t index) const { return NumberPositions(*squares_, static_cast<unsigned>(index + 1)); }
+    [[nodiscard]] size_t size() const noexcept { return squares_->size(); }
+
+private:
+    const Squares *squares_;
+};
+
+/*! Positions of a number inside of a list of blocks, computed on access.
+ *
+ * Indexed by the position of the block in the list, the same interface as
+ * PositionIndex::Positions().
+ */
+template <typename Grid>
+class BlocksPositions {
+public:
+    BlocksPositions(const Grid &grid, const std::vector<const UniqueBlock *> &blocks, unsigned number) noexcept
+        : grid_(&grid), blocks_(&blocks), number_(number) {}
+
+    [[nodiscard]] BitSet operator[](size_t index) const { return (*blocks_)[index]->NumberPositions(*grid_, number_); }
+    [[nodiscard]] size_t size() const noexcept { return blocks_->size(); }
+
+private:
+    const Grid *grid_;
+    const std::vector<const UniqueBlock *> *blocks_;
+    unsigned number_;
+};
+
+/*! Solve hidden groups using the positions of the numbers inside of the squares.
+ *
+ * Only the numbers that aren't in any solved square are searched, blocks
+ * with at most size of them are skipped. The groups are built as in
+ * SolveNakedGroups, a branch ends once its numbers have more than size
+ * positions.
+ *
+ * @param squares Squares of the block.
+ * @param positions Positions of each number inside of squares, indexed by number-1.
+ * @param size Size of the groups to look for.
+ */
+template <typename Squares, typename Positions>
+inline void SolveHiddenGroups(const Squares &squares, const Positions &positions, unsigned size) {
     const unsigned num_elem = static_cast<unsigned>(squares.size());
-    for (auto iter : BitSetSets(num_elem, size)) {
-        unsigned count = 0;
-        for (auto &s : squares) {
-            if (s->HasSingletonValue()) {
-              if (s->HasIntersection(iter)) {
-                count = 0;
-                break;
-              }
-              continue;
-            }
-            if (s->HasIntersection(iter))
-                count++;
+    // A group with a number of a solved square is never valid, so only the
+    // unresolved numbers are searched.
+    BitSet unresolved = BitSet::SudokuSquare(num_elem);
+    for (unsigned i = 0; i < num_elem; i++) {
+        if (squares[i]->CountSet() == 1)
+            unresolved -= *squares[i];
+    }
+    if (unresolved.CountSet() <= size)
+        return;
+    auto number_positions = [&positions](unsigned number) -> BitSet { return positions[number-1]; };
+    detail::SearchGroups(unresolved, number_positions, size, [&](BitSet iter) {
+        BitSet found = BitSet::Empty(num_elem);
+        for (auto number : BitSetBits(&iter)) {
+            found |= positions[number-1];
         }
-        if (count == size) {
-            for (BitSet* s : squares) {
-                if (s->HasIntersection(iter)) {
-                    (*s) &= iter;
-                }
+        if (found.CountSet() != size)
+            return;
+
+        for (auto i : BitSetBits(&found)) {
+            if (squares[i-1]->HasSingletonValue())
+                return;
+        }
+
+        for (auto i : BitSetBits(&found)) {
+            (*squares[i-1]) &= iter;
+        }
+    });
+}
+
+template <typename Squares>
+inline void SolveHiddenGroups(const Squares &squares, unsigned size) {
+    SolveHiddenGroups(squares, SquarePositions<Squares>(squares), size);
+}
+
+namespace detail {
+// Extend the base blocks by the candidate blocks in increasing order, the
+// cover never grows beyond size blocks.
+template <typename Grid, typename Positions>
+void SearchFish(const Grid &grid, const Positions &positions, const std::vector<const UniqueBlock *> &orthogonal,
+                unsigned size, unsigned number, BitSet candidates, BitSet base, BitSet cover, unsigned depth) {
+    if (depth == size) {
+        if (cover.CountSet() == size) {
+            for (auto bit : BitSetBits(&cover)) {
+                orthogonal[bit-1]->Prune(grid, number, base);
             }
         }
+        return;
+    }
+    while (candidates.CountSet() >= size - depth) {
+        unsigned line = candidates.SingletonValue();
+        candidates -= line;
+        BitSet merged = cover | positions[line-1];
+        if (merged.CountSet() <= size)
+            SearchFish(grid, positions, orthogonal, size, number, candidates, base + line, merged, depth + 1);
     }
 }
+} // namespace detail
 
-inline void SolveFish(const std::vector<UniqueBlock *> &blocks, const std::vector<UniqueBlock*> &orthogonal, unsigned size, unsigned number) {
-    const unsigned num_elem = static_cast<unsigned>(blocks.size());
-    for (auto iter : BitSetSets(num_elem, size)) {
-      bool valid = true;
-      BitSet set = BitSet::Empty(num_elem);
-      for (auto bit : BitSetBits(&iter)) {
-        BitSet x = blocks[bit-1]->NumberPositions(number);
-        if (x.CountSet() < 2) {
-          valid = false;
-          break;
-        }
-        set |= x;
-      }
+/*! Solve fish using the positions of the number inside of the base blocks.
+ *
+ * The positions of the number form a bit matrix of base x cover blocks. Only
+ * the base blocks with 2 to size positions can be part of a fish, the others
+ * are discarded before the search. The base blocks are then combined in
+ * increasing order and a branch is abandoned as soon as the positions cover
+ * more than size blocks.
+ *
+ * @param grid Grid to prune.
+ * @param positions Positions of the number inside of each base block.
+ * @param orthogonal Cover blocks, indexed by the positions.
+ */
+template <typename Grid, typename Positions>
+inline void SolveFish(const Grid &grid, const Positions &positions, const std::vector<const UniqueBlock *> &orthogonal, unsigned size, unsigned number) {
+    const unsigned num_elem = static_cast<unsigned>(positions.size());
+    if (size == 0)
+        return;
+    BitSet candidates = BitSet::Empty(num_elem);
+    for (unsigned i = 0; i < num_elem; i++) {
+        unsigned count = positions[i].CountSet();
+        if (count >= 2 && count <= size)
+            candidates += i + 1;
+    }
+    detail::SearchFish(grid, positions, orthogonal, size, number, candidates, BitSet::Empty(num_elem),
+                       BitSet::Empty(num_elem), 0);
+}
 
-      if (!valid || set.CountSet() != size)
-        continue;
+template <typename Grid>
+inline void SolveFish(const Grid &grid, const std::vector<const UniqueBlock *> &blocks, const std::vector<const UniqueBlock *> &orthogonal, unsigned size, unsigned number) {
+    SolveFish(grid, BlocksPositions<Grid>(grid, blocks, number), orthogonal, size, number);
+}
 
-      for (auto bit : BitSetBits(&set)) {
-        orthogonal[bit-1]->Prune(number, iter);
-      }
+/*! Return the largest fish size worth searching for in both directions.
+ *
+ * Restricted to the rows and columns with at least two positions of the
+ * number, a fish of size k with base rows R and cover columns C makes the
+ * same eliminations as the fish of size m-k with the remaining columns as the
+ * base and the remaining rows as the cover, where m is the number of such
+ * rows. Searching both directions up to m/2 therefore finds every fish.
+ *
+ * The duality requires that the remaining positions stay inside of the
+ * remaining lines, which holds once the singles are propagated. Otherwise
+ * the number of lines is returned and nothing is skipped.
+ *
+ * @param rows Positions of the number inside of the rows.
+ * @param cols Positions of the number inside of the columns.
+ */
+template <typename Positions>
+inline unsigned MaxFishSize(const Positions &rows, const Positions &cols) {
+    const unsigned num_elem = static_cast<unsigned>(rows.size());
+    BitSet open_rows = BitSet::Empty(num_elem);
+    BitSet open_cols = BitSet::Empty(num_elem);
+    BitSet row_cover = BitSet::Empty(num_elem);
+    BitSet col_cover = BitSet::Empty(num_elem);
+    for (unsigned i = 0; i < num_elem; i++) {
+        if (rows[i].CountSet() >= 2) {
+            open_rows += i + 1;
+            row_cover |= rows[i];
+        }
+        if (cols[i].CountSet() >= 2) {
+            open_cols += i + 1;
+            col_cover |= cols[i];
+        }
     }
+    if (row_cover != open_cols || col_cover != open_rows || open_rows.CountSet() != open_cols.CountSet())
+        return num_elem;
+    return open_rows.CountSet() / 2;
 }
 
-inline void SolveFinnedFish(const std::vector<UniqueBlock *> &blocks, 
+namespace detail {
+// Choose the base blocks from the largest one down, which visits the sets of
+// blocks in the same order as BitSetSets, and abandon a branch as soon as the
+// positions cover more than size+1 blocks. The positions are read when a
+// block is chosen, since the prunes of the earlier fish can remove some.
+template <typename Positions, typename Found>
+void SearchFinnedFish(const Positions &positions, unsigned size, unsigned below, BitSet base, BitSet cover,
+                      unsigned depth, const Found &found) {
+    if (depth == size) {
+        if (cover.CountSet() == size + 1)
+            found(base, cover);
+        return;
+    }
+    for (unsigned line = size - depth; line < below; line++) {
+        const BitSet &line_positions = positions[line-1];
+        if (line_positions.CountSet() < 2)
+            continue;
+        BitSet merged = cover | line_positions;
+        if (merged.CountSet() <= size + 1)
+            SearchFinnedFish(positions, size, line, base + line, merged, depth + 1, found);
+    }
+}
+} // namespace detail
+
+/*! Solve finned fish using the positions of the number inside of the base blocks.
+ *
+ * A finned fish is a set of size base blocks, each with at least two
+ * positions of the number, whose positions cover size+1 blocks, one of them
+ * only by a single position, the fin. The sets of base blocks are searched
+ * with the same pruning as SolveFish, so the cost depends on the blocks with
+ * few positions left rather than on the number of all the sets of blocks.
+ *
+ * The prune callback receives the number, the base block and the cover
+ * block of the fin and the sets of base and cover blocks of the fish.
+ */
+template <typename Positions>
+inline void SolveFinnedFish(const Positions &positions,
                             const std::function<void(unsigned, unsigned, unsigned, BitSet, BitSet)> &prune,
                             unsigned size, unsigned number) {
-    const unsigned num_elem = static_cast<unsigned>(blocks.size());
-    for (auto iter : BitSetSets(num_elem, size)) {
-      bool valid = true;
-      BitSet set = BitSet::Empty(num_elem);
-      for (auto bit : BitSetBits(&iter)) {
-        BitSet x = blocks[bit-1]->NumberPositions(number);
-        if (x.CountSet() < 2) {
-          valid = false;
-          break;
-        }
-        set |= x;
-      }
-
-      if (!valid || set.CountSet() != size + 1)
-        continue;
-
+    const unsigned num_elem = static_cast<unsigned>(positions.size());
+    if (size == 0 || size > num_elem)
+        return;
+    detail::SearchFinnedFish(positions, size, num_elem + 1, BitSet::Empty(num_elem), BitSet::Empty(num_elem), 0,
+                             [&](BitSet iter, BitSet set) {
       // We know that we have something like finned fish, we need to check if it actually has a fin.
       unsigned block_id = 0;
       unsigned orthogonal_id = 0;
-      valid = false;
+      bool valid = false;
       for (auto i : BitSetBits(&set)) {
         unsigned count = 0;
         for (auto j : BitSetBits(&iter)) {
-          if (blocks[j-1]->NumberPositions(number).IsBitSet(i)) {
+          if (positions[j-1].IsBitSet(i)) {
             block_id = j;
             count++;
           }
@@ -133,20 +346,27 @@ inline void SolveFinnedFish(const std::vector<UniqueBlock *> &blocks,
       if (valid) {
         prune(number, block_id, orthogonal_id, iter, set);
       }
-    }
+    });
+}
+
+inline void SolveFinnedFish(const BitSet *grid, const std::vector<const UniqueBlock *> &blocks,
+                            const std::function<void(unsigned, unsigned, unsigned, BitSet, BitSet)> &prune,
+                            unsigned size, unsigned number) {
+    SolveFinnedFish(BlocksPositions<const BitSet *>(grid, blocks, number), prune, size, number);
 }
 
-inline void SolveBlockIntersection(const UniqueBlock& forcing_block, UniqueBlock& checked) {
+template <typename Grid>
+inline void SolveBlockIntersection(const Grid &grid, const UniqueBlock& forcing_block, const UniqueBlock& checked) {
   BitSet forced_numbers = BitSet::Empty(forcing_block.Max());
   for (unsigned k = 1; k <= forcing_block.Max(); k++) {
     unsigned count = 0;
-    for (auto i : forcing_block.GetSquares()) {
-      if (i->IsBitSet(k))
+    for (auto i : forcing_block.Cells()) {
+      if (grid[i].IsBitSet(k))
         count++;
 
-      for (auto j : checked.GetSquares()) {
+      for (auto j : checked.Cells()) {
         if (i != j) continue;
-        if (i->IsBitSet(k))
+        if (grid[i].IsBitSet(k))
           count--;
       }
     }
@@ -155,19 +375,18 @@ inline void SolveBlockIntersection(const UniqueBlock& forcing_block, UniqueBlock
     }
   }
 
-  for (auto j : checked.GetSquares()) {
+  for (auto j : checked.Cells()) {
     bool found = false;
-    for (auto i : forcing_block.GetSquares()) {
+    for (auto i : forcing_block.Cells()) {
       if (i == j)
         found = true;
     }
     if (!found)
-      (*j) -= forced_numbers;
+      grid[j] -= forced_numbers;
   }
 }
 
 
-
 }
 
 #endif // CORE_SUDOKU_ALGORITHMS_H_
\ No newline at end of file
@@ -3,25 +3,75 @@
 #ifndef CORE_UNIQUE_BLOCK_H_
 #define CORE_UNIQUE_BLOCK_H_
 
+#include <cstddef>
+#include <iterator>
+#include <utility>
 #include <vector>
 #include "BitSet.h"
 
 namespace sudoku {
 
+/*! View of the squares of a block inside of a grid.
+ *
+ * Behaves like a random access range of pointers to the squares, so that the
+ * algorithms can work with both the blocks of a puzzle and plain vectors of
+ * pointers. The grid is anything that behaves like a pointer to the first
+ * square (BitSet*, const BitSet* or TrackedGrid).
+ */
+template <typename Grid>
+class BlockSquares {
+public:
+    using Square = decltype(std::declval<const Grid&>() + 0u);
+
+    struct Iterator {
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Square;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Square;
+
+        [[nodiscard]] Square operator*() const noexcept { return grid_ + *cell_; }
+        Iterator& operator++() noexcept { ++cell_; return *this; }
+        Iterator operator++(int) noexcept { Iterator result(*this); ++cell_; return result; }
+        [[nodiscard]] bool operator==(const Iterator& rhs) const noexcept { return cell_ == rhs.cell_; }
+
+        Grid grid_;
+        const unsigned* cell_;
+    };
+
+    BlockSquares(Grid grid, const std::vector<unsigned>& cells) noexcept : grid_(grid), cells_(&cells) {}
+
+    [[nodiscard]] Square operator[](size_t index) const noexcept { return grid_ + (*cells_)[index]; }
+    [[nodiscard]] size_t size() const noexcept { return cells_->size(); }
+    [[nodiscard]] Iterator begin() const noexcept { return Iterator{grid_, cells_->data()}; }
+    [[nodiscard]] Iterator end() const noexcept { return Iterator{grid_, cells_->data() + cells_->size()}; }
+
+private:
+    Grid grid_;
+    const std::vector<unsigned>* cells_;
+};
+
+/*! Block of squares that have to contain unique numbers (row, column, ...).
+ *
+ * The squares are stored as offsets into a contiguous grid, which keeps the
+ * block independent of where the grid lives in memory. The grid arguments
+ * accept anything that can be indexed like a BitSet pointer.
+ */
 class UniqueBlock {
 public:
-    UniqueBlock(std::vector<BitSet*> elem, unsigned max) : elem_(std::move(elem)), max_(max) {}
+    UniqueBlock(std::vector<unsigned> cells, unsigned max) : cells_(std::move(cells)), max_(max) {}
 
     //! Return whether this block should contain all the numbers in the range.
-    [[nodiscard]] bool IsCompleteBlock() const noexcept { 
-        return max_ == elem_.size(); 
+    [[nodiscard]] bool IsCompleteBlock() const noexcept {
+        return max_ == cells_.size();
     }
 
     //! Return a bitset representing the positions of a number inside of this block.
-    [[nodiscard]] BitSet NumberPositions(unsigned number) const noexcept {
+    template <typename Grid>
+    [[nodiscard]] BitSet NumberPositions(const Grid& grid, unsigned number) const noexcept {
         BitSet result = BitSet::Empty(max_);
-        for (unsigned i = 0; i < elem_.size(); i++) {
-            if (elem_[i]->IsBitSet(number)) {
+        for (unsigned i = 0; i < cells_.size(); i++) {
+            if (grid[cells_[i]].IsBitSet(number)) {
                 result += (i+1);
             }
         }
@@ -29,20 +79,22 @@ public:
     }
 
     //! Remove the specified number from all squares in the block, except for the ones specified in the skip mask.
-    void Prune(unsigned number, BitSet skip) noexcept {
-        for (unsigned i = 0; i < elem_.size(); i++) {
+    template <typename Grid>
+    void Prune(const Grid& grid, unsigned number, BitSet skip) const noexcept {
+        for (unsigned i = 0; i < cells_.size(); i++) {
             if (skip.IsBitSet(i+1))
                 continue;
-            (*elem_[i]) -= number;
+            grid[cells_[i]] -= number;
         }
     }
 
     //! Determine whether there is a number conflict in this block.
-    [[nodiscard]] bool HasConflict() const noexcept {
+    template <typename Grid>
+    [[nodiscard]] bool HasConflict(const Grid& grid) const noexcept {
         for (unsigned i = 1; i <= Max(); i++) {
             bool found = false;
-            for (auto &e : elem_) {
-                if (e->HasSingletonValue() && e->SingletonValue() == i) {
+            for (auto cell : cells_) {
+                if (grid[cell].HasSingletonValue() && grid[cell].SingletonValue() == i) {
                     if (found)
                         return true;
                     else
@@ -53,14 +105,20 @@ public:
         return false;
     }
 
-    //! Return the squares contained within this block.
-    [[nodiscard]] const std::vector<BitSet*>& GetSquares() const noexcept {
-        return elem_;
+    //! Return the offsets of the squares contained within this block.
+    [[nodiscard]] const std::vector<unsigned>& Cells() const noexcept {
+        return cells_;
+    }
+
+    //! Return the squares contained within this block inside of the given grid.
+    template <typename Grid>
+    [[nodiscard]] BlockSquares<Grid> GetSquares(Grid grid) const noexcept {
+        return BlockSquares<Grid>(grid, cells_);
     }
 
     //! Return the number of elements in this block
     [[nodiscard]] unsigned Size() const noexcept {
-        return static_cast<unsigned>(elem_.size());
+        return static_cast<unsigned>(cells_.size());
     }
 
     //! Return the maximum of the number range for this block.
@@ -69,13 +127,10 @@ public:
     }
 
 private:
-    std::vector<BitSet*> elem_;
+    std::vector<unsigned> cells_;
     unsigned max_;
-
-    // Test friends.
-    friend std::vector<::sudoku::BitSet *> &TestGetBlockData(UniqueBlock &s);
 };
 
 }
 
-#endif // CORE_UNIQUE_BLOCK_H_
\ No newline at end of file
+#endif // CORE_UNIQUE_BLOCK_H_
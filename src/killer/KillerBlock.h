@@ -3,6 +3,8 @@
 #ifndef SUDOKU_KILLERBLOCK_H
 #define SUDOKU_KILLERBLOCK_H
 
+#include <bit>
+#include <cstdint>
 #include <vector>
 #include "../core/BitSet.h"
 #include "../core/UniqueBlock.h"
@@ -13,10 +15,15 @@ namespace sudoku {
 
 class KillerBlock {
 public:
-    KillerBlock(std::vector<BitSet *> elem, unsigned max, unsigned sum) :
-        block_(elem, max),
-        possible_sets_(getNumberOfSets(max, static_cast<unsigned>(elem.size()), sum), true),
-        sum_(sum) {}
+    KillerBlock(std::vector<unsigned> cells, unsigned max, unsigned sum) :
+        sets_(&GetSumSets(max, static_cast<unsigned>(cells.size()), sum)),
+        possible_sets_(sets_->words, ~uint64_t{0}),
+        union_(sets_->all),
+        block_(std::move(cells), max),
+        sum_(sum) {
+        if (sets_->sets.size() % 64 != 0)
+            possible_sets_.back() = (UINT64_C(1) << (sets_->sets.size() % 64)) - 1;
+    }
 
     //! Return whether this block should contain all the numbers in the range.
     [[nodiscard]] bool IsCompleteBlock() const noexcept {
@@ -24,23 +31,23 @@ public:
     }
 
     //! Return a bitset representing the positions of a number inside of this block.
-    [[nodiscard]] BitSet NumberPositions(unsigned number) const noexcept {
-        return block_.NumberPositions(number);
+    [[nodiscard]] BitSet NumberPositions(const BitSet *grid, unsigned number) const noexcept {
+        return block_.NumberPositions(grid, number);
     }
 
     //! Remove the specified number from all squares in the block, except for the ones specified in the skip mask.
-    void Prune(unsigned number, BitSet skip) noexcept {
-        block_.Prune(number, skip);
+    void Prune(BitSet *grid, unsigned number, BitSet skip) const noexcept {
+        block_.Prune(grid, number, skip);
     }
 
     //! Determine whether there is a number conflict in this block.
-    [[nodiscard]] bool HasConflict() const noexcept {
-        return block_.HasConflict();
+    [[nodiscard]] bool HasConflict(const BitSet *grid) const noexcept {
+        return block_.HasConflict(grid);
     }
 
-    //! Return the squares contained within this block.
-    [[nodiscard]] const std::vector<BitSet *> &GetSquares() const noexcept {
-        return block_.GetSquares();
+    //! Return the offsets of the squares contained within this block.
+    [[nodiscard]] const std::vector<unsigned> &Cells() const noexcept {
+        return block_.Cells();
     }
 
     //! Return the number of elements in this block
@@ -58,47 +65,96 @@ public:
         return sum_;
     }
 
-    //! Return the union of all the still possible sets for this killer block.
-    [[nodiscard]] BitSet UnionSumSet() const noexcept {
-        BitSet result;
-        for (unsigned i = 0; i < possible_sets_.size(); i++) {
-            if (possible_sets_[i])
-                result |= getSet(block_.Max(), block_.Size(), sum_, i);
+    //! Return the number of the sets of the sum that are still possible.
+    [[nodiscard]] unsigned CountPossibleSets() const noexcept {
+        unsigned result = 0;
+        for (auto word : possible_sets_) {
+            result += static_cast<unsigned>(std::popcount(word));
         }
         return result;
     }
 
+    //! Return whether the set with the index in the table of the sums (see GetSumSets) is still possible.
+    [[nodiscard]] bool IsPossibleSet(unsigned index) const noexcept {
+        return (possible_sets_[index / 64] >> (index % 64)) & 1u;
+    }
+
+    /*! Return the union of all the still possible sets for this killer block.
+     *
+     * Starts as the union of the table entry and is kept up to date by the
+     * pruning, so it is never computed from the sets.
+     */
+    [[nodiscard]] BitSet UnionSumSet() const noexcept {
+        return union_;
+    }
+
     //! Remove sums that not possible given the state of the squares contained within the block.
-    void PruneSumSetsBySquare() noexcept {
-        for (auto &s : block_.GetSquares()) {
-            for (unsigned i = 0; i < possible_sets_.size(); i++) {
-                if (possible_sets_[i] && (getSet(block_.Max(), block_.Size(), sum_, i) & (*s)).CountSet() == 0) {
-                    possible_sets_[i] = false;
+    void PruneSumSetsBySquare(const BitSet *grid) noexcept {
+        if (!sets_->complete)
+            return;
+        bool pruned = false;
+        for (auto cell : block_.Cells()) {
+            // Every possible set has a number of the square.
+            BitSet square = grid[cell] & union_;
+            if (square == union_)
+                continue;
+            for (unsigned word = 0; word < sets_->words; word++) {
+                uint64_t intersecting = 0;
+                for (auto number : BitSetBits(&square)) {
+                    intersecting |= sets_->Containing(number)[word];
                 }
+                possible_sets_[word] &= intersecting;
             }
+            pruned = true;
         }
+        if (pruned)
+            UpdateUnion();
     }
 
     //! Remove sums that not possible given the state of the squares contained within the block.
-    void PruneSumSets() noexcept {
+    void PruneSumSets(const BitSet *grid) noexcept {
+        if (!sets_->complete)
+            return;
         BitSet set = BitSet::Empty(Max());
-        for (auto &s : block_.GetSquares()) {
-            set |= *s;
+        for (auto cell : block_.Cells()) {
+            set |= grid[cell];
         }
-        for (unsigned i = 0; i < possible_sets_.size(); i++) {
-            if (possible_sets_[i] &&
-                getSet(block_.Max(), block_.Size(), sum_, i).HasAdditionalBits(set)) {
-              possible_sets_[i] = false;
+        // Only the numbers of the possible sets can remove any.
+        BitSet missing = union_ - set;
+        if (missing.CountSet() == 0)
+            return;
+        for (auto number : BitSetBits(&missing)) {
+            auto containing = sets_->Containing(number);
+            for (unsigned word = 0; word < sets_->words; word++) {
+                possible_sets_[word] &= ~containing[word];
             }
         }
+        UpdateUnion();
     }
 
 private:
+    //! Keep only the numbers of the union that are in a possible set.
+    void UpdateUnion() noexcept {
+        BitSet remaining = BitSet::Empty(Max());
+        for (auto number : BitSetBits(&union_)) {
+            auto containing = sets_->Containing(number);
+            for (unsigned word = 0; word < sets_->words; word++) {
+                if ((possible_sets_[word] & containing[word]) != 0) {
+                    remaining += number;
+                    break;
+                }
+            }
+        }
+        union_ = remaining;
+    }
+
+    // Entry of the sum tables for the size and sum of this block.
+    const SumSets *sets_;
+    // Sets of the entry that are still possible, bit i for the set i.
+    std::vector<uint64_t> possible_sets_;
+    BitSet union_;
     UniqueBlock block_;
-    std::vector<bool> possible_sets_;
     unsigned sum_;
-
-    friend std::vector<bool> &TestGetPossibleSets(KillerBlock &s);
 };
 
 }
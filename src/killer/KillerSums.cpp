@@ -0,0 +1,93 @@
+// (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com)
+
+#include "KillerSums.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace sudoku {
+
+namespace {
+
+// An entry of the runtime tables, owns the sets it lists.
+struct OwnedSumSets {
+    std::vector<BitSet> storage;
+    std::vector<uint64_t> containing;
+    SumSets entry;
+};
+
+// Smallest and largest sum of count distinct numbers below the limit.
+unsigned MinSum(unsigned count) { return count * (count + 1) / 2; }
+unsigned MaxSum(unsigned count, unsigned below) { return count * (2 * below - 1 - count) / 2; }
+
+// Choose the largest number of the set first, from the smallest one up, which
+// lists the sets in the same order as BitSetSets. Only the numbers that can
+// still reach the sum with the rest of the set are tried, so the cost depends
+// on the sets found rather than on all the sets of the size. Return false once
+// there are too many sets.
+bool CollectSets(unsigned count, unsigned below, unsigned sum, BitSet prefix, std::vector<BitSet> &sets) {
+    if (count == 0) {
+        if (sum != 0)
+            return true;
+        if (sets.size() == MAX_LISTED_SUM_SETS)
+            return false;
+        sets.push_back(prefix);
+        return true;
+    }
+    for (unsigned number = count; number < below && number <= sum; number++) {
+        unsigned rest = sum - number;
+        if (rest < MinSum(count - 1))
+            break;
+        if (rest > MaxSum(count - 1, number))
+            continue;
+        if (!CollectSets(count - 1, number, rest, prefix + number, sets))
+            return false;
+    }
+    return true;
+}
+
+std::unique_ptr<OwnedSumSets> BuildSumSets(unsigned max, unsigned num_squares, unsigned sum) {
+    auto result = std::make_unique<OwnedSumSets>();
+    SumSets &entry = result->entry;
+    if (max == 9 && num_squares >= 2 && num_squares <= 9 && sum >= 3 && sum <= std::min(45u, 9 * num_squares)) {
+        auto [offset, length] = SumGrid<9>::offsets[num_squares - 2][sum - 3];
+        entry.sets = std::span<const BitSet>(SumGrid<9>::sets).subspan(offset, length);
+    } else if (CollectSets(num_squares, max + 1, sum, BitSet::Empty(max), result->storage)) {
+        entry.sets = result->storage;
+    } else {
+        result->storage = {};
+        entry.all = BitSet::SudokuSquare(max);
+        entry.complete = false;
+        return result;
+    }
+    entry.all = BitSet::Empty(max);
+    entry.words = static_cast<unsigned>((entry.sets.size() + 63) / 64);
+    result->containing.resize(size_t{max} * entry.words);
+    for (size_t i = 0; i < entry.sets.size(); i++) {
+        entry.all |= entry.sets[i];
+        for (auto number : BitSetBits(&entry.sets[i])) {
+            result->containing[(number - 1) * entry.words + i / 64] |= UINT64_C(1) << (i % 64);
+        }
+    }
+    entry.containing = result->containing;
+    return result;
+}
+
+} // namespace
+
+const SumSets &GetSumSets(unsigned max, unsigned num_squares, unsigned sum) {
+    static std::mutex lock;
+    static std::map<std::tuple<unsigned, unsigned, unsigned>, std::unique_ptr<OwnedSumSets>> cache;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto &entry = cache[{max, num_squares, sum}];
+    if (!entry)
+        entry = BuildSumSets(max, num_squares, sum);
+    return entry->entry;
+}
+
+}
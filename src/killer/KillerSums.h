@@ -4,6 +4,9 @@
 #define SUDOKU_KILLERSUMS_H
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include "../core/BitSet.h"
 
 namespace {
@@ -78,19 +81,46 @@ struct SumGrid {
     static constexpr std::array<sudoku::BitSet,total_number_of_sets(Max)> sets = generate_sets<Max>();
 };
 
-constexpr unsigned getNumberOfSets(unsigned max, unsigned num_squares, unsigned sum) {
-    if (max == 9) {
-        return SumGrid<9>::offsets[num_squares-2][sum-3].second;
+//! Entries with more sets than this are not listed, see SumSets::complete.
+constexpr size_t MAX_LISTED_SUM_SETS = size_t{1} << 20;
+
+//! The sets of distinct numbers that fill a cage, for one size and sum.
+struct SumSets {
+    //! The sets, in the same order as BitSetSets.
+    std::span<const BitSet> sets;
+    //! Union of all the sets.
+    BitSet all;
+    /*! False if there are more than MAX_LISTED_SUM_SETS sets, sets is then
+     * empty and all contains every number, so the cage doesn't restrict its
+     * squares.
+     */
+    bool complete = true;
+    //! Number of 64 bit words in a mask over the sets, bit i is the set i.
+    unsigned words = 0;
+    //! Masks of the sets containing each number, words per number, number-1 indexed.
+    std::span<const uint64_t> containing;
+
+    //! Return the mask of the sets containing the number.
+    [[nodiscard]] std::span<const uint64_t> Containing(unsigned number) const noexcept {
+        return containing.subspan((number - 1) * words, words);
     }
-    return 0;
+};
+
+/*! Return the sets of num_squares distinct numbers from 1 to max with the sum.
+ *
+ * Puzzles up to 9x9 read the tables generated at compile time, the tables of
+ * the other sizes are too large to generate up front, each entry is built on
+ * first use and cached for the lifetime of the program. Safe to call from
+ * multiple threads, the returned entry is never modified or freed.
+ */
+const SumSets &GetSumSets(unsigned max, unsigned num_squares, unsigned sum);
+
+inline unsigned getNumberOfSets(unsigned max, unsigned num_squares, unsigned sum) {
+    return static_cast<unsigned>(GetSumSets(max, num_squares, sum).sets.size());
 }
 
-constexpr BitSet getSet(unsigned max, unsigned num_squares, unsigned sum, unsigned offset) {
-   if (max == 9) {
-       unsigned base_offset = SumGrid<9>::offsets[num_squares-2][sum-3].first;
-       return SumGrid<9>::sets[base_offset + offset];
-   }
-   return BitSet::Empty(max);
+inline BitSet getSet(unsigned max, unsigned num_squares, unsigned sum, unsigned offset) {
+    return GetSumSets(max, num_squares, sum).sets[offset];
 }
 
 }
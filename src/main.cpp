@@ -3,20 +3,30 @@
  * Human-like Sudoku solver.
  *
  * This solver employs human solving techniques to solve Sudoku puzzles and
- * does not employ any backtracking or any other form of guessing.
+ * does not employ any backtracking or any other form of guessing, unless
+ * asked to complete the puzzles it can't solve (-b).
  */
 
+#include "BatchSolver.h"
+#include "Corpus.h"
+#include "Generator.h"
+#include "Pipeline.h"
 #include "SolveStats.h"
 #include "Sudoku.h"
 
 #include "Progressbar.h"
 #include "SmartSolver.h"
+#include <array>
 #include <chrono>
 #include <ctime>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 #include <chrono>
 #include <thread>
@@ -27,11 +37,6 @@
 // - can generate from a template
 // - support all the variants of Sudoku
 
-std::ifstream &seekLines(int64_t offset, std::ifstream &f);
-void SolveOneSudoku(std::ifstream &f, int64_t line_number,
-                    SolveStats &global_stats, uint64_t &solved,
-                    uint64_t &incorrect);
-
 // Version 7 is done
 // - we can solve easy sudokus
 // - implemented inside block set finding
@@ -46,211 +51,497 @@ void SolveOneSudoku(std::ifstream &f, int64_t line_number,
 //   solving (this would help testing)
 // - cleanup interface on BlockChecker & Sudoku
 
-int run_benchmark(std::ifstream& f, int64_t count) {
+// Number of puzzles handed to the solver at once.
+constexpr int64_t BATCH_SIZE = 16384;
+
+// Solve count records of the corpus starting at offset, count < 0 means until
+// the end of the corpus. Works for both Corpus and BinaryCorpus.
+template <typename Records>
+int run_benchmark(const Records &corpus, int64_t offset, int64_t count,
+                  const BatchSolver &solver, bool json) {
+  const int64_t size = static_cast<int64_t>(corpus.Size());
+  if (offset < 0 || offset > size) {
+    std::cerr << "Unable to seek to the desired line." << std::endl;
+    return 1;
+  }
+  const int64_t end = count < 0 ? size : std::min(size, offset + count);
+
   SolveStats global_stats;
   uint64_t solved = 0;
   uint64_t incorrect = 0;
-
-  {
-    Progressbar x(static_cast<int>(count), std::cout, 79u);
-    for (int64_t i = 0; i < count; i++) {
-      SolveOneSudoku(f, i, global_stats, solved, incorrect);
-      x.Step(1);
+  uint64_t searched = 0;
+
+  std::vector<BatchPuzzle> batch;
+  auto run_batch = [&](int64_t first, int64_t last) {
+    batch.clear();
+    for (int64_t i = first; i < last; i++) {
+      batch.push_back(corpus.Puzzle(static_cast<size_t>(i)));
+      if (batch.back().solution.empty())
+        std::cerr << "Expected comma after puzzle." << std::endl;
+    }
+    BatchResult result = solver.Solve(batch);
+    for (size_t i = 0; i < result.outcomes.size(); i++) {
+      if (result.outcomes[i] == BatchOutcome::INCORRECT) {
+        std::cerr << "Incorrectly solved puzzle at record "
+                  << first + static_cast<int64_t>(i) << std::endl;
+        std::cerr << batch[i].solution << std::endl;
+      }
+    }
+    global_stats += result.stats;
+    solved += result.solved;
+    incorrect += result.incorrect;
+    searched += result.searched;
+  };
+
+  if (count >= 0) {
+    Progressbar x(static_cast<int>(std::max<int64_t>(end - offset, 1)),
+                  std::cout, 79u);
+    for (int64_t i = offset; i < end; i += BATCH_SIZE) {
+      int64_t last = std::min(end, i + BATCH_SIZE);
+      run_batch(i, last);
+      x.Step(static_cast<int>(last - i));
+    }
+  } else {
+    for (int64_t i = offset; i < end; i += BATCH_SIZE) {
+      int64_t last = std::min(end, i + BATCH_SIZE);
+      run_batch(i, last);
+      std::cout << "At record " << last << std::endl;
     }
   }
 
   std::cout << "Benchmark results: \t"
                "Solved "
-            << solved << " out of " << count
+            << solved << " out of " << end - offset
             << " requested.\n"
                "Out of the solved "
             << incorrect
             << " were determined to be "
                "incorrect\n";
-  std::cout << global_stats;
+  if (solver.Backtracks())
+    std::cout << "Solved by backtracking " << searched << "\n";
+  if (json)
+    std::cout << SolveStatsJson{global_stats} << std::endl;
+  else
+    std::cout << global_stats;
 
   return 0;
 }
 
-void SolveOneSudoku(std::ifstream &f, int64_t line_number,
-                    SolveStats &global_stats, uint64_t &solved,
-                    uint64_t &incorrect) {
-  static std::string output;
-  output.reserve(81);
-
-  SolveStats stats;
-  sudoku::Sudoku s(9, BASIC);
-  f >> s;
-  char c;
-  f >> c;
-
-  if (c != ',')
-    std::cerr << "Expected comma after puzzle." << std::endl;
-  f >> output;
-
-  if (SmartSolver::Solve(s, stats)) {
-    solved++;
-    global_stats += stats;
-    unsigned pos = 0;
-    bool correct = true;
-    for (unsigned x = 0; x < s.Size(); x++) {
-      for (unsigned y = 0; y < s.Size(); y++) {
-        if (static_cast<unsigned>(output[pos] - '0') != s[x][y].SingletonValue())
-          correct = false;
-        pos++;
-      }
+int run_benchmark(const char *filename, int64_t offset, int64_t count,
+                  const BatchSolver &solver, Corpus::IndexMode mode, bool json) {
+  if (BinaryCorpus::IsBinary(filename)) {
+    BinaryCorpus corpus(filename);
+    if (!corpus.IsOpen()) {
+      std::cerr << "Corrupted binary corpus " << filename << std::endl;
+      return 1;
     }
+    return run_benchmark(corpus, offset, count, solver, json);
+  }
 
-    if (!correct) {
-      incorrect++;
-      std::cerr << "Incorrectly solved puzzle at line " << line_number + 1
-                << std::endl;
-      std::cerr << output << std::endl;
-    }
-  }/* else {
-    std::cerr << std::endl;
-    std::cerr << "Unsolved puzzle at line " << line_number << std::endl;
-    std::cerr << output << std::endl;
-  }*/
-  output.clear();
+  Corpus corpus(filename, mode);
+  if (!corpus.IsOpen()) {
+    std::cerr << "Failed to open file " << filename << std::endl;
+    return 1;
+  }
+
+  return run_benchmark(corpus, offset, count, solver, json);
 }
-/*
-void SolveOneSudokuWithoutSolution(std::ifstream &f, int64_t line_number,
-                    SolveStats &global_stats, uint64_t &solved,
-                    uint64_t &incorrect) {
-  SolveStats stats;
-  sudoku::Sudoku s(9, BASIC);
-  f >> s;
-
-  if (SmartSolver::Solve(s, stats)) {
-    solved++;
-    global_stats += stats;
+
+int run_benchmark(const char *filename, const char *offset,
+                  const char *puzzle_count, const BatchSolver &solver,
+                  Corpus::IndexMode mode, bool json) {
+  char *end = nullptr;
+  int64_t off = strtoll(offset, &end, 10);
+  if (end == nullptr || *end != '\0') {
+    std::cerr << "Unable to interpret offset as number." << std::endl;
+    return 1;
+  }
+  end = nullptr;
+  int64_t cnt = strtoll(puzzle_count, &end, 10);
+  if (end == nullptr || *end != '\0') {
+    std::cerr << "Unable to interpret puzzle count as number." << std::endl;
+    return 1;
   }
+
+  return run_benchmark(filename, off, cnt, solver, mode, json);
 }
-*/
-std::ifstream &seekLines(int64_t offset, std::ifstream &f) {
-  std::string line;
-  line.reserve(256);
-  for (int64_t i = 0; i < offset; i++) {
-    if (std::getline(f, line).bad())
+
+// Rate the puzzles of the records read from the input, writing a rating
+// record per puzzle to the standard output, in input order. Only a batch of
+// records is kept in memory at once, so the input can be of any size.
+int run_rating(std::istream &input, const BatchSolver &solver, bool json) {
+  std::vector<std::string> lines(BATCH_SIZE);
+  std::vector<BatchPuzzle> batch;
+  batch.reserve(BATCH_SIZE);
+  std::vector<PuzzleRating> ratings(BATCH_SIZE);
+  auto start = std::chrono::steady_clock::now();
+
+  if (!json)
+    std::cout << "id,solved,hardest,steps,tiers\n";
+  uint64_t id = 0;
+  uint64_t solved = 0;
+  bool first = true;
+  for (;;) {
+    size_t count = Corpus::ReadRecords(input, lines, first);
+    if (count == 0)
       break;
-  }
 
-  if (f.bad()) {
-    std::cerr << "Unable to seek to the desired line." << std::endl;
+    batch.clear();
+    for (size_t i = 0; i < count; i++) {
+      batch.push_back(Corpus::SplitRecord(lines[i]));
+    }
+    solver.Rate(batch, ratings);
+    for (size_t i = 0; i < count; i++) {
+      if (json)
+        std::cout << RatingRecordJson{id, ratings[i]} << '\n';
+      else
+        std::cout << RatingRecord{id, ratings[i]} << '\n';
+      if (ratings[i].solved)
+        solved++;
+      id++;
+    }
   }
-  return f;
+  std::cout.flush();
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cerr << "Rating results: \tRated " << id << " puzzles in " << seconds
+            << " s, solved " << solved << std::endl;
+  return 0;
 }
 
-int run_benchmark(const char *filename, int64_t offset, int64_t count) {
-  std::ifstream f(filename);
-  if (!f.is_open()) {
+int run_rating(const char *filename, const BatchSolver &solver, bool json) {
+  if (std::string_view(filename) == "-")
+    return run_rating(std::cin, solver, json);
+  std::ifstream input(filename);
+  if (!input) {
     std::cerr << "Failed to open file " << filename << std::endl;
+    return 1;
   }
+  return run_rating(input, solver, json);
+}
 
-  seekLines(offset + 1, f);
-  return run_benchmark(f, count);
+// Solve the records read from the input, writing the state each puzzle ended
+// in to the standard output, in input order, and the totals to the standard
+// error.
+int run_pipeline(std::istream &input, const BatchSolver &solver, bool json) {
+  std::ios::sync_with_stdio(false);
+  SolvePipeline pipeline(solver);
+  PipelineReport report = pipeline.Run(input, std::cout);
+  if (!std::cout) {
+    std::cerr << "Failed to write the solutions." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "Pipeline results: \tSolved " << report.solved << " out of "
+            << report.puzzles << " puzzles in " << report.seconds << " s, "
+            << report.incorrect << " incorrect";
+  if (solver.Backtracks())
+    std::cerr << ", " << report.searched << " by backtracking";
+  std::cerr << "\n";
+  if (json)
+    std::cerr << SolveStatsJson{report.stats} << std::endl;
+  return 0;
 }
 
-int run_benchmark(const char *filename) {
-  std::ifstream f(filename);
-  if (!f.is_open()) {
+int run_pipeline(const char *filename, const BatchSolver &solver, bool json) {
+  if (std::string_view(filename) == "-")
+    return run_pipeline(std::cin, solver, json);
+  std::ifstream input(filename);
+  if (!input) {
     std::cerr << "Failed to open file " << filename << std::endl;
+    return 1;
   }
+  return run_pipeline(input, solver, json);
+}
 
-  SolveStats global_stats;
-  uint64_t solved = 0;
-  uint64_t incorrect = 0;
-
-  seekLines(1, f);
-  int64_t line = 1;
-  while (!f.bad() && !f.eof()) {
-    SolveOneSudoku(f, line, global_stats, solved, incorrect);
-    line++;
-    if (line%1000 == 0) {
-      std::cout << "At line " << line << std::endl;
+// Convert a text corpus into a binary one, or a binary corpus into text.
+// Text records are either "puzzle[,solution]" or the Sudoku::Serialize form,
+// optionally followed by ",solution". Binary corpora are written back in the
+// Serialize form, so that the possibilities and killer blocks are kept.
+int run_conversion(const char *input, const char *output) {
+  uint64_t records = 0;
+  if (BinaryCorpus::IsBinary(input)) {
+    BinaryCorpus corpus(input);
+    if (!corpus.IsOpen()) {
+      std::cerr << "Corrupted binary corpus " << input << std::endl;
+      return 1;
+    }
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    sudoku::Sudoku s;
+    for (size_t i = 0; i < corpus.Size(); i++) {
+      BatchPuzzle puzzle = corpus.Puzzle(i);
+      try {
+        s.DeserializeBinary(puzzle.puzzle);
+      } catch (const std::exception &e) {
+        std::cerr << "Unable to read the puzzle at record " << records << ": "
+                  << e.what() << std::endl;
+        return 1;
+      }
+      out << s.Serialize();
+      if (!puzzle.solution.empty())
+        out << ',' << puzzle.solution;
+      out << '\n';
+      records++;
+    }
+    if (!out) {
+      std::cerr << "Failed to write file " << output << std::endl;
+      return 1;
+    }
+  } else {
+    std::ifstream in(input);
+    if (!in) {
+      std::cerr << "Failed to open file " << input << std::endl;
+      return 1;
+    }
+    BinaryCorpusWriter writer(output);
+    sudoku::Sudoku s;
+    std::string line;
+    bool first = true;
+    while (Corpus::ReadRecords(in, std::span(&line, 1), first) != 0) {
+      BatchPuzzle record = Corpus::SplitRecord(line);
+      if (record.puzzle.find(':') != std::string_view::npos) {
+        try {
+          s.Deserialize(std::string(record.puzzle));
+        } catch (const std::exception &e) {
+          std::cerr << "Unable to read the puzzle at record " << records
+                    << ": " << e.what() << std::endl;
+          return 1;
+        }
+      } else {
+        s = sudoku::Sudoku();
+        if (sudoku::ReadPuzzle(record.puzzle, s) == 0) {
+          std::cerr << "Unable to read the puzzle at record " << records
+                    << std::endl;
+          return 1;
+        }
+      }
+      writer.Add(s, record.solution);
+      records++;
+    }
+    if (!writer.Close()) {
+      std::cerr << "Failed to write file " << output << std::endl;
+      return 1;
     }
   }
-
-  std::cout << "Benchmark results: \t"
-               "Solved "
-            << solved << " out of " << line-1 <<
-            " requested.\n"
-               "Out of the solved "
-            << incorrect
-            << " were determined to be "
-               "incorrect\n";
-  std::cout << global_stats;
-
+  std::cout << "Converted " << records << " records." << std::endl;
   return 0;
 }
-/*
-int run_benchmark_no_solutions(const char *filename) {
-  std::ifstream f(filename);
-  if (!f.is_open()) {
-    std::cerr << "Failed to open file " << filename << std::endl;
-  }
 
-  SolveStats global_stats;
-  uint64_t solved = 0;
-  uint64_t incorrect = 0;
+// Seconds between the throughput reports of the generator.
+constexpr double GENERATE_REPORT_INTERVAL = 5.0;
 
-  int64_t line = 0;
-  while (!f.bad() && !f.eof()) {
-    SolveOneSudokuWithoutSolution(f, line, global_stats, solved, incorrect);
-    line++;
-  }
+// The tier beyond all techniques, the puzzles only backtracking solves.
+constexpr std::string_view BACKTRACKING_TIER = "backtracking";
 
-  std::cout << "Benchmark results: \t"
-               "Solved "
-            << solved << " out of " << line-1 <<
-            " requested.\n"
-            "Out of the solved "
-            << incorrect
-            << " were determined to be "
-               "incorrect\n";
-  std::cout << global_stats;
+bool parse_tier(std::string_view name, Technique &tier) {
+  if (name == BACKTRACKING_TIER) {
+    tier = Technique::COUNT;
+    return true;
+  }
+  return FindTechnique(name, tier);
+}
 
-  return 0;
+std::string_view tier_name(Technique tier) {
+  if (tier == Technique::COUNT)
+    return BACKTRACKING_TIER;
+  return GetTechniqueInfo(tier).name;
 }
-*/
-int run_benchmark(const char *filename, const char *offset,
-                  const char *puzzle_count) {
+
+// Generate count puzzles whose hardest technique is in the band, the
+// puzzles are written to the standard output as "puzzle,solution" records,
+// the throughput to the standard error.
+int run_generator(const char *puzzle_count, const char *easiest,
+                  const char *hardest, unsigned threads, uint64_t seed) {
   char *end = nullptr;
-  int64_t off = strtoll(offset, &end, 10);
+  uint64_t count = strtoull(puzzle_count, &end, 10);
   if (end == nullptr || *end != '\0') {
-    std::cerr << "Unable to interpret offset as number." << std::endl;
+    std::cerr << "Unable to interpret puzzle count as number." << std::endl;
     return 1;
   }
-  end = nullptr;
-  int64_t cnt = strtoll(puzzle_count, &end, 10);
-  if (end == nullptr || *end != '\0') {
-    std::cerr << "Unable to interpret puzzle count as number." << std::endl;
+  // Without techniques any puzzle goes, a single technique is both ends.
+  DifficultyBand band;
+  if (easiest != nullptr) {
+    if (!parse_tier(easiest, band.easiest)) {
+      std::cerr << "Unknown technique " << easiest << std::endl;
+      return 1;
+    }
+    band.hardest = band.easiest;
+  }
+  if (hardest != nullptr && !parse_tier(hardest, band.hardest)) {
+    std::cerr << "Unknown technique " << hardest << std::endl;
+    return 1;
+  }
+  if (band.hardest < band.easiest) {
+    std::cerr << "The hardest technique comes before the easiest one."
+              << std::endl;
     return 1;
   }
 
-  return run_benchmark(filename, off, cnt);
+  Generator generator(threads);
+  std::array<uint64_t, TECHNIQUE_COUNT + 1> tiers{};
+  uint64_t generated = 0;
+  auto start = std::chrono::steady_clock::now();
+  double last_report = 0;
+  auto sink = [&](const GeneratedPuzzle &puzzle) {
+    std::cout << puzzle.puzzle << ',' << puzzle.solution << '\n';
+    tiers[static_cast<unsigned>(puzzle.hardest)]++;
+    generated++;
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    if (elapsed - last_report >= GENERATE_REPORT_INTERVAL) {
+      last_report = elapsed;
+      std::cout.flush();
+      std::cerr << "Generated " << generated << " puzzles, "
+                << static_cast<double>(generated) / elapsed
+                << " puzzles/s" << std::endl;
+    }
+  };
+  GeneratorReport report = generator.Generate(count, band, seed, sink);
+  std::cout.flush();
+
+  double seconds = std::max(report.seconds, 1e-9);
+  std::cerr << "Generator results: \t"
+               "Generated "
+            << report.generated << " out of " << report.candidates
+            << " candidates in " << report.seconds << " s, "
+            << static_cast<double>(report.generated) / seconds
+            << " puzzles/s ("
+            << static_cast<uint64_t>(static_cast<double>(report.generated) /
+                                     seconds * 3600)
+            << " per hour) on " << generator.Threads() << " threads, seed "
+            << seed << "\n";
+  for (unsigned i = 0; i < tiers.size(); i++) {
+    if (tiers[i] != 0)
+      std::cerr << "\t" << tier_name(static_cast<Technique>(i)) << " : "
+                << tiers[i] << "\n";
+  }
+  return 0;
 }
 
 int main(int argc, char *argv[]) {
-  if (argc == 2) {
-    return run_benchmark(argv[1]);
+  // Strip the optional "-j threads", "-s seed", "-i", "-a", "-b" and
+  // "--json" parameters, leaving only positional ones.
+  unsigned threads = 0;
+  uint64_t seed = std::random_device{}();
+  Corpus::IndexMode mode = Corpus::IN_MEMORY;
+  ScheduleMode schedule = ScheduleMode::REFERENCE;
+  bool json = false;
+  bool backtrack = false;
+  std::vector<char *> args;
+  for (int i = 0; i < argc; i++) {
+    std::string_view arg(argv[i]);
+    if (arg == "-i") {
+      mode = Corpus::SIDECAR;
+      continue;
+    }
+    if (arg == "-a") {
+      schedule = ScheduleMode::ADAPTIVE;
+      continue;
+    }
+    if (arg == "-b") {
+      backtrack = true;
+      continue;
+    }
+    if (arg == "--json") {
+      json = true;
+      continue;
+    }
+    if (arg.starts_with("-j")) {
+      const char *value = arg.size() > 2 ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+      char *end = nullptr;
+      threads = static_cast<unsigned>(strtoul(value, &end, 10));
+      if (end == nullptr || *end != '\0' || end == value) {
+        std::cerr << "Unable to interpret thread count as number." << std::endl;
+        return 1;
+      }
+      continue;
+    }
+    if (arg.starts_with("-s")) {
+      const char *value = arg.size() > 2 ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+      char *end = nullptr;
+      seed = strtoull(value, &end, 10);
+      if (end == nullptr || *end != '\0' || end == value) {
+        std::cerr << "Unable to interpret seed as number." << std::endl;
+        return 1;
+      }
+      continue;
+    }
+    args.push_back(argv[i]);
+  }
+
+  BatchSolver solver(threads, 9, BASIC, schedule, backtrack);
+
+  // convert input output
+  if (args.size() == 4 && std::string_view(args[1]) == "convert") {
+    return run_conversion(args[2], args[3]);
   }
 
-//  if (argc == 3) {
-//    return run_benchmark_no_solutions(argv[1]);
-//  }
+  // solve file
+  if (args.size() == 3 && std::string_view(args[1]) == "solve") {
+    return run_pipeline(args[2], solver, json);
+  }
+
+  // rate file
+  if (args.size() == 3 && std::string_view(args[1]) == "rate") {
+    return run_rating(args[2], solver, json);
+  }
+
+  // generate count [easiest [hardest]]
+  if (args.size() >= 3 && args.size() <= 5 &&
+      std::string_view(args[1]) == "generate") {
+    return run_generator(args[2], args.size() > 3 ? args[3] : nullptr,
+                         args.size() > 4 ? args[4] : nullptr, threads, seed);
+  }
+
+  if (args.size() == 2) {
+    return run_benchmark(args[1], 0, -1, solver, mode, json);
+  }
 
   // filename offset count
-  if (argc == 4) {
-    return run_benchmark(argv[1], argv[2], argv[3]);
+  if (args.size() == 4) {
+    return run_benchmark(args[1], args[2], args[3], solver, mode, json);
   }
 
   std::cerr << "Unexpected number of parameters for sudoku.\n"
                "Either call with no parameters, or specify a benchmark file, "
                "offset and number of files to process.\n"
+               "Use -j to set the number of threads (default all cores) and -i\n"
+               "to save the record index next to the file for instant seeking.\n"
+               "Use -a to order the solving techniques by their observed cost\n"
+               "and productivity instead of the fixed reference order, -b to\n"
+               "complete the puzzles the techniques can't solve by backtracking\n"
+               "and --json to print the solver stats, including the time spent\n"
+               "in each technique, as JSON.\n"
+               "The generate mode writes count unique puzzles with their\n"
+               "solutions, keeping only the puzzles whose hardest technique\n"
+               "is between the easiest and hardest given (a single technique\n"
+               "means exactly that one, \"backtracking\" stands for the puzzles\n"
+               "no technique solves). Use -s to set the seed.\n"
+               "The convert mode turns a text corpus into a binary one, which\n"
+               "is solved without parsing, and a binary corpus back into the\n"
+               "text form of Sudoku::Serialize. Binary corpora are recognized\n"
+               "wherever a corpus file is expected.\n"
+               "The solve mode reads puzzles line by line from the file (- for\n"
+               "the standard input) and writes a line per puzzle, its solution\n"
+               "or, if unsolved, the remaining candidates in the Serialize form,\n"
+               "in input order, while the next puzzles are read and solved.\n"
+               "The rate mode writes a record per puzzle of the file (- for the\n"
+               "standard input): id, whether the techniques solved it, the\n"
+               "hardest technique, the number of steps and the hits and time of\n"
+               "each technique, as JSON lines with --json.\n"
                "./sudoku\n"
                "./sudoku file.csv\n"
                "./sudoku file.csv 0 1000\n"
+               "./sudoku -j 4 -i file.csv 5000000 1000\n"
+               "./sudoku -a file.csv\n"
+               "./sudoku -b file.csv\n"
+               "./sudoku convert file.csv file.bin\n"
+               "cat file.csv | ./sudoku -b solve - > solutions.txt\n"
+               "./sudoku rate file.csv > ratings.csv\n"
+               "./sudoku generate 1000 > puzzles.csv\n"
+               "./sudoku -j 8 -s 42 generate 1000 fish_2 fish_2 > puzzles.csv\n"
             << std::endl;
 }
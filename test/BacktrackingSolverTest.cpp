@@ -0,0 +1,245 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "../src/BacktrackingSolver.h"
+#include "../src/SmartSolver.h"
+#include "TestPuzzles.h"
+#include <catch2/catch.hpp>
+#include <random>
+#include <string>
+
+namespace {
+const char *DIAGONAL_SOLUTION_16 =
+    "347A1G26B5CDE89FFC8E3BD46G19A527D5B68EC9FA27341G1G297F5A8E43B6CD6AD1597E24B8CFG3B8576A3FE9GC1D4"
+    "22394C1GDA76F5B8EGECF48B21D356A798DGCF2957BA14E36413BA7ECGF5692D89FE2B618C3D4G7A5A765D34G928EFCB"
+    "1E6F32DA14C7G895B72AG946358FBD1EC5948GCFBD1E2736ACB1DE587369A2GF4";
+
+const char *DIAGONAL_SOLUTION_9 = "639251748458367912172849365967435281824176593315928476796583124541692837283714659";
+
+unsigned Value(char c) { return c < 'A' ? static_cast<unsigned>(c - '0') : static_cast<unsigned>(c - 'A') + 10u; }
+
+// Clear a rectangle of a b / b a spanning two boxes of the solution, the two
+// values can be swapped, so the grid has exactly two solutions.
+std::string TwoSolutions(std::string grid, unsigned &changed_cell) {
+  for (unsigned r1 = 0; r1 < 9; r1++) {
+    for (unsigned r2 = r1 + 1; r2 < 9 && r2 / 3 == r1 / 3; r2++) {
+      for (unsigned c1 = 0; c1 < 9; c1++) {
+        for (unsigned c2 = c1 + 1; c2 < 9; c2++) {
+          if (c1 / 3 == c2 / 3 || grid[r1 * 9 + c1] != grid[r2 * 9 + c2] || grid[r1 * 9 + c2] != grid[r2 * 9 + c1])
+            continue;
+          changed_cell = r1 * 9 + c1;
+          for (unsigned cell : {r1 * 9 + c1, r1 * 9 + c2, r2 * 9 + c1, r2 * 9 + c2}) {
+            grid[cell] = '0';
+          }
+          return grid;
+        }
+      }
+    }
+  }
+  return "";
+}
+
+std::string Values(const sudoku::Sudoku &s) {
+  std::string result;
+  for (unsigned i = 0; i < s.Size() * s.Size(); i++) {
+    unsigned value = s.Data()[i].HasSingletonValue() ? s.Data()[i].SingletonValue() : 0;
+    result += static_cast<char>(value < 10 ? '0' + value : 'A' + value - 10);
+  }
+  return result;
+}
+} // namespace
+
+TEST_CASE("Backtracking : solves a puzzle beyond the techniques", "[backtracking]") {
+  sudoku::Sudoku s;
+  REQUIRE(sudoku::ReadPuzzle(HARD_PUZZLE, s) != 0);
+  SolveStats stats;
+  REQUIRE(!SmartSolver::Solve(s, stats));
+
+  // Continues from where the techniques stopped.
+  BacktrackingSolver solver;
+  REQUIRE(solver.Solve(s));
+  CHECK(Values(s) == HARD_SOLUTION);
+  CHECK(solver.Nodes() > 0);
+}
+
+TEST_CASE("Backtracking : counts solutions", "[backtracking]") {
+  BacktrackingSolver solver;
+
+  sudoku::Sudoku empty;
+  CHECK(solver.CountSolutions(empty, 1000) == 1000);
+  CHECK(solver.CountSolutions(empty, 0) == 0);
+
+  sudoku::Sudoku unique;
+  sudoku::ReadPuzzle(HARD_PUZZLE, unique);
+  CHECK(solver.CountSolutions(unique, 10) == 1);
+
+  unsigned cell = 0;
+  std::string grid = TwoSolutions(HARD_SOLUTION, cell);
+  REQUIRE(!grid.empty());
+  sudoku::Sudoku twice;
+  sudoku::ReadPuzzle(grid, twice);
+  CHECK(solver.CountSolutions(twice, 10) == 2);
+  CHECK(solver.CountSolutions(twice, 1) == 1);
+}
+
+TEST_CASE("Backtracking : no solution", "[backtracking]") {
+  BacktrackingSolver solver;
+  std::string grid = HARD_PUZZLE;
+  // A second 8 in the first row.
+  grid[4] = '8';
+  sudoku::Sudoku s;
+  sudoku::ReadPuzzle(grid, s);
+  std::string before = Values(s);
+  CHECK(solver.CountSolutions(s, 10) == 0);
+  CHECK(!solver.Solve(s));
+  CHECK(Values(s) == before);
+}
+
+TEST_CASE("Backtracking : number without a position", "[backtracking]") {
+  // The box in the bottom left corner has no place left for a 1, which the
+  // search has to notice right away, not once it runs out of squares.
+  sudoku::Sudoku s;
+  sudoku::ReadPuzzle("000007000000000000000000002000000030010000000070000000904000000000000100000100000", s);
+  BacktrackingSolver solver;
+  CHECK(solver.CountSolutions(s, 1) == 0);
+  CHECK(solver.Nodes() <= 1);
+}
+
+TEST_CASE("Backtracking : 16x16 diagonal puzzles", "[backtracking]") {
+  std::mt19937 rng(7);
+  std::bernoulli_distribution keep(0.4);
+  BacktrackingSolver solver(16, DIAGONAL);
+  for (unsigned round = 0; round < 10; round++) {
+    std::string grid = DIAGONAL_SOLUTION_16;
+    for (auto &c : grid) {
+      if (!keep(rng))
+        c = '0';
+    }
+    sudoku::Sudoku s(16, DIAGONAL);
+    REQUIRE(sudoku::ReadPuzzle(grid, s) != 0);
+    REQUIRE(solver.Solve(s));
+    CHECK(s.IsSet());
+    CHECK(!s.HasConflict());
+    std::string solved = Values(s);
+    for (size_t i = 0; i < grid.size(); i++) {
+      if (grid[i] != '0')
+        CHECK(solved[i] == grid[i]);
+    }
+  }
+
+  sudoku::Sudoku basic(16, BASIC);
+  CHECK_THROWS(solver.CountSolutions(basic, 1));
+}
+
+TEST_CASE("Backtracking : killer cages", "[backtracking][killer]") {
+  BacktrackingSolver solver;
+
+  // A cage with a given square of the same row picks one of the two
+  // solutions.
+  unsigned cell = 0;
+  std::string grid = TwoSolutions(HARD_SOLUTION, cell);
+  REQUIRE(!grid.empty());
+  sudoku::Sudoku twice;
+  sudoku::ReadPuzzle(grid, twice);
+  REQUIRE(solver.CountSolutions(twice, 10) == 2);
+  unsigned given = cell / 9 * 9;
+  while (grid[given] == '0')
+    given++;
+  twice.AddKillerBlock({cell, given}, Value(HARD_SOLUTION[cell]) + Value(HARD_SOLUTION[given]));
+  CHECK(solver.CountSolutions(twice, 10) == 1);
+  REQUIRE(solver.Solve(twice));
+  CHECK(Values(twice) == HARD_SOLUTION);
+
+  // No givens, only cages of two squares taken from a solution.
+  sudoku::Sudoku killer;
+  std::vector<std::vector<unsigned>> cages;
+  for (unsigned row = 0; row < 9; row++) {
+    for (unsigned col = 0; col + 1 < 9; col += 2) {
+      cages.push_back({row * 9 + col, row * 9 + col + 1});
+    }
+  }
+  for (unsigned row = 0; row + 1 < 9; row += 2) {
+    cages.push_back({row * 9 + 8, (row + 1) * 9 + 8});
+  }
+  cages[cages.size() - 5].push_back(80);
+  for (const auto &cage : cages) {
+    unsigned sum = 0;
+    for (auto square : cage) {
+      sum += Value(HARD_SOLUTION[square]);
+    }
+    killer.AddKillerBlock(cage, sum);
+  }
+  CHECK(solver.CountSolutions(killer, 2) >= 1);
+  REQUIRE(solver.Solve(killer));
+  CHECK(!killer.HasConflict());
+  for (const auto &block : killer.KillerBlocks()) {
+    unsigned sum = 0;
+    for (auto square : block.Cells()) {
+      sum += killer.Data()[square].SingletonValue();
+    }
+    CHECK(sum == block.Sum());
+  }
+
+  // Both cages need an 8 and a 9 in the same row.
+  sudoku::Sudoku impossible;
+  impossible.AddKillerBlock({0, 1}, 17);
+  impossible.AddKillerBlock({2, 3}, 17);
+  CHECK(solver.CountSolutions(impossible, 2) == 0);
+}
+
+TEST_CASE("Backtracking : basic 9x9 search", "[backtracking]") {
+  // Basic 9x9 puzzles have their own search, a cage over two givens doesn't
+  // change the solutions but takes the generic one.
+  std::mt19937_64 rng(17);
+  BacktrackingSolver solver;
+  for (unsigned round = 0; round < 200; round++) {
+    std::string grid = HARD_SOLUTION;
+    for (unsigned removed = 0; removed < 40 + round % 30; removed++) {
+      grid[2 + rng() % 79] = '0';
+    }
+    sudoku::Sudoku plain;
+    sudoku::ReadPuzzle(grid, plain);
+    // Candidates removed as if by the techniques.
+    for (unsigned cell = 0; round % 2 == 1 && cell < 81; cell++) {
+      if (grid[cell] != '0' || rng() % 3 != 0)
+        continue;
+      sudoku::BitSet square = plain.Data()[cell];
+      square -= 1 + (Value(HARD_SOLUTION[cell]) + static_cast<unsigned>(rng() % 8)) % 9;
+      plain.Grid()[cell] = square;
+    }
+    sudoku::Sudoku caged = plain;
+    caged.AddKillerBlock({0, 1}, Value(HARD_SOLUTION[0]) + Value(HARD_SOLUTION[1]));
+
+    INFO("round " << round);
+    uint64_t count = solver.CountSolutions(plain, 50);
+    CHECK(count == solver.CountSolutions(caged, 50));
+    if (count == 1) {
+      REQUIRE(solver.Solve(plain));
+      CHECK(Values(plain) == HARD_SOLUTION);
+    }
+  }
+}
+
+TEST_CASE("Backtracking : CountSolutions", "[backtracking]") {
+  sudoku::Sudoku empty;
+  CHECK(CountSolutions(empty) == 2);
+  CHECK(CountSolutions(empty, 5) == 5);
+
+  sudoku::Sudoku unique;
+  sudoku::ReadPuzzle(HARD_PUZZLE, unique);
+  CHECK(CountSolutions(unique) == 1);
+
+  // Diagonal puzzles have fewer solutions than the same grid without the
+  // diagonals.
+  std::string grid = DIAGONAL_SOLUTION_9;
+  for (unsigned i = 0; i < 81; i += 2) {
+    grid[i] = '0';
+  }
+  sudoku::Sudoku basic(9, BASIC);
+  sudoku::Sudoku diagonal(9, DIAGONAL);
+  sudoku::ReadPuzzle(grid, basic);
+  sudoku::ReadPuzzle(grid, diagonal);
+  uint64_t basic_count = CountSolutions(basic, 1000);
+  uint64_t diagonal_count = CountSolutions(diagonal, 1000);
+  CHECK(diagonal_count >= 1);
+  CHECK(diagonal_count <= basic_count);
+}
@@ -0,0 +1,210 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "../src/BatchSolver.h"
+#include "../src/Generator.h"
+#include "../src/SmartSolver.h"
+#include "TestPuzzles.h"
+#include <catch2/catch.hpp>
+#include <sstream>
+
+namespace {
+const char *BATCH[][2] = {
+    {SINGLES_PUZZLE, ""},
+    {PUZZLES[0][0], PUZZLES[0][1]},
+    {STUCK_PUZZLE, STUCK_SOLUTION},
+    {PUZZLES[1][0], PUZZLES[1][1]},
+    // Deliberately wrong solution.
+    {PUZZLES[1][0], "383921657967345821251876493548132976729564138136798245372689514814253769695417382"},
+};
+
+std::vector<BatchPuzzle> MakeBatch(size_t copies) {
+  std::vector<BatchPuzzle> batch;
+  for (size_t i = 0; i < copies; i++) {
+    for (auto &p : BATCH) {
+      batch.push_back({p[0], p[1]});
+    }
+  }
+  return batch;
+}
+
+std::string StatsString(const SolveStats &stats) {
+  std::stringstream s;
+  s << stats;
+  return s.str();
+}
+} // namespace
+
+TEST_CASE("BatchSolver : single thread", "[batch]") {
+  auto batch = MakeBatch(1);
+  BatchSolver solver(1);
+  BatchResult result = solver.Solve(batch);
+
+  REQUIRE(result.outcomes.size() == batch.size());
+  CHECK(result.outcomes[1] == BatchOutcome::SOLVED);
+  CHECK(result.outcomes[3] == BatchOutcome::SOLVED);
+  CHECK(result.outcomes[4] == BatchOutcome::INCORRECT);
+  CHECK(result.incorrect == 1);
+}
+
+TEST_CASE("BatchSolver : deterministic across thread counts", "[batch]") {
+  // Enough copies to span multiple chunks per worker.
+  auto batch = MakeBatch(BatchSolver::CHUNK_SIZE);
+  BatchResult reference = BatchSolver(1).Solve(batch);
+
+  for (unsigned threads : {2u, 3u, 8u}) {
+    BatchResult result = BatchSolver(threads).Solve(batch);
+    INFO("threads " << threads);
+    CHECK(result.outcomes == reference.outcomes);
+    CHECK(result.solved == reference.solved);
+    CHECK(result.incorrect == reference.incorrect);
+    CHECK(StatsString(result.stats) == StatsString(reference.stats));
+  }
+}
+
+TEST_CASE("BatchSolver : empty batch", "[batch]") {
+  BatchResult result = BatchSolver(4).Solve({});
+  CHECK(result.outcomes.empty());
+  CHECK(result.solved == 0);
+}
+
+TEST_CASE("BatchSolver : backtracking fallback", "[batch]") {
+  // Beyond the techniques of SmartSolver.
+  std::vector<BatchPuzzle> batch{
+      {HARD_PUZZLE, HARD_SOLUTION},
+      {PUZZLES[0][0], PUZZLES[0][1]}};
+
+  BatchResult plain = BatchSolver(1).Solve(batch);
+  CHECK(plain.outcomes[0] == BatchOutcome::UNSOLVED);
+  CHECK(plain.searched == 0);
+
+  BatchSolver solver(1, 9, BASIC, ScheduleMode::REFERENCE, true);
+  // The fallbacks are kept between the batches.
+  for (int run = 0; run < 2; run++) {
+    BatchResult result = solver.Solve(batch);
+    CHECK(result.outcomes[0] == BatchOutcome::SEARCHED);
+    CHECK(result.outcomes[1] == BatchOutcome::SOLVED);
+    CHECK(result.solved == 2);
+    CHECK(result.searched == 1);
+    CHECK(result.incorrect == 0);
+  }
+}
+
+TEST_CASE("BatchSolver : rating", "[batch]") {
+  auto batch = MakeBatch(BatchSolver::CHUNK_SIZE);
+  std::vector<PuzzleRating> reference(batch.size());
+  BatchSolver(1).Rate(batch, reference);
+
+  for (size_t i = 0; i < std::size(BATCH); i++) {
+    sudoku::Sudoku s;
+    sudoku::ReadPuzzle(BATCH[i][0], s);
+    SolveStats stats;
+    bool solved = SmartSolver::Solve(s, stats);
+    const PuzzleRating &rating = reference[i];
+    INFO("puzzle " << i);
+    // The wrong solution doesn't count as solved.
+    CHECK(rating.solved == (solved && i != 4));
+    CHECK(rating.hardest == HardestTechnique(stats));
+    unsigned steps = 0;
+    for (unsigned t = 0; t < TECHNIQUE_COUNT; t++) {
+      CHECK(rating.hits[t] == TechniqueHits(stats, static_cast<Technique>(t)));
+      steps += rating.hits[t];
+    }
+    CHECK(rating.steps == steps);
+    CHECK(rating.steps > 0);
+  }
+
+  std::vector<PuzzleRating> ratings(batch.size());
+  BatchSolver(3).Rate(batch, ratings);
+  for (size_t i = 0; i < batch.size(); i++) {
+    CHECK(ratings[i].solved == reference[i].solved);
+    CHECK(ratings[i].hardest == reference[i].hardest);
+    CHECK(ratings[i].hits == reference[i].hits);
+  }
+}
+
+TEST_CASE("BatchSolver : rating records", "[batch]") {
+  PuzzleRating rating;
+  rating.solved = true;
+  rating.hardest = Technique::FISH_2;
+  rating.steps = 3;
+  rating.hits[static_cast<unsigned>(Technique::SINGLES)] = 2;
+  rating.hits[static_cast<unsigned>(Technique::FISH_2)] = 1;
+  rating.nanoseconds[static_cast<unsigned>(Technique::SINGLES)] = 100;
+  rating.nanoseconds[static_cast<unsigned>(Technique::GROUPS_2)] = 20;
+
+  std::stringstream record;
+  record << RatingRecord{7, rating};
+  CHECK(record.str() == "7,1,fish_2,3,singles:2:100 groups_2:0:20 fish_2:1:0");
+
+  std::stringstream json;
+  json << RatingRecordJson{7, rating};
+  CHECK(json.str() == "{\"id\": 7, \"solved\": true, \"hardest\": \"fish_2\", \"steps\": 3, \"tiers\": "
+                      "{\"singles\": {\"hits\": 2, \"nanoseconds\": 100}, \"groups_2\": {\"hits\": 0, "
+                      "\"nanoseconds\": 20}, \"fish_2\": {\"hits\": 1, \"nanoseconds\": 0}}}");
+}
+
+TEST_CASE("BatchSolver : binary puzzles", "[batch]") {
+  auto text = MakeBatch(2);
+  std::vector<std::string> data(text.size());
+  std::vector<BatchPuzzle> binary;
+  for (size_t i = 0; i < text.size(); i++) {
+    sudoku::Sudoku s;
+    sudoku::ReadPuzzle(text[i].puzzle, s);
+    s.SerializeBinary(data[i]);
+    binary.push_back({data[i], text[i].solution, PuzzleFormat::BINARY});
+  }
+  // Not a puzzle in either format.
+  binary.push_back({"\x07", "", PuzzleFormat::BINARY});
+  text.push_back({"", ""});
+
+  BatchSolver solver(2);
+  auto from_text = solver.Solve(text);
+  auto from_binary = solver.Solve(binary);
+  CHECK(from_binary.solved == from_text.solved);
+  CHECK(from_binary.incorrect == from_text.incorrect);
+  CHECK(from_binary.outcomes == from_text.outcomes);
+  CHECK(StatsString(from_binary.stats) == StatsString(from_text.stats));
+}
+
+TEST_CASE("BatchSolver : backtracking binary puzzles of other sizes and types", "[batch]") {
+  // Binary puzzles carry their own size and type, which don't have to match
+  // the ones of the batch.
+  std::vector<std::string> data(3);
+  sudoku::Sudoku(16).SerializeBinary(data[0]);
+  sudoku::Sudoku(9, DIAGONAL).SerializeBinary(data[1]);
+  sudoku::Sudoku hard;
+  sudoku::ReadPuzzle(HARD_PUZZLE, hard);
+  hard.SerializeBinary(data[2]);
+  std::vector<BatchPuzzle> batch;
+  for (const auto &record : data) {
+    batch.push_back({record, "", PuzzleFormat::BINARY});
+  }
+
+  std::vector<std::string> grids(batch.size());
+  BatchResult result = BatchSolver(1, 9, BASIC, ScheduleMode::REFERENCE, true).Solve(batch, grids);
+  CHECK(result.searched == 3);
+  CHECK(result.outcomes == std::vector<BatchOutcome>(3, BatchOutcome::SEARCHED));
+  CHECK(grids[0].size() == 256);
+  CHECK(grids[1].size() == 81);
+
+  sudoku::Sudoku diagonal(9, DIAGONAL);
+  REQUIRE(sudoku::ReadPuzzle(grids[1], diagonal) != 0);
+  CHECK(diagonal.IsSet());
+  CHECK(!diagonal.HasConflict());
+}
+
+TEST_CASE("BatchSolver : solved grids larger than 35x35", "[batch]") {
+  // Their numbers have no square characters, so the grid is serialized.
+  std::mt19937_64 rng(13);
+  sudoku::Sudoku solution = Generator(1, 36).PatternSolution(rng);
+  sudoku::Sudoku puzzle = solution;
+  puzzle.Grid()[0] = sudoku::BitSet::SudokuSquare(36);
+  std::string data;
+  puzzle.SerializeBinary(data);
+
+  std::vector<BatchPuzzle> batch{{data, "", PuzzleFormat::BINARY}};
+  std::vector<std::string> grids(batch.size());
+  BatchResult result = BatchSolver(1).Solve(batch, grids);
+  REQUIRE(result.solved == 1);
+  CHECK(grids[0] == solution.Serialize());
+}
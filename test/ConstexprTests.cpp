@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 #include "../src/core/BitSet.h"
+#include "../src/core/StaticLayout.h"
 
 namespace sudoku {
 
@@ -130,4 +131,75 @@ TEST_CASE("BitSet Iteration tests", "[nextset]") {
   STATIC_REQUIRE(iter3->IsBitSet(1));
 }
 
-}
\ No newline at end of file
+TEST_CASE("SmallBitSet tests", "[bitset]") {
+  STATIC_REQUIRE(sizeof(SmallBitSet) == 2);
+  STATIC_REQUIRE(sizeof(BitSet) == 8);
+
+  constexpr SmallBitSet a = SmallBitSet::SudokuSquare(9);
+  STATIC_REQUIRE(a.CountSet() == 9);
+  STATIC_REQUIRE(a.Highest() == 9);
+  constexpr SmallBitSet b = SmallBitSet::SudokuSquare(16);
+  STATIC_REQUIRE(b.CountSet() == 16);
+  STATIC_REQUIRE(b.IsBitSet(16));
+  STATIC_REQUIRE(BitSet::SudokuSquare(64).CountSet() == 64);
+
+  constexpr SmallBitSet c = (SmallBitSet::SingleBit(16, 16) + 3) - 16;
+  STATIC_REQUIRE(c.HasSingletonValue());
+  STATIC_REQUIRE(c.SingletonValue() == 3);
+  STATIC_REQUIRE((b - c).CountSet() == 15);
+  STATIC_REQUIRE(!(b - c).HasIntersection(c));
+  STATIC_REQUIRE((b & c) == c);
+  STATIC_REQUIRE(b.HasAdditionalBits(c));
+
+  constexpr SmallBitSet d = SmallBitSet::SingleBit(16, 16) + 1;
+  constexpr auto iter = BitSetBits{&d}.begin();
+  STATIC_REQUIRE(*iter == 1);
+  STATIC_REQUIRE(*Next(iter) == 16);
+}
+
+TEST_CASE("SmallBitSet Iteration tests", "[nextset]") {
+  constexpr auto iter1 = BitSetSets<SmallBitSet>(16, 15).begin();
+  STATIC_REQUIRE(iter1->CountSet() == 15);
+  STATIC_REQUIRE(!iter1->IsBitSet(16));
+  constexpr auto iter2 = Next(iter1);
+  STATIC_REQUIRE(iter2->CountSet() == 15);
+  STATIC_REQUIRE(!iter2->IsBitSet(15));
+  STATIC_REQUIRE(iter2->IsBitSet(16));
+}
+
+TEST_CASE("StaticLayout tests", "[layout]") {
+  STATIC_REQUIRE(BoxSize(9) == 3);
+  STATIC_REQUIRE(BoxSize(16) == 4);
+  STATIC_REQUIRE(BoxSize(10) == 0);
+
+  constexpr const auto &basic = STATIC_LAYOUT<9, false>;
+  STATIC_REQUIRE(basic.BLOCKS == 27);
+  STATIC_REQUIRE(basic.cell_block_count[0] == 3);
+  STATIC_REQUIRE(basic.cell_blocks[10][0] == 1);
+  STATIC_REQUIRE(basic.cell_blocks[10][1] == 10);
+  STATIC_REQUIRE(basic.cell_blocks[10][2] == 18);
+  STATIC_REQUIRE(basic.cell_offsets[10][2] == 4);
+  STATIC_REQUIRE(basic.block_cells[18 + 4][0] == 30);
+  STATIC_REQUIRE(basic.peers[0].Count() == 20);
+  STATIC_REQUIRE(!basic.peers[0].IsSet(0));
+  STATIC_REQUIRE(basic.peers[0].IsSet(20));
+  STATIC_REQUIRE(!basic.peers[0].IsSet(80));
+  // Seen from both corners of a row: the rest of the row.
+  STATIC_REQUIRE((basic.peers[0] & basic.peers[8]).Count() == 7);
+
+  constexpr const auto &diagonal = STATIC_LAYOUT<9, true>;
+  STATIC_REQUIRE(diagonal.BLOCKS == 29);
+  STATIC_REQUIRE(diagonal.cell_block_count[40] == 5);
+  STATIC_REQUIRE(diagonal.cell_blocks[40][3] == 27);
+  STATIC_REQUIRE(diagonal.cell_blocks[40][4] == 28);
+  STATIC_REQUIRE(diagonal.peers[0].Count() == 26);
+  STATIC_REQUIRE(diagonal.peers[0].IsSet(80));
+  STATIC_REQUIRE((diagonal.peers[0] & diagonal.peers[80]).Count() == 9);
+
+  constexpr const auto &large = STATIC_LAYOUT<16, false>;
+  STATIC_REQUIRE(large.BLOCKS == 48);
+  STATIC_REQUIRE(large.peers[255].Count() == 39);
+  STATIC_REQUIRE(large.block_cells[47][15] == 255);
+}
+
+}
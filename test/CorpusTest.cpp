@@ -0,0 +1,173 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "../src/Corpus.h"
+#include "TestPuzzles.h"
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+std::string WriteCorpus(const std::string &name, const std::string &content) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  f << content;
+  std::filesystem::remove(Corpus::IndexFilename(path.string()));
+  return path.string();
+}
+} // namespace
+
+TEST_CASE("Corpus : records", "[corpus]") {
+  std::string path = WriteCorpus("sudoku_corpus_test.csv",
+                                 "quizzes,solutions\n"
+                                 "123,456\n"
+                                 "789,012\r\n"
+                                 "\n"
+                                 "345,678");
+  Corpus corpus(path);
+  REQUIRE(corpus.IsOpen());
+  REQUIRE(corpus.Size() == 3);
+  CHECK(!corpus.IndexFromSidecar());
+  CHECK(corpus.Line(0) == "123,456");
+  CHECK(corpus.Line(1) == "789,012");
+  CHECK(corpus.Puzzle(2).puzzle == "345");
+  CHECK(corpus.Puzzle(2).solution == "678");
+  CHECK(!std::filesystem::exists(Corpus::IndexFilename(path)));
+}
+
+TEST_CASE("Corpus : no header", "[corpus]") {
+  std::string path = WriteCorpus("sudoku_corpus_test_noheader.csv",
+                                 "123,456\n"
+                                 "789,012\n");
+  Corpus corpus(path);
+  REQUIRE(corpus.Size() == 2);
+  CHECK(corpus.Puzzle(0).puzzle == "123");
+  CHECK(corpus.Puzzle(1).solution == "012");
+}
+
+TEST_CASE("Corpus : reading records from a stream", "[corpus]") {
+  std::stringstream input("quizzes,solutions\r\n"
+                          "123,456\r\n"
+                          "789,012\n"
+                          "345,678");
+  std::vector<std::string> lines(2);
+  bool first = true;
+  REQUIRE(Corpus::ReadRecords(input, lines, first) == 2);
+  CHECK(!first);
+  CHECK(lines[0] == "123,456");
+  CHECK(lines[1] == "789,012");
+  REQUIRE(Corpus::ReadRecords(input, lines, first) == 1);
+  CHECK(lines[0] == "345,678");
+  CHECK(Corpus::ReadRecords(input, lines, first) == 0);
+
+  // Only the first line of the stream can be a header.
+  std::stringstream no_header("123,456\nquizzes,solutions\n");
+  first = true;
+  CHECK(Corpus::ReadRecords(no_header, lines, first) == 2);
+  CHECK(lines[1] == "quizzes,solutions");
+}
+
+TEST_CASE("Corpus : sidecar index", "[corpus]") {
+  std::string path = WriteCorpus("sudoku_corpus_test_index.csv",
+                                 "quizzes,solutions\n"
+                                 "123,456\n"
+                                 "789,012\n");
+  {
+    Corpus corpus(path, Corpus::SIDECAR);
+    CHECK(!corpus.IndexFromSidecar());
+    CHECK(std::filesystem::exists(Corpus::IndexFilename(path)));
+  }
+
+  Corpus corpus(path);
+  CHECK(corpus.IndexFromSidecar());
+  REQUIRE(corpus.Size() == 2);
+  CHECK(corpus.Line(1) == "789,012");
+
+  // A stale index is ignored.
+  {
+    std::ofstream f(path, std::ios::app);
+    f << "345,678\n";
+  }
+  Corpus updated(path);
+  CHECK(!updated.IndexFromSidecar());
+  CHECK(updated.Size() == 3);
+}
+
+TEST_CASE("Corpus : corrupted sidecar index", "[corpus]") {
+  std::string path = WriteCorpus("sudoku_corpus_test_corrupted.csv",
+                                 "123,456\n"
+                                 "789,012\n");
+  // Overwrite a 64 bit value of the index, after the magic, file size and
+  // modification time come the records count and the offsets.
+  auto corrupt = [&path](std::streamoff at, uint64_t value) {
+    { Corpus corpus(path, Corpus::SIDECAR); }
+    std::fstream f(Corpus::IndexFilename(path), std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(at);
+    f.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  };
+
+  for (auto [at, value] : {std::pair<std::streamoff, uint64_t>{32 + 8, uint64_t{1} << 40},
+                           {32 + 8, 0}, {32 + 16, 10}, {24, ~uint64_t{0}}}) {
+    INFO(at << " " << value);
+    std::filesystem::remove(Corpus::IndexFilename(path));
+    corrupt(at, value);
+    Corpus corpus(path);
+    CHECK(!corpus.IndexFromSidecar());
+    REQUIRE(corpus.Size() == 2);
+    CHECK(corpus.Line(1) == "789,012");
+  }
+}
+
+TEST_CASE("Corpus : missing file", "[corpus]") {
+  Corpus corpus("/nonexistent/sudoku_corpus.csv");
+  CHECK(!corpus.IsOpen());
+  CHECK(corpus.Size() == 0);
+}
+
+TEST_CASE("Corpus : binary records", "[corpus]") {
+  auto path = (std::filesystem::temp_directory_path() / "sudoku_corpus_test.bin").string();
+  sudoku::Sudoku puzzle;
+  sudoku::ReadPuzzle(PUZZLES[1][0], puzzle);
+  sudoku::Sudoku killer;
+  killer.AddKillerBlock({0, 1, 2}, 6);
+  {
+    BinaryCorpusWriter writer(path);
+    REQUIRE(writer.IsOpen());
+    writer.Add(puzzle, PUZZLES[1][1]);
+    writer.Add(killer);
+    // Not a binary corpus until the table is written.
+    CHECK(!BinaryCorpus::IsBinary(path));
+    REQUIRE(writer.Close());
+  }
+  REQUIRE(BinaryCorpus::IsBinary(path));
+
+  BinaryCorpus corpus(path);
+  REQUIRE(corpus.IsOpen());
+  REQUIRE(corpus.Size() == 2);
+  CHECK(corpus.Puzzle(0).format == PuzzleFormat::BINARY);
+  CHECK(corpus.Puzzle(0).solution == PUZZLES[1][1]);
+  CHECK(corpus.Puzzle(1).solution.empty());
+
+  sudoku::Sudoku read;
+  CHECK(read.DeserializeBinary(corpus.Puzzle(0).puzzle) == corpus.Puzzle(0).puzzle.size());
+  CHECK(read.Serialize() == puzzle.Serialize());
+  read.DeserializeBinary(corpus.Puzzle(1).puzzle);
+  CHECK(read.Serialize() == killer.Serialize());
+}
+
+TEST_CASE("Corpus : invalid binary corpus", "[corpus]") {
+  std::string text = WriteCorpus("sudoku_corpus_test_text.bin", "123,456\n");
+  CHECK(!BinaryCorpus::IsBinary(text));
+  CHECK(!BinaryCorpus(text).IsOpen());
+
+  // A table that points past the end of the file.
+  std::string header("SDKBIN01", 8);
+  header += std::string("\x01\0\0\0\0\0\0\0", 8);
+  header += std::string("\x18\0\0\0\0\0\0\0", 8);
+  header += std::string("\x18\0\0\0\0\0\0\0", 8);
+  std::string broken = WriteCorpus("sudoku_corpus_test_broken.bin", header);
+  CHECK(BinaryCorpus::IsBinary(broken));
+  BinaryCorpus corpus(broken);
+  CHECK(!corpus.IsOpen());
+  CHECK(corpus.Size() == 0);
+}
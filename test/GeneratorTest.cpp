@@ -0,0 +1,172 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "../src/Generator.h"
+#include "../src/SmartSolver.h"
+#include "TestPuzzles.h"
+#include <catch2/catch.hpp>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+// Needs an X-Wing, but nothing harder.
+const char *X_WING_PUZZLE = "000790000700000030020000010400100008003407009009268040300000680010000500006020490";
+
+bool IsGivenOf(const std::string &puzzle, const std::string &solution) {
+  if (puzzle.size() != solution.size())
+    return false;
+  for (size_t i = 0; i < puzzle.size(); i++) {
+    if (puzzle[i] != '0' && puzzle[i] != solution[i])
+      return false;
+  }
+  return true;
+}
+} // namespace
+
+TEST_CASE("Generator : random solutions and minimal puzzles", "[generator]") {
+  Generator generator(1);
+  std::mt19937_64 rng(7);
+  BacktrackingSolver solver;
+  std::set<std::string> solutions;
+  for (unsigned round = 0; round < 10; round++) {
+    std::string solution = generator.RandomSolution(rng, solver);
+    REQUIRE(solution.size() == 81);
+    sudoku::Sudoku solved;
+    sudoku::ReadPuzzle(solution, solved);
+    CHECK(solved.IsSet());
+    CHECK(!solved.HasConflict());
+    solutions.insert(solution);
+
+    std::string puzzle = generator.RemoveGivens(solution, rng, solver);
+    CHECK(IsGivenOf(puzzle, solution));
+    sudoku::Sudoku s;
+    sudoku::ReadPuzzle(puzzle, s);
+    CHECK(CountSolutions(s) == 1);
+    // No given can be removed without losing the uniqueness.
+    for (size_t i = 0; i < puzzle.size(); i += 7) {
+      if (puzzle[i] == '0')
+        continue;
+      std::string fewer = puzzle;
+      fewer[i] = '0';
+      sudoku::Sudoku t;
+      sudoku::ReadPuzzle(fewer, t);
+      CHECK(CountSolutions(t) == 2);
+    }
+  }
+  CHECK(solutions.size() == 10);
+}
+
+TEST_CASE("Generator : rating", "[generator]") {
+  Generator generator(1);
+  CHECK(generator.Rate(X_WING_PUZZLE) == Technique::FISH_2);
+  // Beyond the techniques.
+  CHECK(generator.Rate(HARD_PUZZLE) == Technique::COUNT);
+
+  Technique technique = Technique::SINGLES;
+  CHECK(FindTechnique("fish_2", technique));
+  CHECK(technique == Technique::FISH_2);
+  CHECK(!FindTechnique("fish_9", technique));
+}
+
+TEST_CASE("Generator : puzzles within a band", "[generator]") {
+  Generator generator(2);
+  DifficultyBand band{Technique::GROUPS_2, Technique::FISH_2};
+  std::mutex lock;
+  std::vector<GeneratedPuzzle> puzzles;
+  GeneratorReport report = generator.Generate(
+      8, band, 11, [&](const GeneratedPuzzle &puzzle) {
+        // The calls are serialized, the lock only checks that.
+        std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+        CHECK(guard.owns_lock());
+        puzzles.push_back(puzzle);
+      });
+  CHECK(report.generated == 8);
+  CHECK(report.candidates >= 8);
+  REQUIRE(puzzles.size() == 8);
+  for (const auto &puzzle : puzzles) {
+    CHECK(band.Contains(puzzle.hardest));
+    CHECK(generator.Rate(puzzle.puzzle) == puzzle.hardest);
+    CHECK(IsGivenOf(puzzle.puzzle, puzzle.solution));
+    sudoku::Sudoku s;
+    sudoku::ReadPuzzle(puzzle.puzzle, s);
+    CHECK(CountSolutions(s) == 1);
+  }
+}
+
+TEST_CASE("Generator : attempts limit", "[generator]") {
+  Generator generator(1);
+  uint64_t delivered = 0;
+  // Nothing needs the largest finned fish in a handful of candidates.
+  DifficultyBand band{Technique::FINNED_FISH_7, Technique::FINNED_FISH_7};
+  GeneratorReport report = generator.Generate(
+      1, band, 3, [&](const GeneratedPuzzle &) { delivered++; }, 3);
+  CHECK(report.candidates == 3);
+  CHECK(report.generated == delivered);
+}
+
+TEST_CASE("Generator : 64 bit seeds", "[generator]") {
+  Generator generator(1);
+  auto first = [&generator](uint64_t seed) {
+    std::string solution;
+    generator.Generate(1, DifficultyBand{}, seed, [&](const GeneratedPuzzle &puzzle) { solution = puzzle.solution; });
+    return solution;
+  };
+  CHECK(first(5) == first(5));
+  // Seeds that only differ in the upper half.
+  CHECK(first(5) != first(5 + (uint64_t{1} << 32)));
+}
+
+TEST_CASE("Generator : pattern solutions of large grids", "[generator]") {
+  std::mt19937_64 rng(3);
+  for (unsigned size : {6u, 12u, 25u, 36u, 64u}) {
+    INFO("size " << size);
+    Generator generator(1, size);
+    sudoku::Sudoku first = generator.PatternSolution(rng);
+    sudoku::Sudoku second = generator.PatternSolution(rng);
+    CHECK(first.IsSet());
+    CHECK(!first.HasConflict());
+    CHECK(second.IsSet());
+    CHECK(!second.HasConflict());
+    CHECK(first.Serialize() != second.Serialize());
+  }
+  CHECK_THROWS_AS(Generator(1, 9, DIAGONAL).PatternSolution(rng), std::invalid_argument);
+  CHECK_THROWS_AS(Generator(1, 7).PatternSolution(rng), std::invalid_argument);
+}
+
+TEST_CASE("Generator : text grids only up to 35x35", "[generator]") {
+  // Past 'Z' the square characters would alias other numbers.
+  std::mt19937_64 rng(11);
+  Generator generator(1, 36);
+  BacktrackingSolver solver(36);
+  CHECK_THROWS_AS(generator.RandomSolution(rng, solver), std::invalid_argument);
+  CHECK_THROWS_AS(generator.RemoveGivens(std::string(36 * 36, '0'), rng, solver), std::invalid_argument);
+  CHECK_THROWS_AS(generator.Generate(1, {}, 1, [](const GeneratedPuzzle &) {}), std::invalid_argument);
+
+  std::ostringstream text;
+  CHECK_THROWS_AS(text << generator.PatternSolution(rng), std::out_of_range);
+  CHECK_NOTHROW(text << Generator(1, 25).PatternSolution(rng));
+}
+
+TEST_CASE("Generator : solving large grids", "[generator]") {
+  std::mt19937_64 rng(5);
+  std::bernoulli_distribution given(0.7);
+  for (unsigned size : {25u, 36u, 49u, 64u}) {
+    INFO("size " << size);
+    Generator generator(1, size);
+    sudoku::Sudoku puzzle = generator.PatternSolution(rng);
+    for (unsigned cell = 0; cell < size * size; cell++) {
+      if (!given(rng))
+        puzzle.Grid()[cell] = sudoku::BitSet::SudokuSquare(size);
+    }
+
+    SolveStats stats;
+    if (!SmartSolver::Solve(puzzle, stats)) {
+      BacktrackingSolver solver(size);
+      REQUIRE(solver.Solve(puzzle));
+    }
+    CHECK(puzzle.IsSet());
+    CHECK(!puzzle.HasConflict());
+  }
+}
@@ -1,5 +1,8 @@
 #include <catch2/catch.hpp>
 #include "../src/killer/KillerBlock.h"
+#include <algorithm>
+#include <random>
+#include <vector>
 
 namespace sudoku {
 
@@ -10,16 +13,14 @@ struct SimpleBlock {
             data.push_back(BitSet::SudokuSquare(max));
         }
         for (unsigned i = 0; i < size; i++) {
-            block_data.push_back(&data[i]);
+            block_data.push_back(i);
         }
     }
     std::vector<BitSet> data;
-    std::vector<BitSet*> block_data;
+    std::vector<unsigned> block_data;
 };
 }
 
-std::vector<bool> &TestGetPossibleSets(KillerBlock &s) { return s.possible_sets_; }
-
 TEST_CASE("Killer Block : union", "[killer]") {
     SimpleBlock two(2u,9u);
     SimpleBlock three(3u,9u);
@@ -46,7 +47,12 @@ TEST_CASE("Killer Block : union", "[killer]") {
     CHECK(!u3.IsBitSet(8));
     CHECK(!u3.IsBitSet(9));
 
-    TestGetPossibleSets(k3)[2] = false;
+    // Without 6 in the squares, {1,2,6} is no longer possible.
+    for (auto &square : three.data) {
+        square -= 6;
+    }
+    k3.PruneSumSets(three.data.data());
+    CHECK(!k3.IsPossibleSet(2));
     u3 = k3.UnionSumSet();
     CHECK(u3.CountSet() == 5);
     CHECK(!u3.IsBitSet(6));
@@ -54,7 +60,13 @@ TEST_CASE("Killer Block : union", "[killer]") {
     CHECK(!u3.IsBitSet(8));
     CHECK(!u3.IsBitSet(9));
 
-    TestGetPossibleSets(k3)[1] = false;
+    // And without 5, {1,3,5} neither.
+    for (auto &square : three.data) {
+        square -= 5;
+    }
+    k3.PruneSumSets(three.data.data());
+    CHECK(k3.IsPossibleSet(0));
+    CHECK(!k3.IsPossibleSet(1));
     u3 = k3.UnionSumSet();
     CHECK(u3.CountSet() == 3);
     CHECK(u3.IsBitSet(2));
@@ -65,15 +77,116 @@ TEST_CASE("Killer Block : union", "[killer]") {
 TEST_CASE("Killer Block : Prune", "[killer]") {
     SimpleBlock three(3u, 9u);
     KillerBlock k1(three.block_data, 9u, 15u);
-    CHECK(TestGetPossibleSets(k1).size() == 8u);
+    CHECK(k1.CountPossibleSets() == 8u);
 
     three.data[0] -= 8;
     three.data[1] -= 8;
     three.data[2] -= 8;
-    k1.PruneSumSets();
-    auto &v = TestGetPossibleSets(k1);
-    CHECK(std::count(v.begin(), v.end(), true) == 5u);
+    k1.PruneSumSets(three.data.data());
+    CHECK(k1.CountPossibleSets() == 5u);
 }
 
+TEST_CASE("Killer Block : sum tables of all sizes", "[killer]") {
+    for (unsigned max : {4u, 6u, 9u, 16u, 25u}) {
+        for (unsigned squares = 1; squares <= std::min(max, 5u); squares++) {
+            for (unsigned sum = 1; sum <= max * squares; sum++) {
+                INFO("max " << max << " squares " << squares << " sum " << sum);
+                std::vector<BitSet> expected;
+                BitSet all = BitSet::Empty(max);
+                for (auto set : BitSetSets(max, squares)) {
+                    unsigned total = 0;
+                    for (auto number : BitSetBits(&set)) {
+                        total += number;
+                    }
+                    if (total == sum) {
+                        expected.push_back(set);
+                        all |= set;
+                    }
+                }
+                const SumSets &entry = GetSumSets(max, squares, sum);
+                CHECK(entry.complete);
+                CHECK(std::vector<BitSet>(entry.sets.begin(), entry.sets.end()) == expected);
+                CHECK(entry.all == all);
+                CHECK(&GetSumSets(max, squares, sum) == &entry);
+            }
+        }
+    }
+    // Only the number of the sets, a brute force over all the sets of 25
+    // squares takes too long.
+    CHECK(getNumberOfSets(16, 8, 36) == 1);
+    CHECK(getNumberOfSets(16, 8, 100) == 1);
+    CHECK(getNumberOfSets(16, 16, 136) == 1);
+    CHECK(getNumberOfSets(25, 24, 313) == 1);
+    CHECK(getNumberOfSets(25, 2, 26) == 12);
+    CHECK(getNumberOfSets(25, 2, 3) == 1);
+    CHECK(getSet(25, 2, 49, 0) == BitSet::SingleBit(25, 24) + 25);
+}
+
+TEST_CASE("Killer Block : cages of large puzzles", "[killer]") {
+    SimpleBlock three(3u, 16u);
+    KillerBlock k1(three.block_data, 16u, 45u);
+    // 16+15+14
+    CHECK(k1.CountPossibleSets() == 1u);
+    CHECK(k1.UnionSumSet() == BitSet::SingleBit(16, 14) + 15 + 16);
+
+    KillerBlock k2(three.block_data, 16u, 40u);
+    BitSet u2 = k2.UnionSumSet();
+    CHECK(!u2.IsBitSet(8));
+    CHECK(u2.IsBitSet(9));
+    three.data[0] = BitSet::SingleBit(16, 9);
+    k2.PruneSumSetsBySquare(three.data.data());
+    // 9+15+16
+    CHECK(k2.UnionSumSet() == BitSet::SingleBit(16, 9) + 15 + 16);
 
-}
\ No newline at end of file
+    // Too many sets to list, the cage doesn't restrict the squares.
+    SimpleBlock many(32u, 64u);
+    KillerBlock k3(many.block_data, 64u, 1040u);
+    CHECK(k3.CountPossibleSets() == 0u);
+    CHECK(k3.UnionSumSet() == BitSet::SudokuSquare(64));
+    k3.PruneSumSets(many.data.data());
+    CHECK(k3.UnionSumSet() == BitSet::SudokuSquare(64));
+}
+
+TEST_CASE("Killer Block : pruning matches the sets", "[killer]") {
+    std::mt19937 rng(9);
+    // {max, squares, sum}, the larger ones need masks of several words.
+    const unsigned cages[][3] = {{9, 3, 15}, {9, 4, 20}, {16, 5, 40}, {16, 8, 68}, {25, 5, 65}};
+    for (const auto &[max, squares, sum] : cages) {
+        const SumSets &entry = GetSumSets(max, squares, sum);
+        for (unsigned round = 0; round < 20; round++) {
+            INFO("max " << max << " squares " << squares << " round " << round);
+            SimpleBlock block(squares, max);
+            for (auto &square : block.data) {
+                for (unsigned number = 1; number <= max; number++) {
+                    if (rng() % 5 == 0)
+                        square -= number;
+                }
+            }
+            KillerBlock cage(block.block_data, max, sum);
+            cage.PruneSumSets(block.data.data());
+            cage.PruneSumSetsBySquare(block.data.data());
+
+            BitSet all = BitSet::Empty(max);
+            for (auto square : block.data) {
+                all |= square;
+            }
+            BitSet expected_union = BitSet::Empty(max);
+            unsigned expected_count = 0;
+            for (unsigned i = 0; i < entry.sets.size(); i++) {
+                bool possible = !entry.sets[i].HasAdditionalBits(all);
+                for (auto square : block.data) {
+                    possible = possible && entry.sets[i].HasIntersection(square);
+                }
+                CHECK(cage.IsPossibleSet(i) == possible);
+                if (possible) {
+                    expected_union |= entry.sets[i];
+                    expected_count++;
+                }
+            }
+            CHECK(cage.CountPossibleSets() == expected_count);
+            CHECK(cage.UnionSumSet() == expected_union);
+        }
+    }
+}
+
+}
@@ -0,0 +1,92 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#include "../src/Pipeline.h"
+#include "TestPuzzles.h"
+#include <catch2/catch.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("BoundedQueue : order and closing", "[pipeline]") {
+  BoundedQueue<int> queue(2);
+  bool pushed = true;
+  std::thread producer([&] {
+    for (int i = 0; i < 1000; i++) {
+      pushed = queue.Push(i) && pushed;
+    }
+    queue.Close();
+  });
+  int item = -1;
+  for (int i = 0; i < 1000; i++) {
+    REQUIRE(queue.Pop(item));
+    CHECK(item == i);
+  }
+  CHECK(!queue.Pop(item));
+  producer.join();
+  CHECK(pushed);
+  CHECK(!queue.Push(0));
+}
+
+TEST_CASE("SolvePipeline : results in input order", "[pipeline]") {
+  std::stringstream input;
+  std::string expected;
+  input << "quizzes,solutions\r\n";
+  for (unsigned i = 0; i < 200; i++) {
+    auto &p = PUZZLES[i % 2];
+    input << p[0] << ',' << p[1] << "\r\n";
+    expected += std::string(p[1]) + '\n';
+  }
+
+  BatchSolver solver(3);
+  // Batches smaller than the input and fewer than the stages.
+  for (size_t batches : {1u, 2u, 4u}) {
+    std::stringstream in(input.str());
+    std::stringstream output;
+    SolvePipeline pipeline(solver, 7, batches);
+    PipelineReport report = pipeline.Run(in, output);
+    CHECK(output.str() == expected);
+    CHECK(report.puzzles == 200);
+    CHECK(report.solved == 200);
+    CHECK(report.incorrect == 0);
+  }
+}
+
+TEST_CASE("SolvePipeline : unsolved and unreadable puzzles", "[pipeline]") {
+  std::stringstream input;
+  input << HARD_PUZZLE << '\n' << "12345\n" << PUZZLES[0][0] << ",123\n";
+
+  std::stringstream output;
+  PipelineReport report = SolvePipeline(BatchSolver(2)).Run(input, output);
+  CHECK(report.puzzles == 3);
+  CHECK(report.solved == 1);
+  CHECK(report.incorrect == 1);
+
+  // The remaining candidates of the unsolved puzzle, which can be read back.
+  std::string line;
+  REQUIRE(std::getline(output, line));
+  sudoku::Sudoku residual;
+  residual.Deserialize(line);
+  CHECK(!residual.IsSet());
+  CHECK(residual[0][0].SingletonValue() == 8);
+  REQUIRE(std::getline(output, line));
+  CHECK(line.empty());
+  REQUIRE(std::getline(output, line));
+  CHECK(line == PUZZLES[0][1]);
+
+  // The backtracking fallback completes the puzzle.
+  std::stringstream hard(HARD_PUZZLE);
+  std::stringstream solved;
+  BatchSolver backtracking(1, 9, BASIC, ScheduleMode::REFERENCE, true);
+  report = SolvePipeline(backtracking).Run(hard, solved);
+  CHECK(report.searched == 1);
+  CHECK(solved.str() == std::string(HARD_SOLUTION) + '\n');
+}
+
+TEST_CASE("SolvePipeline : empty input", "[pipeline]") {
+  std::stringstream input;
+  std::stringstream output;
+  PipelineReport report = SolvePipeline(BatchSolver(2)).Run(input, output);
+  CHECK(report.puzzles == 0);
+  CHECK(output.str().empty());
+}
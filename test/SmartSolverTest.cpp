@@ -1,16 +1,13 @@
 #include "../src/SmartSolver.h"
 #include "../src/SolveStats.h"
+#include "TestPuzzles.h"
 #include <catch2/catch.hpp>
 #include <sstream>
 
 namespace sudoku {
 
 void TestInjectKillerBlock(Sudoku &s, unsigned sum, const std::vector<unsigned>& offsets) {
-    std::vector<BitSet*> squares;
-    for (unsigned o : offsets) {
-        squares.push_back(&s.data_[o]);
-    }
-    s.killers_.emplace_back(squares, s.Max(), sum);
+    s.MutableKillers().blocks.emplace_back(offsets, s.Max(), sum);
 }
 
 TEST_CASE("Solver : Test Solve", "x") {
@@ -115,7 +112,7 @@ TEST_CASE("Solver : Killer Sudoku","[]") {
 TEST_CASE("Solver : Bad Solve", "[]") {
   std::string puzzle =
       "030 085 000 625 319 700 000 002 005 000 074 100 000 250 000 700 003 002 106 030 009 008 000 010 490 500 860\n";
-  std::string expected = "934785621625319784817642395562974138341258976789163452156837249278496513493521867\n";
+  std::string expected = std::string(STUCK_SOLUTION) + '\n';
   std::stringstream stream(puzzle);
   Sudoku test(9);
   stream >> test;
@@ -137,4 +134,98 @@ TEST_CASE("Solver : Bad Solve", "[]") {
   }*/
 }
 
+TEST_CASE("Solver : Technique counters", "[stats]") {
+  Sudoku test(9);
+  ReadPuzzle(PUZZLES[0][0], test);
+  uint64_t candidates = 0;
+  for (unsigned i = 0; i < 81; i++) {
+    candidates += test.Data()[i].CountSet();
+  }
+  uint64_t read = test.Eliminated();
+
+  SolveStats stats;
+  REQUIRE(SmartSolver::Solve(test, stats));
+  if constexpr (SolveStats::TECHNIQUE_STATS) {
+    const auto &singles = stats.techniques[static_cast<unsigned>(Technique::SINGLES)];
+    CHECK(singles.invocations > 0);
+    CHECK(singles.productive == static_cast<uint64_t>(stats.groups[1]));
+    CHECK(singles.nanoseconds > 0);
+
+    // Every removed candidate is attributed to exactly one technique.
+    uint64_t eliminated = 0;
+    for (const auto &counters : stats.techniques) {
+      CHECK(counters.productive <= counters.invocations);
+      eliminated += counters.eliminated;
+    }
+    CHECK(eliminated == candidates - 81);
+    CHECK(eliminated == test.Eliminated() - read);
+
+    SolveStats merged;
+    merged += stats;
+    merged += stats;
+    CHECK(merged.techniques[0].invocations == 2 * singles.invocations);
+  }
+
+  std::stringstream json;
+  json << SolveStatsJson{stats};
+  CHECK(json.str().starts_with("{\"groups\": {\"1\": "));
+  CHECK(json.str().ends_with("]}"));
+  CHECK((json.str().find("\"name\": \"singles\"") != std::string::npos) == SolveStats::TECHNIQUE_STATS);
+}
+
+TEST_CASE("Solver : Technique scheduler", "[schedule]") {
+  TechniqueScheduler reference;
+  auto order = reference.Order(9, BASIC);
+  REQUIRE(order.size() == TECHNIQUE_COUNT);
+  CHECK(order.front() == Technique::SINGLES);
+  reference.Record(9, BASIC, Technique::FISH_2, 100, true);
+  CHECK(reference.Profile(9, BASIC, Technique::FISH_2).invocations == 0);
+
+  TechniqueScheduler adaptive(ScheduleMode::ADAPTIVE);
+  // Cheap and productive vs expensive and fruitless.
+  for (uint64_t i = 0; i < TechniqueScheduler::SKIP_INVOCATIONS; i++) {
+    for (unsigned t = 0; t < TECHNIQUE_COUNT; t++) {
+      auto technique = static_cast<Technique>(t);
+      if (technique == Technique::XYCHAINS)
+        adaptive.Record(9, BASIC, technique, 10, true);
+      else if (technique == Technique::GROUPS_2)
+        adaptive.Record(9, BASIC, technique, 1, false);
+      else
+        adaptive.Record(9, BASIC, technique, 1000, i % 2 == 0);
+    }
+  }
+  CHECK(adaptive.Profile(9, BASIC, Technique::XYCHAINS).productive == TechniqueScheduler::SKIP_INVOCATIONS);
+
+  order = adaptive.Order(9, BASIC);
+  CHECK(order[0] == Technique::SINGLES);
+  CHECK(order[1] == Technique::XYCHAINS);
+  CHECK(order.back() == Technique::GROUPS_2);
+  // Other variants keep their own profiles.
+  CHECK(adaptive.Order(9, DIAGONAL)[1] == Technique::GROUPS_2);
+}
+
+TEST_CASE("Solver : Adaptive schedule", "[schedule]") {
+  const char *puzzles[] = {SINGLES_PUZZLE, PUZZLES[0][0], STUCK_PUZZLE, PUZZLES[1][0]};
+
+  TechniqueScheduler adaptive(ScheduleMode::ADAPTIVE);
+  for (unsigned round = 0; round < 64; round++) {
+    for (auto puzzle : puzzles) {
+      Sudoku fixed(9), scheduled(9);
+      ReadPuzzle(puzzle, fixed);
+      ReadPuzzle(puzzle, scheduled);
+      SolveStats stats;
+      bool solved = SmartSolver::Solve(fixed, stats);
+      CHECK(SmartSolver::Solve(scheduled, stats, adaptive) == solved);
+      if (solved) {
+        for (unsigned i = 0; i < 9; i++) {
+          for (unsigned j = 0; j < 9; j++) {
+            CHECK(scheduled[i][j] == fixed[i][j]);
+          }
+        }
+      }
+    }
+  }
+  CHECK(adaptive.Profile(9, BASIC, Technique::SINGLES).invocations > 0);
+}
+
 } // namespace sudoku
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include <catch2/catch.hpp>
 #include "../src/core/SudokuAlgorithms.h"
 #include "../src/core/BitSet.h"
+#include "../src/core/GridParser.h"
+#include "../src/core/NakedSingles.h"
+#include <random>
+#include <string>
+#include <tuple>
 
 namespace sudoku {
 
@@ -215,27 +220,27 @@ struct MiniTestPuzzle {
     MiniTestPuzzle() : data(9*9, BitSet::SudokuSquare(9))  {
         blocks.reserve(27);
     for (unsigned i = 0; i < 9; i++) {
-        std::vector<BitSet*> row;
+        std::vector<unsigned> row;
         for (unsigned j = 0; j < 9; j++) {
-            row.push_back(&data[i*9+j]);
+            row.push_back(i*9+j);
         }
         blocks.emplace_back(std::move(row), 9u);
         rows.push_back(&blocks.back());
     }   
     for (unsigned j = 0; j < 9; j++) {
-        std::vector<BitSet*> col;
+        std::vector<unsigned> col;
         for (unsigned i = 0; i < 9; i++) {
-            col.push_back(&data[i*9+j]);
+            col.push_back(i*9+j);
         }
         blocks.emplace_back(std::move(col), 9u);
         cols.push_back(&blocks.back());
     }
     for (unsigned i = 0; i < 3; i++) {
       for (unsigned j = 0; j < 3; j++) {
-        std::vector<BitSet*> square;
+        std::vector<unsigned> square;
         for (unsigned x = i*3; x < (i+1)*3; x++) {
           for (unsigned y = j*3; y < (j+1)*3; y++) {
-            square.push_back(&data[x*9+y]);
+            square.push_back(x*9+y);
           }
         }
         blocks.emplace_back(std::move(square), 9u);
@@ -246,9 +251,9 @@ struct MiniTestPuzzle {
 
     std::vector<BitSet> data;
     std::vector<UniqueBlock> blocks;
-    std::vector<UniqueBlock*> rows;
-    std::vector<UniqueBlock*> cols;
-    std::vector<UniqueBlock*> squares;
+    std::vector<const UniqueBlock*> rows;
+    std::vector<const UniqueBlock*> cols;
+    std::vector<const UniqueBlock*> squares;
 };
 }
 
@@ -289,7 +294,7 @@ TEST_CASE("Sudoku Algorithms : SolveFish X-Wing 1", "[fish]") {
   puzzle.data[7*9+8] += 4;
   puzzle.data[8*9+0] += 4;
 
-  SolveFish(puzzle.cols, puzzle.rows, 2, 4);
+  SolveFish(puzzle.data.data(), puzzle.cols, puzzle.rows, 2, 4);
 
   unsigned count = 0;
   for (unsigned i = 0; i < 9; i++) {
@@ -310,7 +315,7 @@ TEST_CASE("Sudoku Algorithms : SolveFish X-Wing 2", "[fish]") {
     puzzle.data[5*9+j] -= 1;
   }
 
-  SolveFish(puzzle.rows, puzzle.cols, 2, 1);
+  SolveFish(puzzle.data.data(), puzzle.rows, puzzle.cols, 2, 1);
   for (unsigned i = 0; i < 9; i++) {
     for (unsigned j = 0; j < 9; j++) {
       if (i == 2 || i == 5) {
@@ -337,7 +342,7 @@ TEST_CASE("Sudoku Algorithms : SolveFish X-Wing 3", "[fish]") {
   puzzle.data[1*9+6] += 4;
 
 
-  SolveFish(puzzle.cols, puzzle.rows, 2, 4);
+  SolveFish(puzzle.data.data(), puzzle.cols, puzzle.rows, 2, 4);
   unsigned count = 0;
   for (unsigned i = 0; i < 9; i++) {
     for (unsigned j = 0; j < 9; j++) {
@@ -367,7 +372,7 @@ TEST_CASE("Sudoku Algorithms : SolveFinnedFish 1", "[finned]") {
     expect.data[3*9+2] -= 1;
     expect.data[4*9+2] -= 1;
 
-    SolveFinnedFish(test.rows, [&test](unsigned number, unsigned row, unsigned col, BitSet rows, BitSet cols){
+    SolveFinnedFish(test.data.data(), test.rows, [&test](unsigned number, unsigned row, unsigned col, BitSet rows, BitSet cols){
         REQUIRE(number == 1);
         REQUIRE(row == 6);
         REQUIRE(col == 1);
@@ -408,7 +413,7 @@ TEST_CASE("Sudoku Algorithms : SolveFinnedFish 2", "[finned]") {
   expect.data[2*9+3] -= 1;
   expect.data[2*9+4] -= 1;
 
-  SolveFinnedFish(test.cols, [&test](unsigned number, unsigned col, unsigned row, BitSet cols, BitSet rows){
+  SolveFinnedFish(test.data.data(), test.cols, [&test](unsigned number, unsigned col, unsigned row, BitSet cols, BitSet rows){
       REQUIRE(number == 1);
       REQUIRE(row == 1);
       REQUIRE(col == 6);
@@ -444,7 +449,7 @@ TEST_CASE("Sudoku Algorithms : SolveFinnedFish 3", "[finned]") {
     expect.data[j*9+5] -= 1;
   }
 
-  SolveFinnedFish(test.cols, [&test](unsigned, unsigned, unsigned, BitSet, BitSet){
+  SolveFinnedFish(test.data.data(), test.cols, [&test](unsigned, unsigned, unsigned, BitSet, BitSet){
     CHECK(false);
   }, 2, 1);
 
@@ -471,7 +476,7 @@ TEST_CASE("Sudoku Algorithms : SolveFinnedFish 4", "[finned]") {
   test.data[3*9+5] += 1;
   expect.data[3*9+5] += 1;
 
-  SolveFinnedFish(test.cols, [&test](unsigned number, unsigned col, unsigned row, BitSet cols, BitSet rows){
+  SolveFinnedFish(test.data.data(), test.cols, [&test](unsigned number, unsigned col, unsigned row, BitSet cols, BitSet rows){
       REQUIRE(number == 1);
       REQUIRE(row == 4);
       REQUIRE(col == 6);
@@ -497,15 +502,15 @@ TEST_CASE("Sudoku Algorithms : SolveIntersection 1", "[intersection]") {
 
   for (unsigned j = 0; j < 9; j++) {
     if (j != 2) {
-      (*test.rows[1]->GetSquares()[j]) -= 1;
-      (*expect.rows[1]->GetSquares()[j]) -= 1;
+      test.data[test.rows[1]->Cells()[j]] -= 1;
+      expect.data[expect.rows[1]->Cells()[j]] -= 1;
     }
     if (j != 1) {
-      (*expect.cols[2]->GetSquares()[j]) -= 1;
+      expect.data[expect.cols[2]->Cells()[j]] -= 1;
     }
   }
 
-  SolveBlockIntersection(*test.rows[1], *test.cols[2]);
+  SolveBlockIntersection(test.data.data(), *test.rows[1], *test.cols[2]);
   REQUIRE(test.data[1*9+2].IsBitSet(1));
 
   for (unsigned i = 0; i < 9; i++) {
@@ -522,15 +527,15 @@ TEST_CASE("Sudoku Algorithms : SolveIntersection 2", "[intersection]") {
 
   for (unsigned j = 0; j < 9; j++) {
     if (j < 3 || j >= 6) {
-      (*test.cols[5]->GetSquares()[j]) -= 1;
-      (*expect.cols[5]->GetSquares()[j]) -= 1;
+      test.data[test.cols[5]->Cells()[j]] -= 1;
+      expect.data[expect.cols[5]->Cells()[j]] -= 1;
     } else {
-      (*expect.cols[3]->GetSquares()[j]) -= 1;
-      (*expect.cols[4]->GetSquares()[j]) -= 1;
+      expect.data[expect.cols[3]->Cells()[j]] -= 1;
+      expect.data[expect.cols[4]->Cells()[j]] -= 1;
     }
   }
 
-  SolveBlockIntersection(*test.cols[5], *test.squares[4]);
+  SolveBlockIntersection(test.data.data(), *test.cols[5], *test.squares[4]);
 
   for (unsigned i = 0; i < 9; i++) {
     for (unsigned j = 0; j < 9; j++) {
@@ -541,4 +546,384 @@ TEST_CASE("Sudoku Algorithms : SolveIntersection 2", "[intersection]") {
 
 }
 
-}
\ No newline at end of file
+// Naked singles propagated one block at a time until nothing changes.
+std::vector<BitSet> ReferenceNakedSingles(std::vector<BitSet> data, unsigned size, unsigned box, bool diagonal) {
+  std::vector<UniqueBlock> blocks;
+  for (unsigned i = 0; i < size; i++) {
+    std::vector<unsigned> row, col;
+    for (unsigned j = 0; j < size; j++) {
+      row.push_back(i*size+j);
+      col.push_back(j*size+i);
+    }
+    blocks.emplace_back(std::move(row), size);
+    blocks.emplace_back(std::move(col), size);
+  }
+  for (unsigned i = 0; i < size; i += box) {
+    for (unsigned j = 0; j < size; j += box) {
+      std::vector<unsigned> square;
+      for (unsigned x = i; x < i+box; x++) {
+        for (unsigned y = j; y < j+box; y++) {
+          square.push_back(x*size+y);
+        }
+      }
+      blocks.emplace_back(std::move(square), size);
+    }
+  }
+  if (diagonal) {
+    std::vector<unsigned> d1, d2;
+    for (unsigned i = 0; i < size; i++) {
+      d1.push_back(i*size+i);
+      d2.push_back(i*size+size-1-i);
+    }
+    blocks.emplace_back(std::move(d1), size);
+    blocks.emplace_back(std::move(d2), size);
+  }
+
+  std::vector<BitSet> previous;
+  while (previous != data) {
+    previous = data;
+    for (auto &block : blocks) {
+      SolveNakedGroups(block.GetSquares(data.data()), 1);
+    }
+  }
+  return data;
+}
+
+void CheckNakedSingleKernels(const std::vector<BitSet> &data, unsigned size, unsigned box, bool diagonal) {
+  auto expected = ReferenceNakedSingles(data, size, box, diagonal);
+  bool expect_modified = expected != data;
+
+  std::vector<SinglesKernel> kernels{SinglesKernel::SCALAR};
+  if (HasAvx2Kernel())
+    kernels.push_back(SinglesKernel::AVX2);
+
+  for (auto kernel : kernels) {
+    INFO("kernel " << static_cast<int>(kernel) << " size " << size << " diagonal " << diagonal);
+    PackedGrid grid;
+    for (unsigned i = 0; i < size; i++) {
+      for (unsigned j = 0; j < size; j++) {
+        grid.squares[i*PackedGrid::STRIDE+j] = SmallBitSet::FromValue(static_cast<uint16_t>(data[i*size+j].Value()));
+      }
+    }
+    REQUIRE(PropagateNakedSingles(grid, size, box, diagonal, kernel) == expect_modified);
+    for (unsigned i = 0; i < PackedGrid::STRIDE; i++) {
+      for (unsigned j = 0; j < PackedGrid::STRIDE; j++) {
+        INFO(i << " " << j);
+        if (i < size && j < size) {
+          REQUIRE(grid.squares[i*PackedGrid::STRIDE+j].Value() == expected[i*size+j].Value());
+        } else {
+          REQUIRE(grid.squares[i*PackedGrid::STRIDE+j] == SmallBitSet());
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Sudoku Algorithms : PropagateNakedSingles", "[naked_singles]") {
+  MiniTestPuzzle puzzle;
+  // A single in the middle box, cascading into a second single in its row.
+  puzzle.data[4*9+4] = BitSet::SingleBit(9, 5);
+  puzzle.data[4*9+0] = BitSet::SingleBit(9, 5) | BitSet::SingleBit(9, 7);
+  CheckNakedSingleKernels(puzzle.data, 9, 3, false);
+  CheckNakedSingleKernels(puzzle.data, 9, 3, true);
+
+  auto expected = ReferenceNakedSingles(puzzle.data, 9, 3, false);
+  CHECK(expected[4*9+0] == BitSet::SingleBit(9, 7));
+  CHECK(expected[4*9+8] == (BitSet::SudokuSquare(9) - BitSet::SingleBit(9, 5) - BitSet::SingleBit(9, 7)));
+  CHECK(expected[0] == (BitSet::SudokuSquare(9) - BitSet::SingleBit(9, 7)));
+}
+
+// Solutions that are valid for diagonal puzzles as well, grids that never
+// remove the solution number can't run into a conflict.
+const std::vector<std::tuple<unsigned, unsigned, std::string>> &DiagonalSolutions() {
+  static const std::vector<std::tuple<unsigned, unsigned, std::string>> solutions{
+      {9u, 3u, "639251748458367912172849365967435281824176593315928476796583124541692837283714659"},
+      {16u, 4u, "347A1G26B5CDE89FFC8E3BD46G19A527D5B68EC9FA27341G1G297F5A8E43B6CD6AD1597E24B8CFG3B8576A3FE9GC1D4"
+                "22394C1GDA76F5B8EGECF48B21D356A798DGCF2957BA14E36413BA7ECGF5692D89FE2B618C3D4G7A5A765D34G928EFCB"
+                "1E6F32DA14C7G895B72AG946358FBD1EC5948GCFBD1E2736ACB1DE587369A2GF4"}};
+  return solutions;
+}
+
+// Random grid keeping the solution number in each square, solved with the
+// given probability (in tenths).
+std::vector<BitSet> RandomGrid(std::mt19937 &rng, unsigned size, const std::string &solution, unsigned solved) {
+  std::uniform_int_distribution<unsigned> number(1, size);
+  std::uniform_int_distribution<unsigned> kind(0, 9);
+  std::vector<BitSet> data(size*size, BitSet::SudokuSquare(size));
+  for (unsigned i = 0; i < size*size; i++) {
+    char c = solution[i];
+    unsigned value = isdigit(c) ? static_cast<unsigned>(c - '0') : static_cast<unsigned>(c - 'A') + 10u;
+    unsigned k = kind(rng);
+    if (k < solved) {
+      data[i] = BitSet::SingleBit(size, value);
+    } else if (k < solved + 2) {
+      data[i] -= number(rng);
+      data[i] -= number(rng);
+      data[i] += value;
+    }
+  }
+  return data;
+}
+
+TEST_CASE("Sudoku Algorithms : PropagateNakedSingles random grids", "[naked_singles]") {
+  std::mt19937 rng(42);
+  for (const auto &[size, box, solution] : DiagonalSolutions()) {
+    for (unsigned round = 0; round < 50; round++) {
+      auto data = RandomGrid(rng, size, solution, 3);
+      CheckNakedSingleKernels(data, size, box, false);
+      CheckNakedSingleKernels(data, size, box, true);
+    }
+  }
+}
+
+std::vector<GridKernel> GridKernels() {
+  std::vector<GridKernel> kernels{GridKernel::SCALAR};
+  if (HasAvx2Kernel())
+    kernels.push_back(GridKernel::AVX2);
+  return kernels;
+}
+
+char SquareChar(unsigned value, bool lower) {
+  if (value < 10)
+    return static_cast<char>('0' + value);
+  return static_cast<char>((lower ? 'a' : 'A') + value - 10);
+}
+
+TEST_CASE("Sudoku Algorithms : ParseGrid", "[grid_parser]") {
+  std::mt19937 rng(5);
+  for (unsigned size : {4u, 9u, 16u, 25u, 35u}) {
+    std::uniform_int_distribution<unsigned> value(0, size);
+    std::uniform_int_distribution<unsigned> empty(0, 2);
+    std::bernoulli_distribution lower(0.5);
+    for (unsigned round = 0; round < 20; round++) {
+      std::string text;
+      std::vector<BitSet> expected;
+      for (unsigned i = 0; i < size*size; i++) {
+        unsigned v = value(rng);
+        text += v == 0 ? "0.*"[empty(rng)] : SquareChar(v, lower(rng));
+        expected.push_back(v == 0 ? BitSet::SudokuSquare(size) : BitSet::SingleBit(size, v));
+      }
+      // Only the squares are read.
+      text += "trailing,text";
+
+      for (auto kernel : GridKernels()) {
+        INFO("kernel " << static_cast<int>(kernel) << " size " << size);
+        std::vector<BitSet> squares(size*size);
+        REQUIRE(ParseGrid(text, size, squares.data(), kernel));
+        CHECK(squares == expected);
+
+        // The text is rejected as a whole, wherever the bad square is.
+        std::vector<BitSet> untouched = squares;
+        std::string wrong = text;
+        const unsigned bad = size*size - 1 - round % (size*size);
+        wrong[bad] = ' ';
+        CHECK(!ParseGrid(wrong, size, squares.data(), kernel));
+        wrong[bad] = SquareChar(size + 1, false);
+        CHECK(!ParseGrid(wrong, size, squares.data(), kernel));
+        CHECK(!ParseGrid(std::string_view(text).substr(0, size*size - 1), size, squares.data(), kernel));
+        CHECK(squares == untouched);
+      }
+    }
+  }
+}
+
+TEST_CASE("Sudoku Algorithms : MatchesGrid", "[grid_parser]") {
+  for (const auto &[size, box, solution] : DiagonalSolutions()) {
+    std::vector<BitSet> squares(size*size);
+    REQUIRE(ParseGrid(solution, size, squares.data()));
+    std::string lower = solution;
+    for (auto &c : lower) {
+      c = static_cast<char>(tolower(c));
+    }
+    for (auto kernel : GridKernels()) {
+      INFO("kernel " << static_cast<int>(kernel) << " size " << size);
+      CHECK(MatchesGrid(solution, size, squares.data(), kernel));
+      CHECK(MatchesGrid(lower, size, squares.data(), kernel));
+      CHECK(!MatchesGrid(std::string_view(solution).substr(1), size, squares.data(), kernel));
+      for (unsigned square : {0u, size*size/2, size*size - 1}) {
+        std::vector<BitSet> other = squares;
+        other[square] += other[square].SingletonValue() % size + 1;
+        CHECK(!MatchesGrid(solution, size, other.data(), kernel));
+        // An empty square never matches, not even an empty one.
+        std::string empty = solution;
+        empty[square] = '0';
+        other[square] = BitSet::Empty(size);
+        CHECK(!MatchesGrid(empty, size, other.data(), kernel));
+      }
+    }
+  }
+}
+
+// Group search over all the subsets, without skipping the solved squares.
+template <typename Squares>
+void ReferenceNakedGroups(const Squares &squares, unsigned size) {
+  const unsigned num_elem = static_cast<unsigned>(squares.size());
+  for (auto iter : BitSetSets(num_elem, size)) {
+    BitSet u = Union(squares, iter);
+    if (u.CountSet() == size) {
+      for (auto s : squares) {
+        if (s->HasAdditionalBits(u))
+          (*s) -= u;
+      }
+    }
+  }
+}
+
+template <typename Squares>
+void ReferenceHiddenGroups(const Squares &squares, unsigned size) {
+  const unsigned num_elem = static_cast<unsigned>(squares.size());
+  for (auto iter : BitSetSets(num_elem, size)) {
+    BitSet found = BitSet::Empty(num_elem);
+    for (auto number : BitSetBits(&iter)) {
+      found |= NumberPositions(squares, number);
+    }
+    if (found.CountSet() != size)
+      continue;
+    bool valid = true;
+    for (auto i : BitSetBits(&found)) {
+      if (squares[i-1]->HasSingletonValue())
+        valid = false;
+    }
+    if (!valid)
+      continue;
+    for (auto i : BitSetBits(&found)) {
+      (*squares[i-1]) &= iter;
+    }
+  }
+}
+
+TEST_CASE("Sudoku Algorithms : group search over unresolved squares", "[naked_groups][hidden_groups]") {
+  std::mt19937 rng(11);
+  for (const auto &[size, box, solution] : DiagonalSolutions()) {
+    std::vector<UniqueBlock> rows;
+    for (unsigned i = 0; i < size; i++) {
+      std::vector<unsigned> row;
+      for (unsigned j = 0; j < size; j++) {
+        row.push_back(i*size+j);
+      }
+      rows.emplace_back(std::move(row), size);
+    }
+
+    for (unsigned round = 0; round < 20; round++) {
+      // Grids with naked singles propagated, the state the solver searches
+      // for groups in.
+      auto data = ReferenceNakedSingles(RandomGrid(rng, size, solution, 1 + round % 6), size, box, false);
+      for (unsigned group = 1; group <= 3; group++) {
+        INFO("size " << size << " round " << round << " group " << group);
+        std::vector<BitSet> expected_hidden = data, hidden = data;
+        for (auto &row : rows) {
+          ReferenceHiddenGroups(row.GetSquares(expected_hidden.data()), group);
+          SolveHiddenGroups(row.GetSquares(hidden.data()), group);
+        }
+        CHECK(hidden == expected_hidden);
+
+        // A group including solved squares is a smaller group padded with
+        // the solved squares, so the searches can take different steps, but
+        // they reach the same state once the groups up to the size are
+        // exhausted.
+        auto exhaust = [&rows, group](std::vector<BitSet> state, auto solve) {
+          std::vector<BitSet> previous;
+          while (previous != state) {
+            previous = state;
+            for (auto &row : rows) {
+              for (unsigned smaller = 1; smaller <= group; smaller++) {
+                solve(row.GetSquares(state.data()), smaller);
+              }
+            }
+          }
+          return state;
+        };
+        using RowSquares = decltype(rows[0].GetSquares(data.data()));
+        auto expected_naked = exhaust(data, [](const RowSquares &squares, unsigned k) { ReferenceNakedGroups(squares, k); });
+        auto naked = exhaust(data, [](const RowSquares &squares, unsigned k) { SolveNakedGroups(squares, k); });
+        CHECK(naked == expected_naked);
+      }
+    }
+  }
+}
+
+// Fish search over all the subsets of the base blocks.
+template <typename Grid>
+void ReferenceFish(const Grid &grid, const std::vector<const UniqueBlock *> &blocks,
+                   const std::vector<const UniqueBlock *> &orthogonal, unsigned size, unsigned number) {
+  const unsigned num_elem = static_cast<unsigned>(blocks.size());
+  for (auto iter : BitSetSets(num_elem, size)) {
+    bool valid = true;
+    BitSet set = BitSet::Empty(num_elem);
+    for (auto bit : BitSetBits(&iter)) {
+      BitSet x = blocks[bit-1]->NumberPositions(grid, number);
+      if (x.CountSet() < 2)
+        valid = false;
+      set |= x;
+    }
+    if (!valid || set.CountSet() != size)
+      continue;
+    for (auto bit : BitSetBits(&set)) {
+      orthogonal[bit-1]->Prune(grid, number, iter);
+    }
+  }
+}
+
+TEST_CASE("Sudoku Algorithms : fish search up to half of the lines", "[fish]") {
+  std::mt19937 rng(5);
+  for (const auto &[size, box, solution] : DiagonalSolutions()) {
+    std::vector<UniqueBlock> blocks;
+    for (unsigned i = 0; i < size; i++) {
+      std::vector<unsigned> row, col;
+      for (unsigned j = 0; j < size; j++) {
+        row.push_back(i*size+j);
+        col.push_back(j*size+i);
+      }
+      blocks.emplace_back(std::move(row), size);
+      blocks.emplace_back(std::move(col), size);
+    }
+    std::vector<const UniqueBlock *> rows, cols;
+    for (unsigned i = 0; i < size; i++) {
+      rows.push_back(&blocks[2*i]);
+      cols.push_back(&blocks[2*i+1]);
+    }
+
+    unsigned eliminated = 0;
+    // The reference search of the large fish is slow on 16x16 grids.
+    const unsigned rounds = size == 9 ? 20 : 2;
+    for (unsigned round = 0; round < rounds; round++) {
+      INFO("size " << size << " round " << round);
+      auto data = ReferenceNakedSingles(RandomGrid(rng, size, solution, 3 + round % 4), size, box, false);
+
+      // Every size in both directions, against the sizes up to the limit.
+      auto exhaust = [&](std::vector<BitSet> state, bool limited) {
+        std::vector<BitSet> previous;
+        while (previous != state) {
+          previous = state;
+          const BitSet *grid = state.data();
+          BitSet *mutable_grid = state.data();
+          for (unsigned number = 1; number <= size; number++) {
+            unsigned max = size - 1;
+            if (limited) {
+              max = MaxFishSize(BlocksPositions<const BitSet *>(grid, rows, number),
+                                BlocksPositions<const BitSet *>(grid, cols, number));
+            }
+            for (unsigned k = 2; k <= max; k++) {
+              if (limited) {
+                SolveFish(mutable_grid, rows, cols, k, number);
+                SolveFish(mutable_grid, cols, rows, k, number);
+              } else {
+                ReferenceFish(mutable_grid, rows, cols, k, number);
+                ReferenceFish(mutable_grid, cols, rows, k, number);
+              }
+            }
+          }
+        }
+        return state;
+      };
+      auto expected = exhaust(data, false);
+      CHECK(exhaust(data, true) == expected);
+      for (unsigned i = 0; i < size*size; i++) {
+        eliminated += data[i].CountSet() - expected[i].CountSet();
+      }
+    }
+    CHECK(eliminated > 0);
+  }
+}
+
+}
@@ -3,23 +3,24 @@
 #include "../src/Sudoku.h"
 #include "../src/SmartSolver.h"
 #include "../src/SolveStats.h"
+#include "../src/core/SudokuAlgorithms.h"
+#include "TestPuzzles.h"
 #include <catch2/catch.hpp>
+#include <algorithm>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 #include <iostream>
 
 namespace sudoku {
 
-std::vector<std::vector<std::vector<UniqueBlock *>>> &
+const std::vector<std::vector<unsigned>> &
 TestGetMappings(Sudoku &s) {
-  return s.block_mapping_;
+  return s.layout_->mapping;
 }
 
 void TestInjectKillerBlock(Sudoku &s, unsigned sum, const std::vector<unsigned>& offsets) {
-    std::vector<BitSet*> squares;
-    for (unsigned o : offsets) {
-        squares.push_back(&s.data_[o]);
-    }
-    s.killers_.emplace_back(squares, s.Max(), sum);
+    s.MutableKillers().blocks.emplace_back(offsets, s.Max(), sum);
 }
 
 
@@ -31,8 +32,6 @@ void ClearSudoku(Sudoku &s) {
   }
 }
 
-std::vector<::sudoku::BitSet *> &TestGetBlockData(UniqueBlock &s) { return s.elem_; }
-
 TEST_CASE("Sudoku : simple operations", "[basic]") {
   std::string small = "4  0  0   0  0  8   0  0  3 \n"
                       "0  0  5   2  0  0   0  1  0 \n"
@@ -63,6 +62,83 @@ TEST_CASE("Sudoku : simple operations", "[basic]") {
   REQUIRE(!test.IsSet());
 }
 
+TEST_CASE("Sudoku : read puzzle from text", "[basic]") {
+  std::string_view text = "4..008003 005200010060009000000000030006901000000604920029000300004002085000703000,rest";
+  Sudoku test(9);
+  size_t consumed = ReadPuzzle(text, test);
+  CHECK(consumed == text.find(','));
+  CHECK(test[0][0].SingletonValue() == 4);
+  CHECK(test[0][1].CountSet() == 9);
+  CHECK(test[0][2].CountSet() == 9);
+  CHECK(test[0][5].SingletonValue() == 8);
+  CHECK(test[7][7].SingletonValue() == 8);
+
+  std::stringstream stream(std::string(text.substr(0, consumed)));
+  Sudoku expected(9);
+  stream >> expected;
+  CHECK(test.Serialize() == expected.Serialize());
+
+  Sudoku truncated(9);
+  CHECK(ReadPuzzle(text.substr(0, 40), truncated) == 0);
+
+  // A number larger than the puzzle and a character that isn't a square,
+  // with and without separators.
+  for (std::string record : {"A" + std::string(80, '0'), "0?" + std::string(79, '0'),
+                             "A 0" + std::string(79, '0'), "0 ?" + std::string(79, '0')}) {
+    INFO(record);
+    Sudoku invalid(9);
+    CHECK(ReadPuzzle(record, invalid) == 0);
+    CHECK(invalid.Serialize() == Sudoku(9).Serialize());
+  }
+
+  Sudoku large(16);
+  CHECK(ReadPuzzle("1A*G" + std::string(252, '0'), large) == 256);
+  CHECK(large[0][1].SingletonValue() == 10);
+  CHECK(large[0][2].CountSet() == 16);
+  CHECK(large[0][3].SingletonValue() == 16);
+}
+
+TEST_CASE("Sudoku : copy and move", "[basic]") {
+  std::string_view text = "009201708408300902102009305907405200804106003305908406700503104001602807203700609";
+  Sudoku test(9, DIAGONAL);
+  REQUIRE(ReadPuzzle(text, test) != 0);
+  TestInjectKillerBlock(test, 11, {6, 7});
+
+  Sudoku copy(test);
+  CHECK(copy.Serialize() == test.Serialize());
+  CHECK(copy.Blocks().size() == test.Blocks().size());
+  CHECK(&copy.Blocks()[0] == &test.Blocks()[0]);
+  CHECK(copy.HasChange() == test.HasChange());
+
+  // The copy is independent of the original.
+  copy[0][1] = BitSet::SingleBit(9u, 1u);
+  CHECK(test[0][1].CountSet() == 9);
+  CHECK(copy.Squares(copy.Blocks()[0])[1]->SingletonValue() == 1);
+  CHECK(test.Squares(test.Blocks()[0])[1]->CountSet() == 9);
+
+  // Killer blocks are shared until one of the copies modifies them.
+  CHECK(&copy.KillerBlocks() == &test.KillerBlocks());
+  copy.AddKillerBlock({0, 1}, 3);
+  CHECK(copy.KillerBlocks().size() == 2);
+  CHECK(test.KillerBlocks().size() == 1);
+
+  SolveStats stats;
+  Sudoku solved(test);
+  const unsigned possible_sets = test.KillerBlocks()[0].CountPossibleSets();
+  SmartSolver::Solve(solved, stats);
+  CHECK(solved.IsSet());
+  CHECK(!test.IsSet());
+  CHECK(test.KillerBlocks()[0].CountPossibleSets() == possible_sets);
+
+  Sudoku moved(std::move(solved));
+  CHECK(moved.IsSet());
+
+  Sudoku assigned(16);
+  assigned = moved;
+  CHECK(assigned.Size() == 9);
+  CHECK(assigned.Serialize() == moved.Serialize());
+}
+
 TEST_CASE("Sudoku : change tracking", "[change]") {
     std::string small = "4  0  0   0  0  8   0  0  3 \n"
                         "0  0  5   2  0  0   0  1  0 \n"
@@ -86,12 +162,232 @@ TEST_CASE("Sudoku : change tracking", "[change]") {
   test[8][0] = BitSet::SingleBit(9u, 1u);
   CHECK(test.HasChange());
 
-  std::unordered_set<UniqueBlock *> blocks = test.ChangedBlocks();
-  CHECK(blocks.size() == 3);
+  BlockMask blocks = test.ChangedBlocks();
+  CHECK(blocks.Count() == 3);
+  // Row 8, column 0 and the bottom left square.
+  std::vector<unsigned> ids(blocks.begin(), blocks.end());
+  CHECK(ids == std::vector<unsigned>{8, 9, 24});
 
   test[7][1] = BitSet::SingleBit(9u, 2u);
   blocks = test.ChangedBlocks();
-  CHECK(blocks.size() == 5);
+  CHECK(blocks.Count() == 5);
+
+  // Writing the same value doesn't count as a change.
+  test.ResetChange();
+  test[7][1] = BitSet::SingleBit(9u, 2u);
+  test[7][1] -= 3u;
+  CHECK(!test.HasChange());
+  test[7][1] -= 2u;
+  CHECK(test.HasChange());
+  CHECK(test.ChangedBlocks().Count() == 3);
+}
+
+TEST_CASE("Sudoku : naked singles", "[singles]") {
+  // Valid both as a basic and as a diagonal puzzle.
+  std::string_view text = "009201708408300902102009305907405200804106003305908406700503104001602807203700609";
+  for (auto type : {BASIC, DIAGONAL}) {
+    Sudoku test(9, type);
+    REQUIRE(ReadPuzzle(text, test) != 0);
+    Sudoku expected(test);
+
+    test.ResetChange();
+    test.SolveNakedSingles();
+    CHECK(test.HasChange());
+    // Only the squares that were modified are marked.
+    CHECK(!test.ChangedBlocks().IsSet(0) == (test[0][1] == expected[0][1]));
+
+    std::string previous;
+    while (previous != expected.Serialize()) {
+      previous = expected.Serialize();
+      for (auto &block : expected.Blocks()) {
+        SolveNakedGroups(expected.Squares(block), 1);
+      }
+    }
+    CHECK(test.Serialize() == expected.Serialize());
+
+    test.ResetChange();
+    test.SolveNakedSingles();
+    CHECK(!test.HasChange());
+  }
+}
+
+// A solution of a BASIC puzzle with boxes, each row shifts the previous one
+// by a box row, or by one once the band of boxes is complete.
+void FillPatternSolution(Sudoku &s) {
+  const SudokuLayout &layout = *SudokuLayout::Get(s.Size(), BASIC);
+  for (unsigned i = 0; i < s.Size(); i++) {
+    for (unsigned j = 0; j < s.Size(); j++) {
+      unsigned shift = layout.box_cols * (i % layout.box_rows) + i / layout.box_rows;
+      s[i][j] = BitSet::SingleBit(s.Size(), (shift + j) % s.Size() + 1);
+    }
+  }
+}
+
+TEST_CASE("Sudoku : naked singles of large and rectangular boxes", "[singles]") {
+  std::mt19937 rng(5);
+  for (unsigned size : {6u, 12u, 25u, 36u}) {
+    INFO("size " << size);
+    Sudoku test(size);
+    FillPatternSolution(test);
+    REQUIRE(!test.HasConflict());
+    std::bernoulli_distribution cleared(0.5);
+    for (unsigned cell = 0; cell < size * size; cell++) {
+      if (cleared(rng))
+        test.Grid()[cell] = BitSet::SudokuSquare(size);
+    }
+    Sudoku expected(test);
+
+    test.SolveNakedSingles();
+    std::string previous;
+    while (previous != expected.Serialize()) {
+      previous = expected.Serialize();
+      for (auto &block : expected.Blocks()) {
+        SolveNakedGroups(expected.Squares(block), 1);
+      }
+    }
+    CHECK(test.Serialize() == expected.Serialize());
+    CHECK(!test.HasConflict());
+  }
+}
+
+void CheckPositionIndex(const Sudoku &test) {
+  for (const auto &block : test.Blocks()) {
+    for (unsigned number = 1; number <= test.Max(); number++) {
+      INFO("block " << test.BlockId(block) << " number " << number);
+      CHECK(test.Positions().Positions(test.BlockId(block), number) == block.NumberPositions(test.Data(), number));
+      CHECK(test.Positions(block)[number - 1] == block.NumberPositions(test.Data(), number));
+    }
+  }
+}
+
+TEST_CASE("Sudoku : block intersections", "[intersections]") {
+  auto layout = SudokuLayout::Get(9, DIAGONAL);
+  // Each row and column intersects 9 lines and 3 boxes, each box 6 lines.
+  // Each diagonal intersects all the lines, 3 boxes and the other diagonal
+  // (in the middle square), pairs are counted in both directions.
+  CHECK(layout->intersections.size() == 2 * 9 * 12 + 9 * 6 + 2 * 2 * (9 + 9 + 3) + 2);
+
+  std::mt19937 rng(7);
+  std::vector<std::string_view> puzzles = {
+      SINGLES_PUZZLE,
+      STUCK_PUZZLE,
+      "009201708408300902102009305907405200804106003305908406700503104001602807203700609"};
+  for (auto type : {BASIC, DIAGONAL}) {
+    for (unsigned round = 0; round < 40; round++) {
+      Sudoku test(9, type);
+      if (round < puzzles.size()) {
+        ReadPuzzle(puzzles[round], test);
+        test.SolveNakedSingles();
+      } else {
+        // Random candidates, including contradictions.
+        for (unsigned i = 0; i < 9; i++) {
+          for (unsigned j = 0; j < 9; j++) {
+            test[i][j] &= BitSet::FromValue(rng() | rng() | (round % 3 == 0 ? 0u : rng()));
+          }
+        }
+      }
+      Sudoku expected(test);
+      for (auto &block : expected.Blocks()) {
+        for (auto &rblock : expected.Blocks()) {
+          SolveBlockIntersection(expected.Grid(), block, rblock);
+        }
+      }
+      test.SolveBlockIntersections();
+      INFO("round " << round << " type " << type);
+      CHECK(test.Serialize() == expected.Serialize());
+      CheckPositionIndex(test);
+    }
+  }
+}
+
+TEST_CASE("Sudoku : position index", "[positions]") {
+  std::string_view text = SINGLES_PUZZLE;
+  Sudoku test(9, DIAGONAL);
+  CheckPositionIndex(test);
+  REQUIRE(ReadPuzzle(text, test) != 0);
+  CheckPositionIndex(test);
+
+  // Additions are reflected as well as removals.
+  test[0][1] = BitSet::SudokuSquare(9);
+  test[0][0] = BitSet::SudokuSquare(9);
+  CheckPositionIndex(test);
+
+  Sudoku copy(test);
+  SolveStats stats;
+  SmartSolver::Solve(copy, stats);
+  CheckPositionIndex(copy);
+  CheckPositionIndex(test);
+
+  Sudoku restored(9);
+  restored.Deserialize(copy.Serialize());
+  CheckPositionIndex(restored);
+
+  Sudoku large(16);
+  REQUIRE(ReadPuzzle("1A*G" + std::string(252, '0'), large) == 256);
+  large.SolveNakedSingles();
+  CheckPositionIndex(large);
+}
+
+TEST_CASE("Sudoku : shared layout", "[layout]") {
+  for (unsigned size : {4u, 9u, 16u}) {
+    for (auto type : {BASIC, DIAGONAL}) {
+      Sudoku first(size, type);
+      Sudoku second(size, type);
+      CHECK(&first.Blocks()[0] == &second.Blocks()[0]);
+
+      auto layout = SudokuLayout::Get(size, type);
+      CHECK(&layout->blocks[0] == &first.Blocks()[0]);
+      for (unsigned cell = 0; cell < size * size; cell++) {
+        INFO("size " << size << " cell " << cell);
+        std::vector<unsigned> expected(size * size, 0);
+        for (size_t k = 0; k < layout->mapping[cell].size(); k++) {
+          const auto &block = layout->blocks[layout->mapping[cell][k]];
+          CHECK(block.Cells()[layout->offsets[cell][k]] == cell);
+          for (auto peer : block.Cells()) {
+            expected[peer] = peer != cell;
+          }
+        }
+        auto peers = layout->Peers(cell);
+        std::vector<unsigned> actual(size * size, 0);
+        for (unsigned peer = 0; peer < size * size; peer++) {
+          actual[peer] = (peers[peer / 64] >> (peer % 64)) & 1u;
+        }
+        CHECK(actual == expected);
+      }
+    }
+  }
+  CHECK(SudokuLayout::Get(9, BASIC) != SudokuLayout::Get(9, DIAGONAL));
+}
+
+TEST_CASE("Sudoku : box geometry", "[layout]") {
+  // {size, box rows, box columns}, prime sizes don't have boxes.
+  const unsigned boxes[][3] = {{4, 2, 2},  {6, 2, 3},  {8, 2, 4},  {9, 3, 3},  {12, 3, 4}, {16, 4, 4},
+                               {25, 5, 5}, {36, 6, 6}, {49, 7, 7}, {64, 8, 8}, {7, 0, 0},  {11, 0, 0}};
+  for (const auto &[size, rows, cols] : boxes) {
+    INFO("size " << size);
+    auto layout = SudokuLayout::Get(size, BASIC);
+    CHECK(layout->box_rows == rows);
+    CHECK(layout->box_cols == cols);
+    CHECK(layout->box_size == (rows == cols ? rows : 0));
+    REQUIRE(layout->blocks.size() == (rows == 0 ? 2 : 3) * size);
+    for (unsigned cell = 0; cell < size * size; cell++) {
+      CHECK(layout->mapping[cell].size() == (rows == 0 ? 2u : 3u));
+    }
+    if (rows == 0)
+      continue;
+    // Every box is a rectangle of box_rows x box_cols squares.
+    for (unsigned box = 2 * size; box < 3 * size; box++) {
+      const auto &cells = layout->blocks[box].Cells();
+      auto [low, high] = std::minmax_element(cells.begin(), cells.end());
+      CHECK(*high / size - *low / size == rows - 1);
+      CHECK(*high % size - *low % size == cols - 1);
+    }
+
+    Sudoku solved(size);
+    FillPatternSolution(solved);
+    CHECK(solved.IsSet());
+    CHECK(!solved.HasConflict());
+  }
 }
 
 TEST_CASE("Sudoku : check against solution", "[solution]") {
@@ -149,18 +445,98 @@ TEST_CASE("Sudoku : Test Build Chains", "[graph]") {
   auto chains = test.GetChains(1u);
   CHECK(chains.nodes.size() == 10);
 
-  CHECK(chains.weak_links.count(4) == 0);
-  CHECK(chains.strong_links.count(4) == 0);
-  CHECK(chains.weak_links.count(32) == 0);
-  CHECK(chains.strong_links.count(32) == 0);
+  CHECK(chains.CountLinks(4, WEAK_LINK) == 0);
+  CHECK(chains.CountLinks(4, STRONG_LINK) == 0);
+  CHECK(chains.CountLinks(32, WEAK_LINK) == 0);
+  CHECK(chains.CountLinks(32, STRONG_LINK) == 0);
 
   CHECK(find(chains.nodes.begin(), chains.nodes.end(), 10) != chains.nodes.end());
-  CHECK(chains.strong_links.count(10) == 1);
-  CHECK(chains.weak_links.count(10) == 3);
+  CHECK(chains.CountLinks(10, STRONG_LINK) == 1);
+  CHECK(chains.CountLinks(10, WEAK_LINK) == 3);
 
   CHECK(find(chains.nodes.begin(), chains.nodes.end(), 80) != chains.nodes.end());
-  CHECK(chains.strong_links.count(80) == 2);
-  CHECK(chains.weak_links.count(80) == 2);
+  CHECK(chains.CountLinks(80, STRONG_LINK) == 2);
+  CHECK(chains.CountLinks(80, WEAK_LINK) == 2);
+
+  // Links are sorted by the target square, strong links are weak links too.
+  auto links = chains.Links(chains.NodeId(80));
+  REQUIRE(links.size() == 2);
+  CHECK(chains.nodes[ChainsGraph::LinkNode(links[0])] == 53);
+  CHECK(chains.nodes[ChainsGraph::LinkNode(links[1])] == 70);
+  CHECK(ChainsGraph::LinkTypes(links[0]) == (STRONG_LINK | WEAK_LINK));
+
+  // Rebuilding reuses the graph.
+  test.BuildChains(1u, chains);
+  CHECK(chains.nodes.size() == 10);
+  CHECK(chains.CountLinks(10, WEAK_LINK) == 3);
+  CHECK(chains.NodeId(4) != ChainsGraph::NO_NODE);
+  CHECK(chains.NodeId(5) == ChainsGraph::NO_NODE);
+}
+
+TEST_CASE("Sudoku : X chains search matches traversal", "[graph]") {
+  std::vector<Sudoku> puzzles;
+  for (auto text : {STUCK_PUZZLE,
+                    SINGLES_PUZZLE,
+                    "000000010400000000020000000000050407008000300001090000300400200050100000000806000"}) {
+    Sudoku puzzle(9);
+    ReadPuzzle(text, puzzle);
+    puzzle.SolveNakedSingles();
+    puzzles.push_back(puzzle);
+  }
+  // The state the solver gets stuck in.
+  SolveStats stats;
+  SmartSolver::Solve(puzzles[0], stats);
+
+  auto layout = SudokuLayout::Get(9, BASIC);
+  auto sees = [&layout](unsigned from, unsigned square) {
+    return (layout->Peers(from)[square / 64] >> (square % 64)) & 1u;
+  };
+
+  for (const auto &puzzle : puzzles) {
+    for (unsigned number = 1; number <= 9; number++) {
+      auto graph = puzzle.GetChains(number);
+      for (unsigned max_length : {4u, 6u, 8u, 10u}) {
+        // Reference: traverse the chains of each length separately.
+        Sudoku traversed(puzzle);
+        std::vector<size_t> shortest(81, 0);
+        ChainsPath path;
+        for (unsigned length = 2; length <= max_length; length += 2) {
+          TraverseAlternatingChains(graph, length, path, [&](std::span<const unsigned> chain) {
+            traversed.PruneNumbersSeenFrom(chain, number);
+            for (auto square : graph.nodes) {
+              if (std::find(chain.begin(), chain.end(), square) != chain.end())
+                continue;
+              if (sees(chain.front(), square) && sees(chain.back(), square) && shortest[square] == 0)
+                shortest[square] = chain.size();
+            }
+          });
+        }
+
+        Sudoku searched(puzzle);
+        searched.SolveXChains(max_length, number);
+        CHECK(std::equal(searched.Data(), searched.Data() + 81, traversed.Data()));
+
+        auto found = puzzle.FindXChains(max_length, number);
+        size_t expected = static_cast<size_t>(std::count_if(shortest.begin(), shortest.end(),
+                                                            [](size_t length) { return length != 0; }));
+        CHECK(found.size() == expected);
+        for (const auto &elimination : found) {
+          CHECK(shortest[elimination.square] == elimination.chain.size());
+          CHECK(sees(elimination.chain.front(), elimination.square));
+          CHECK(sees(elimination.chain.back(), elimination.square));
+          // Chains alternate strong and weak links, starting and ending with a strong one.
+          for (size_t i = 0; i + 1 < elimination.chain.size(); i++) {
+            auto links = graph.Links(graph.NodeId(elimination.chain[i]));
+            unsigned next = graph.NodeId(elimination.chain[i + 1]);
+            auto link = std::find_if(links.begin(), links.end(),
+                                     [next](unsigned l) { return ChainsGraph::LinkNode(l) == next; });
+            REQUIRE(link != links.end());
+            CHECK((*link & (i % 2 == 0 ? STRONG_LINK : WEAK_LINK)) != 0);
+          }
+        }
+      }
+    }
+  }
 }
 
 TEST_CASE("Sudoku : Test Checkers", "x") {
@@ -204,46 +580,44 @@ TEST_CASE("Sudoku : Test Checkers", "x") {
 
   unsigned it = 0;
   for (const auto& block : test3.Blocks()) {
-    for (auto *square : block.GetSquares()) {
-      CHECK(square-&test3[0][0] == result[it]);
+    for (auto *square : block.GetSquares(test3.Data())) {
+      CHECK(square-test3.Data() == result[it]);
       it++;
     }
   }
 
   it = 0;
   for (const auto& block : test3.GetRowBlocks()) {
-    for (auto *square : block->GetSquares()) {
-      CHECK(square-&test3[0][0] == result[it]);
+    for (auto square : block->Cells()) {
+      CHECK(square == result[it]);
       it++;
     }
   }
 
   for (const auto& block : test3.GetColBlocks()) {
-    for (auto *square : block->GetSquares()) {
-      CHECK(square-&test3[0][0] == result[it]);
+    for (auto square : block->Cells()) {
+      CHECK(square == result[it]);
       it++;
     }
   }
 
   for (auto &i : TestGetMappings(test3)) {
-    for (auto &j : i) {
-      REQUIRE(j.size() == 3);
-    }
+    REQUIRE(i.size() == 3);
   }
 
   it = 0;
-  for (auto &i : TestGetMappings(test3)[0][0][0]->GetSquares()) {
-    CHECK(i-&test3[0][0] == it);
+  for (auto i : test3.Blocks()[TestGetMappings(test3)[0][0]].Cells()) {
+    CHECK(i == it);
     it++;
   }
   it = 0;
-  for (auto &i : TestGetMappings(test3)[0][0][1]->GetSquares()) {
-    CHECK(i-&test3[0][0] == it*9);
+  for (auto i : test3.Blocks()[TestGetMappings(test3)[0][1]].Cells()) {
+    CHECK(i == it*9);
     it++;
   }
   it = 0;
-  for (auto &i : TestGetMappings(test3)[0][0][2]->GetSquares()) {
-    CHECK(i-&test3[0][0] == ((it/3)*9+it%3));
+  for (auto i : test3.Blocks()[TestGetMappings(test3)[0][2]].Cells()) {
+    CHECK(i == ((it/3)*9+it%3));
     it++;
   }
 }
@@ -300,17 +674,17 @@ TEST_CASE("Sudoku : Changed blocks", "[]") {
   stream >> test3;
 
   auto blocks = test3.ChangedBlocks();
-  CHECK(blocks.size() == 26);
+  CHECK(blocks.Count() == 26);
 
-  for (auto b : test3.GetRowBlocks()) {
-    CHECK(blocks.count(b) == 1);
+  // Rows are the first 9 blocks, followed by the columns.
+  for (unsigned i = 0; i < 9; i++) {
+    CHECK(blocks.IsSet(i));
   }
-  auto cols = test3.GetColBlocks();
-  for (unsigned i = 0; i < cols.size(); i++) {
+  for (unsigned i = 0; i < 9; i++) {
     if (i != 4)    
-      CHECK(blocks.count(cols[i]) == 1);
+      CHECK(blocks.IsSet(9 + i));
     else
-      CHECK(blocks.count(cols[i]) == 0);
+      CHECK(!blocks.IsSet(9 + i));
   }
 }
 
@@ -589,13 +963,10 @@ TEST_CASE("Sudoku : Serialize and Deserialize : Killer", "[killer]") {
     test.PreBuildKillerMapping();
 
     auto &mapping = TestGetContainedKillerBlocks(test);
-    CHECK(mapping.size() == 3);
-    CHECK(mapping.count(0) == 1);
-    CHECK(mapping.count(18) == 1);
-    CHECK(mapping.count(20) == 1);
-    CHECK((*mapping.equal_range(0).first).second == 1);
-    CHECK((*mapping.equal_range(18).first).second == 0);
-    CHECK((*mapping.equal_range(20).first).second == 1);
+    REQUIRE(mapping.size() == 3);
+    CHECK(mapping[0] == std::make_pair(0u, 1u));
+    CHECK(mapping[1] == std::make_pair(18u, 0u));
+    CHECK(mapping[2] == std::make_pair(20u, 1u));
 
     SolveStats s;
     SmartSolver::Solve(test,s);
@@ -609,6 +980,95 @@ TEST_CASE("Sudoku : Serialize and Deserialize : Killer", "[killer]") {
     //REQUIRE(test.Serialize() == "0:9:9:9:8:256:2:16:1:128:64:32:4:128:4:16:2:32:64:8:1:256:64:32:1:4:8:256:128:16:2:256:8:64:128:2:16:1:4:32:2:128:32:256:4:1:16:8:64:1:16:4:32:64:8:256:2:128:16:2:256:8:128:32:4:64:1:4:64:8:1:256:2:32:128:16:32:1:128:64:16:4:2:256:8:1:");
 }
 
+TEST_CASE("Sudoku : Killer cages of large puzzles", "[killer]") {
+  for (unsigned size : {16u, 25u}) {
+    INFO("size " << size);
+    Sudoku test(size);
+    // The two largest numbers, and the three smallest ones.
+    test.AddKillerBlock({0, 1}, 2 * size - 1);
+    test.AddKillerBlock({size, size + 1, 2 * size}, 6);
+    test.PruneKillerBlockSums();
+    test.PruneSquaresFromKillerBlocks();
+    BitSet largest = BitSet::SingleBit(size, size) + (size - 1);
+    CHECK(test[0][0] == largest);
+    CHECK(test[0][1] == largest);
+    BitSet smallest = BitSet::SingleBit(size, 1) + 2 + 3;
+    CHECK(test[1][0] == smallest);
+    CHECK(test[1][1] == smallest);
+    CHECK(test[2][0] == smallest);
+    CHECK(test[0][2] == BitSet::SudokuSquare(size));
+  }
+}
+
+TEST_CASE("Sudoku : AddKillerBlock validation", "[killer]") {
+  Sudoku test(9);
+  CHECK_THROWS_AS(test.AddKillerBlock({0}, 5), std::out_of_range);
+  CHECK_THROWS_AS(test.AddKillerBlock({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, 50), std::out_of_range);
+  CHECK_THROWS_AS(test.AddKillerBlock({0, 81}, 5), std::out_of_range);
+  CHECK_THROWS_AS(test.AddKillerBlock({0, 1, 0}, 10), std::out_of_range);
+  CHECK_THROWS_AS(test.AddKillerBlock({0, 1}, 2), std::out_of_range);
+  CHECK_THROWS_AS(test.AddKillerBlock({0, 1}, 18), std::out_of_range);
+  CHECK_THROWS_AS(test.AddKillerBlock({0, 1, 2}, 25), std::out_of_range);
+  CHECK(test.KillerBlocks().empty());
+
+  test.AddKillerBlock({0, 1}, 3);
+  test.AddKillerBlock({2, 3}, 17);
+  test.AddKillerBlock({4, 5, 6, 7, 8, 9, 10, 11, 12}, 45);
+  CHECK(test.KillerBlocks().size() == 3);
+}
+
+TEST_CASE("Sudoku : SerializeBinary and DeserializeBinary", "[binary]") {
+    Sudoku test(9);
+    std::stringstream stream(SINGLES_PUZZLE);
+    stream >> test;
+    test[0][1] -= 2;
+    TestInjectKillerBlock(test, 15, {1, 2, 11});
+    TestInjectKillerBlock(test, 9, {6, 7});
+
+    std::string data = "prefix";
+    test.SerializeBinary(data);
+    REQUIRE(data.size() == 6 + 8 + 81 * 2 + 2 * 4 + 5 * 2);
+
+    Sudoku test2(16, DIAGONAL);
+    REQUIRE(test2.DeserializeBinary(std::string_view(data).substr(6)) == data.size() - 6);
+    CHECK(test2.Size() == 9);
+    CHECK(test2.Serialize() == test.Serialize());
+
+    // The binary and the text forms convert into each other without loss.
+    Sudoku test3(9);
+    test3.Deserialize(test2.Serialize());
+    std::string data3;
+    test3.SerializeBinary(data3);
+    CHECK(data3 == data.substr(6));
+
+    Sudoku big(16, DIAGONAL);
+    big[3][5] -= 7;
+    std::string big_data;
+    big.SerializeBinary(big_data);
+    Sudoku big2(9);
+    REQUIRE(big2.DeserializeBinary(big_data) == 8 + 256 * 2);
+    CHECK(big2.Serialize() == big.Serialize());
+    CHECK(big2.KillerBlocks().empty());
+
+    CHECK_THROWS(big2.DeserializeBinary(std::string_view(data).substr(6, 20)));
+    std::string wrong_version = big_data;
+    wrong_version[0] = 2;
+    CHECK_THROWS(big2.DeserializeBinary(wrong_version));
+    // Number 16 in a 9x9 puzzle.
+    std::string wrong_bits = data.substr(6);
+    wrong_bits[9] = static_cast<char>(0x80);
+    CHECK_THROWS(big2.DeserializeBinary(wrong_bits));
+    // A square of the last killer block outside of the puzzle.
+    std::string wrong_killer = data.substr(6);
+    wrong_killer[wrong_killer.size() - 2] = 81;
+    CHECK_THROWS(big2.DeserializeBinary(wrong_killer));
+    // The failed calls left the puzzle as it was.
+    CHECK(big2.Size() == 16);
+    CHECK(big2.Type() == DIAGONAL);
+    CHECK(big2.Serialize() == big.Serialize());
+    CHECK(big2.KillerBlocks().empty());
+}
+
 TEST_CASE("Sudoku : SolveFinnedFish 1", "[finned]") {
     Sudoku test(9);
     Sudoku expect(9);
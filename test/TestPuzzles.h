@@ -0,0 +1,32 @@
+/* (c) 2020 RNDr. Simon Toth (happy.cerberus@gmail.com) */
+
+#ifndef SUDOKU_TESTPUZZLES_H
+#define SUDOKU_TESTPUZZLES_H
+
+//! 9x9 puzzles shared by the tests and the benchmarks.
+
+//! Solved by the naked singles alone.
+inline constexpr const char *SINGLES_PUZZLE =
+    "400008003005200010060009000000000030006901000000604920029000300004002085000703000";
+
+//! Puzzles solved by SmartSolver, with their solutions.
+inline constexpr const char *PUZZLES[][2] = {
+    {"020009050004070200050406000106007000008090100000300407000902060005030900060700020",
+     "327189654684573219951426873136847592748295136592361487413952768275638941869714325"},
+    {"003020600900305001001806400008102900700000008006708200002609500800203009005010300",
+     "483921657967345821251876493548132976729564138136798245372689514814253769695417382"},
+};
+
+//! SmartSolver gets stuck on it.
+inline constexpr const char *STUCK_PUZZLE =
+    "030085000625319700000002005000074100000250000700003002106030009008000010490500860";
+inline constexpr const char *STUCK_SOLUTION =
+    "934785621625319784817642395562974138341258976789163452156837249278496513493521867";
+
+//! Beyond the techniques of SmartSolver.
+inline constexpr const char *HARD_PUZZLE =
+    "800000000003600000070090200050007000000045700000100030001000068008500010090000400";
+inline constexpr const char *HARD_SOLUTION =
+    "812753649943682175675491283154237896369845721287169534521974368438526917796318452";
+
+#endif
@@ -13,11 +13,11 @@ struct SimpleBlock {
             data.push_back(BitSet::SudokuSquare(max));
         }
         for (unsigned i = 0; i < size; i++) {
-            block_data.push_back(&data[i]);
+            block_data.push_back(i);
         }
     }
     std::vector<BitSet> data;
-    std::vector<BitSet*> block_data;
+    std::vector<unsigned> block_data;
 };
 }
 
@@ -34,11 +34,11 @@ TEST_CASE("UniqueBlock : HasConflict", "") {
     SimpleBlock data(3u,3u);
     UniqueBlock block{data.block_data, 3u};
 
-    REQUIRE(!block.HasConflict());
+    REQUIRE(!block.HasConflict(data.data.data()));
     data.data[0] = BitSet::SingleBit(3u, 1u);
-    REQUIRE(!block.HasConflict());
+    REQUIRE(!block.HasConflict(data.data.data()));
     data.data[1] = BitSet::SingleBit(3u, 1u);
-    REQUIRE(block.HasConflict());
+    REQUIRE(block.HasConflict(data.data.data()));
 }
 
 TEST_CASE("UniqueBlock : Prune", "") {
@@ -46,9 +46,9 @@ TEST_CASE("UniqueBlock : Prune", "") {
     UniqueBlock block{data.block_data, 3u};
 
     REQUIRE((data.data[0].IsBitSet(2) && data.data[1].IsBitSet(2) && data.data[2].IsBitSet(2)));
-    block.Prune(2, BitSet::Empty(3u));
+    block.Prune(data.data.data(), 2, BitSet::Empty(3u));
     REQUIRE((!data.data[0].IsBitSet(2) && !data.data[1].IsBitSet(2) && !data.data[2].IsBitSet(2)));
-    block.Prune(1, BitSet::SingleBit(3u, 2));
+    block.Prune(data.data.data(), 1, BitSet::SingleBit(3u, 2));
     REQUIRE((!data.data[0].IsBitSet(1) && data.data[1].IsBitSet(1) && !data.data[2].IsBitSet(1)));
 }
 
@@ -57,10 +57,10 @@ TEST_CASE("UniqueBlock : NumberPositions", "") {
     SimpleBlock data(3u,3u);
     UniqueBlock block{data.block_data, 3u};
 
-    BitSet set = block.NumberPositions(2);
+    BitSet set = block.NumberPositions(data.data.data(), 2);
     REQUIRE(set.CountSet() == 3);
     data.data[0] -= 2;
-    set = block.NumberPositions(2);
+    set = block.NumberPositions(data.data.data(), 2);
     REQUIRE(set.CountSet() == 2);
     REQUIRE(!set.IsBitSet(1));
     REQUIRE(set.IsBitSet(2));